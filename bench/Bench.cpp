@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include "bench.h"
+
+// Counts heap allocations, for bench::heap_allocations().
+
+namespace
+{
+std::atomic<size_t> allocation_count(0);
+}
+
+void* operator new(size_t bytes)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+	if (auto* p = std::malloc(bytes ? bytes : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+size_t bench::heap_allocations() noexcept
+{
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+/*
+    Usage: Bench [filter] [--elements=N] [--repeat=R] [--counters]
+
+    Runs every registered case whose name contains filter. --counters adds
+    per element hardware counters (Linux perf events) where available;
+    they include the threads a case starts.
+    Cases that allocate also report heap allocations per element.
+*/
+int main(int argc, char** argv)
+{
+	auto opt = bench::options();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const auto arg = std::string(argv[i]);
+
+		if (arg.compare(0, 11, "--elements=") == 0)
+			opt.elements = std::strtoull(arg.c_str() + 11, nullptr, 10);
+		else if (arg.compare(0, 9, "--repeat=") == 0)
+			opt.repeat = std::strtoull(arg.c_str() + 9, nullptr, 10);
+		else if (arg == "--counters")
+			opt.counters = true;
+		else
+			opt.filter = arg;
+	}
+
+	if (opt.counters && !bench::shared_counters().any_available())
+	{
+		std::fprintf(stderr, "hardware counters unavailable, "
+		                     "reporting wall-clock time only\n");
+	}
+
+	for (const auto& c : bench::registry())
+	{
+		if (std::strstr(c.name, opt.filter.c_str()) != nullptr)
+			c.run(opt);
+	}
+}
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "actor_runtime.h"
+#include "bench.h"
+
+/*
+    Actor messaging: ping-pong between pairs of actors on different
+    workers, and fan-out from one sender to many actors. Messages carry
+    their send time; each case reports messages/s and the p99 latency
+    from send to receive. The baseline holds each message on the heap.
+*/
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	           clock_type::now().time_since_epoch())
+	    .count();
+}
+
+class message
+{
+public:
+	virtual ~message()
+	{
+	}
+
+	virtual int64_t sent() const = 0;
+	virtual uint32_t hops() const = 0;
+};
+
+// Payload of 24 bytes, in-place.
+class ball final : public message
+{
+public:
+	ball(int64_t sent, uint32_t hops, uint64_t a = 0, uint64_t b = 0)
+	  : sent_at(sent), hops_left(hops), a(a), b(b)
+	{
+	}
+
+	int64_t sent() const override
+	{
+		return sent_at;
+	}
+
+	uint32_t hops() const override
+	{
+		return hops_left;
+	}
+
+private:
+	int64_t sent_at;
+	uint32_t hops_left;
+	uint64_t a, b;
+};
+
+// The same payload, allocated on the heap per message.
+class boxed final : public message
+{
+public:
+	boxed(int64_t sent, uint32_t hops, uint64_t a = 0, uint64_t b = 0)
+	  : payload(new ball(sent, hops, a, b))
+	{
+	}
+
+	int64_t sent() const override
+	{
+		return payload->sent();
+	}
+
+	uint32_t hops() const override
+	{
+		return payload->hops();
+	}
+
+private:
+	std::unique_ptr<ball> payload;
+};
+
+class actor
+{
+public:
+	virtual ~actor()
+	{
+	}
+
+	virtual void receive(message& m) = 0;
+};
+
+using runtime = actor_runtime<actor, 64, message, 48>;
+
+// Per actor latency samples, in ns.
+using samples = std::vector<int64_t>;
+
+// Records the latency and bounces the message back until hops run out.
+template <class Message>
+class player final : public actor
+{
+public:
+	player(runtime& rt, runtime::actor_id peer, samples& s, std::atomic<int>& done)
+	  : rt(&rt), peer(peer), latencies(&s), done(&done)
+	{
+	}
+
+	void receive(message& m) override
+	{
+		const auto t = now_ns();
+		latencies->push_back(t - m.sent());
+
+		if (m.hops() == 0)
+			++*done;
+		else
+			rt->try_send<Message>(peer, t, m.hops() - 1);
+	}
+
+private:
+	runtime* rt;
+	runtime::actor_id peer;
+	samples* latencies;
+	std::atomic<int>* done;
+};
+
+// Records the latency only.
+class sink final : public actor
+{
+public:
+	sink(samples& s, std::atomic<int>& received) : latencies(&s), received(&received)
+	{
+	}
+
+	void receive(message& m) override
+	{
+		latencies->push_back(now_ns() - m.sent());
+		received->fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	samples* latencies;
+	std::atomic<int>* received;
+};
+
+runtime::config make_config()
+{
+	auto c = runtime::config();
+	c.workers = std::max(2u, std::thread::hardware_concurrency());
+	c.mailbox_capacity = 1024;
+	c.batch = 32;
+	c.pin_threads = true;
+	return c;
+}
+
+void wait_until(const std::atomic<int>& counter, int target)
+{
+	while (counter.load() < target)
+		std::this_thread::yield();
+}
+
+// Prints throughput and p99 latency over all samples.
+void summarize(const char* variant,
+               size_t messages,
+               double seconds,
+               std::vector<samples>& all)
+{
+	auto merged = samples();
+	for (auto& s : all)
+		merged.insert(merged.end(), s.begin(), s.end());
+
+	auto p99 = int64_t(0);
+	if (!merged.empty())
+	{
+		const auto k = merged.size() * 99 / 100;
+		std::nth_element(merged.begin(), merged.begin() + k, merged.end());
+		p99 = merged[k];
+	}
+
+	auto r = bench::result();
+	r.ns = seconds * 1e9 / static_cast<double>(messages);
+	bench::report("actors", variant, messages, r);
+	std::printf("  %.2f M msgs/s, p99 latency %lld ns\n",
+	            static_cast<double>(messages) / seconds / 1e6,
+	            static_cast<long long>(p99));
+}
+
+// Pairs of players on different workers, each pair with one ball.
+template <class Message>
+void ping_pong(const char* variant, size_t messages)
+{
+	const auto pairs = 8;
+	const auto hops = static_cast<uint32_t>(messages / pairs);
+
+	std::atomic<int> done(0);
+	auto latencies = std::vector<samples>(2 * pairs);
+	for (auto& s : latencies)
+		s.reserve(hops + 1);
+
+	auto c = make_config();
+	runtime rt(c);
+
+	for (uint32_t p = 0; p < pairs; ++p)
+	{
+		rt.spawn_on<player<Message>>(0, rt, 2 * p + 1, latencies[2 * p], done);
+		rt.spawn_on<player<Message>>(1, rt, 2 * p, latencies[2 * p + 1], done);
+	}
+	rt.start();
+
+	const auto start = clock_type::now();
+	for (uint32_t p = 0; p < pairs; ++p)
+		rt.send<Message>(2 * p, now_ns(), hops);
+
+	wait_until(done, pairs);
+	const auto seconds =
+	    std::chrono::duration<double>(clock_type::now() - start).count();
+
+	rt.stop();
+	summarize(variant, static_cast<size_t>(pairs) * (hops + 1), seconds,
+	          latencies);
+}
+
+// One external sender, many sinks spread over the workers.
+template <class Message>
+void fan_out(const char* variant, size_t messages)
+{
+	const auto sinks = 64;
+	const auto rounds = static_cast<int>(messages / sinks);
+
+	std::atomic<int> received(0);
+	auto latencies = std::vector<samples>(sinks);
+	for (auto& s : latencies)
+		s.reserve(static_cast<size_t>(rounds));
+
+	auto c = make_config();
+	runtime rt(c);
+
+	for (int s = 0; s < sinks; ++s)
+		rt.spawn<sink>(latencies[s], received);
+	rt.start();
+
+	const auto start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (uint32_t s = 0; s < sinks; ++s)
+			rt.send<Message>(s, now_ns(), 0u);
+	}
+
+	wait_until(received, sinks * rounds);
+	const auto seconds =
+	    std::chrono::duration<double>(clock_type::now() - start).count();
+
+	rt.stop();
+	summarize(variant, static_cast<size_t>(sinks) * rounds, seconds,
+	          latencies);
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	ping_pong<boxed>("ping-pong, heap payload", n);
+	ping_pong<ball>("ping-pong, in-place", n);
+	fan_out<boxed>("fan-out, heap payload", n);
+	fan_out<ball>("fan-out, in-place", n);
+}
+
+bench::registrar reg("actors", &run);
+}
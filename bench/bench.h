@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "counters.h"
+
+// Minimal benchmark harness: cases register themselves, Bench.cpp runs them.
+namespace bench
+{
+
+// Command line options shared by all cases.
+struct options
+{
+	size_t elements = size_t(1) << 20; // default collection size
+	size_t repeat = 5;                 // runs per measurement, best is kept
+	std::string filter;                // run cases whose name contains this
+	bool counters = false;             // collect hardware counters
+};
+
+// Result of one measurement, normalized per element.
+struct result
+{
+	double ns = 0;          // wall-clock nanoseconds
+	double allocations = 0; // calls to operator new
+
+	// hardware counter values, valid if has_counter[id]
+	double counter[counter_count] = {};
+	bool has_counter[counter_count] = {};
+};
+
+using case_function = void (*)(const options&);
+
+struct case_entry
+{
+	const char* name;
+	case_function run;
+};
+
+// All registered cases, in registration order.
+inline std::vector<case_entry>& registry()
+{
+	static auto cases = std::vector<case_entry>();
+	return cases;
+}
+
+// Registers a case during static initialization.
+struct registrar
+{
+	registrar(const char* name, case_function run)
+	{
+		registry().push_back(case_entry{name, run});
+	}
+};
+
+// Number of calls to the global operator new so far, counted by Bench.cpp.
+size_t heap_allocations() noexcept;
+
+// Prevents the compiler from optimizing away a computed value.
+template <class T>
+inline void keep(const T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+// Hardware counters shared by all cases, opened on first use.
+inline counters& shared_counters()
+{
+	static counters c;
+	return c;
+}
+
+/*
+     Runs f() opt.repeat times and returns the best run per element.
+    f must process `elements` elements per run. setup() runs untimed
+    before each run, e.g. to reshuffle data that f() sorts.
+
+     If opt.counters is set, hardware counters are read around each run
+    and reported for the fastest one, as are heap allocations.
+*/
+template <class Setup, class F>
+result measure(const options& opt, size_t elements, Setup&& setup, F&& f)
+{
+	using clock = std::chrono::steady_clock;
+
+	auto* hw = opt.counters ? &shared_counters() : nullptr;
+	const auto per_element = 1.0 / static_cast<double>(elements);
+
+	auto best = result();
+	best.ns = std::numeric_limits<double>::max();
+
+	for (size_t r = 0; r < std::max<size_t>(opt.repeat, 1); ++r)
+	{
+		setup();
+
+		if (hw)
+			hw->start();
+
+		const auto allocations = heap_allocations();
+		const auto start = clock::now();
+		f();
+		const auto stop = clock::now();
+		const auto allocated = heap_allocations() - allocations;
+
+		if (hw)
+			hw->stop();
+
+		const auto ns =
+		    std::chrono::duration<double, std::nano>(stop - start).count();
+
+		if (ns * per_element >= best.ns)
+			continue;
+
+		best.ns = ns * per_element;
+		best.allocations = static_cast<double>(allocated) * per_element;
+
+		for (size_t i = 0; hw && i < counter_count; ++i)
+		{
+			best.has_counter[i] = hw->available(i);
+			best.counter[i] = static_cast<double>(hw->value(i)) * per_element;
+		}
+	}
+
+	return best;
+}
+
+// Same as above, without setup.
+template <class F>
+result measure(const options& opt, size_t elements, F&& f)
+{
+	return measure(opt, elements, [] {}, std::forward<F>(f));
+}
+
+// Prints one result line, with per element counters if collected, and
+// heap allocations per element if there were any.
+inline void report(const char* name,
+                   const char* variant,
+                   size_t elements,
+                   const result& r)
+{
+	std::printf("%-24s %-32s %12zu %10.3f ns/elem", name, variant, elements,
+	            r.ns);
+
+	for (size_t i = 0; i < counter_count; ++i)
+	{
+		if (r.has_counter[i])
+			std::printf("  %s %.3f", counter_name(i), r.counter[i]);
+	}
+
+	if (r.allocations > 0)
+		std::printf("  allocs %.3f", r.allocations);
+
+	std::printf("\n");
+	std::fflush(stdout);
+}
+}
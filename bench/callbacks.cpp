@@ -0,0 +1,80 @@
+#include <functional>
+#include <vector>
+#include "bench.h"
+#include "local_function.h"
+
+// A callback registry: std::function vs. local_function.
+namespace
+{
+// Captures of 24 bytes, larger than std::function's small buffer.
+template <class Function>
+void fill(std::vector<Function>& callbacks, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto a = static_cast<long>(i);
+		const auto b = a * 3;
+		const auto c = a ^ 5;
+
+		switch (i % 4)
+		{
+		case 0:
+			callbacks.emplace_back([a, b, c](long x) { return x + a - b + c; });
+			break;
+		case 1:
+			callbacks.emplace_back([a, b, c](long x) { return x * b - a + c; });
+			break;
+		case 2:
+			callbacks.emplace_back([a, b, c](long x) { return (x ^ c) + a + b; });
+			break;
+		default:
+			callbacks.emplace_back([a, b, c](long x) { return x - c + (a & b); });
+			break;
+		}
+	}
+}
+
+template <class Function>
+bench::result call_all(const bench::options& opt, size_t n)
+{
+	auto callbacks = std::vector<Function>();
+	callbacks.reserve(n);
+	fill(callbacks, n);
+
+	return bench::measure(opt, n, [&] {
+		auto sum = 0L;
+		for (auto& f : callbacks)
+			sum = f(sum);
+		bench::keep(sum);
+	});
+}
+
+template <class Function>
+bench::result register_all(const bench::options& opt, size_t n)
+{
+	auto callbacks = std::vector<Function>();
+	callbacks.reserve(n);
+
+	return bench::measure(opt, n, [&] { callbacks.clear(); },
+	                      [&] { fill(callbacks, n); });
+}
+
+using std_function = std::function<long(long)>;
+using local = local_function<long(long) const, 24, alignof(long)>;
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	bench::report("callbacks", "std::function call", n,
+	              call_all<std_function>(opt, n));
+	bench::report("callbacks", "local_function call", n,
+	              call_all<local>(opt, n));
+	bench::report("callbacks", "std::function register", n,
+	              register_all<std_function>(opt, n));
+	bench::report("callbacks", "local_function register", n,
+	              register_all<local>(opt, n));
+}
+
+bench::registrar reg("callbacks", &run);
+}
@@ -0,0 +1,136 @@
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+
+// Clearing a vector: virtual destructor calls vs. the destroy wrapper.
+namespace
+{
+class with_virtual
+{
+public:
+	virtual ~with_virtual()
+	{
+	}
+
+	virtual int value() const = 0;
+};
+
+// No virtual destructor: the stored types are trivially destructible.
+class without_virtual
+{
+public:
+	virtual int value() const = 0;
+
+protected:
+	~without_virtual() = default;
+};
+
+template <class Root>
+class small final : public Root
+{
+public:
+	small(int v) : v(v)
+	{
+	}
+
+	int value() const override
+	{
+		return v;
+	}
+
+private:
+	int v;
+};
+
+template <class Root>
+class large final : public Root
+{
+public:
+	large(int v) : v{v, v, v, v}
+	{
+	}
+
+	int value() const override
+	{
+		return v[0] + v[3];
+	}
+
+private:
+	int v[4];
+};
+}
+
+template <>
+struct allow_nonvirtual_destructor<without_virtual> : std::true_type
+{
+};
+
+namespace
+{
+template <class Root>
+using slot = local_derived<Root, sizeof(large<Root>)>;
+
+template <class Root>
+void fill(std::vector<slot<Root>>& v, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (i % 2)
+			v.emplace_back(emplace_tag_t<small<Root>>(), static_cast<int>(i));
+		else
+			v.emplace_back(emplace_tag_t<large<Root>>(), static_cast<int>(i));
+	}
+}
+
+template <class Root>
+bench::result clear_vector(const bench::options& opt, size_t n)
+{
+	auto v = std::vector<slot<Root>>();
+	v.reserve(n);
+
+	return bench::measure(opt, n, [&] { fill(v, n); }, [&] { v.clear(); });
+}
+
+// The same objects, in slots of the same size, destroyed by virtual calls.
+bench::result clear_virtual(const bench::options& opt, size_t n)
+{
+	using storage = std::aligned_storage_t<sizeof(slot<with_virtual>),
+	                                       alignof(slot<with_virtual>)>;
+
+	auto memory = std::unique_ptr<storage[]>(new storage[n]);
+
+	return bench::measure(opt, n,
+	                      [&] {
+		                      for (size_t i = 0; i < n; ++i)
+		                      {
+			                      const auto t = static_cast<int>(i);
+			                      if (i % 2)
+				                      new (&memory[i]) small<with_virtual>(t);
+			                      else
+				                      new (&memory[i]) large<with_virtual>(t);
+		                      }
+		                  },
+	                      [&] {
+		                      for (size_t i = 0; i < n; ++i)
+		                      {
+			                      reinterpret_cast<with_virtual*>(&memory[i])
+			                          ->~with_virtual();
+		                      }
+		                  });
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	bench::report("clear", "virtual ~Base() calls", n, clear_virtual(opt, n));
+	bench::report("clear", "destroy wrapper", n,
+	              clear_vector<with_virtual>(opt, n));
+	bench::report("clear", "trivially destructible", n,
+	              clear_vector<without_virtual>(opt, n));
+}
+
+bench::registrar reg("clear", &run);
+}
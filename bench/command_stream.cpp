@@ -0,0 +1,181 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_stream.h"
+
+// Command buffer replay: packed stream vs. fixed-size local_derived slots.
+namespace
+{
+struct context
+{
+	uint32_t color = 0;
+	float x = 0, y = 0;
+	float area = 0;
+};
+
+class command
+{
+public:
+	virtual ~command()
+	{
+	}
+
+	virtual void execute(context& c) const = 0;
+};
+
+// Without a virtual destructor: commands are trivially destructible.
+class trivial_command
+{
+public:
+	virtual void execute(context& c) const = 0;
+
+protected:
+	~trivial_command() = default;
+};
+
+template <class Root>
+class set_color final : public Root
+{
+public:
+	set_color(uint32_t rgba) : rgba(rgba)
+	{
+	}
+
+	void execute(context& c) const override
+	{
+		c.color = rgba;
+	}
+
+private:
+	uint32_t rgba;
+};
+
+template <class Root>
+class translate final : public Root
+{
+public:
+	translate(float dx, float dy) : dx(dx), dy(dy)
+	{
+	}
+
+	void execute(context& c) const override
+	{
+		c.x += dx;
+		c.y += dy;
+	}
+
+private:
+	float dx, dy;
+};
+
+// The large, rare command that sets the slot size.
+template <class Root>
+class draw_polygon final : public Root
+{
+public:
+	draw_polygon(float scale)
+	{
+		for (int i = 0; i < 16; ++i)
+			points[i] = scale * static_cast<float>(i);
+	}
+
+	void execute(context& c) const override
+	{
+		auto a = 0.0f;
+		for (int i = 0; i + 1 < 16; i += 2)
+			a += points[i] * points[i + 1];
+		c.area += a;
+	}
+
+private:
+	float points[16];
+};
+
+using slot = local_derived<command, sizeof(draw_polygon<command>)>;
+
+// Records n commands: mostly small ones, 5% polygons.
+template <class Root, class Record>
+void record(size_t n, Record&& rec)
+{
+	auto rng = std::mt19937(42);
+	auto percent = std::uniform_int_distribution<int>(0, 99);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto p = percent(rng);
+		const auto f = static_cast<float>(i % 100);
+
+		if (p < 50)
+			rec(set_color<Root>(static_cast<uint32_t>(i)));
+		else if (p < 95)
+			rec(translate<Root>(f, -f));
+		else
+			rec(draw_polygon<Root>(f));
+	}
+}
+
+// Measures re-recording a stream and clearing it.
+template <class Root>
+bench::result clear_stream(const bench::options& opt, size_t n)
+{
+	auto stream = local_derived_stream<Root>();
+
+	return bench::measure(opt, n,
+	                      [&] {
+		                      record<Root>(n, [&](auto&& c) {
+			                      stream.push_back(std::move(c));
+			                  });
+		                  },
+	                      [&] { stream.clear(); });
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	auto slots = std::vector<slot>();
+	slots.reserve(n);
+	record<command>(n, [&](auto&& c) { slots.emplace_back(std::move(c)); });
+
+	auto stream = local_derived_stream<command>();
+	record<command>(n, [&](auto&& c) { stream.push_back(std::move(c)); });
+
+	std::printf("command_stream: %zu bytes in slots, %zu bytes in stream\n",
+	            slots.size() * sizeof(slot), stream.bytes_used());
+
+	const auto vector_replay = bench::measure(opt, n, [&] {
+		auto c = context();
+		for (const auto& x : slots)
+			x->execute(c);
+		bench::keep(c);
+	});
+
+	const auto stream_replay = bench::measure(opt, n, [&] {
+		auto c = context();
+		for (const auto& x : stream)
+			x.execute(c);
+		bench::keep(c);
+	});
+
+	const auto stream_for_each = bench::measure(opt, n, [&] {
+		auto c = context();
+		stream.for_each([&](const command& x) { x.execute(c); });
+		bench::keep(c);
+	});
+
+	bench::report("command_stream", "vector<local_derived> replay", n,
+	              vector_replay);
+	bench::report("command_stream", "local_derived_stream replay", n,
+	              stream_replay);
+	bench::report("command_stream", "local_derived_stream for_each", n,
+	              stream_for_each);
+	bench::report("command_stream", "clear, virtual destructor", n,
+	              clear_stream<command>(opt, n));
+	bench::report("command_stream", "clear, trivially destructible", n,
+	              clear_stream<trivial_command>(opt, n));
+}
+
+bench::registrar reg("command_stream", &run);
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "compacting_pool.h"
+
+/*
+    A compacting_pool after a long run: 90% of the objects were erased at
+    random. Compares iterating the sparse pool with iterating it after
+    compaction, and reports the cost of compacting in 100 us slices.
+    Iteration and compaction are per live object.
+*/
+namespace
+{
+class entity
+{
+public:
+	virtual ~entity()
+	{
+	}
+
+	virtual uint64_t update() const = 0;
+};
+
+class small_entity final : public entity
+{
+public:
+	explicit small_entity(uint64_t v) : v(v)
+	{
+	}
+
+	uint64_t update() const override
+	{
+		return v;
+	}
+
+private:
+	uint64_t v;
+};
+
+class large_entity final : public entity
+{
+public:
+	explicit large_entity(uint64_t v) : v{v, v + 1, v + 2, v + 3}
+	{
+	}
+
+	uint64_t update() const override
+	{
+		return v[0] + v[3];
+	}
+
+private:
+	uint64_t v[4];
+};
+
+using pool = compacting_pool<entity, sizeof(large_entity)>;
+
+const auto slice = std::chrono::microseconds(100);
+
+// Fills p with n objects, then erases all but every tenth, at random.
+void fill_sparse(pool& p, size_t n, std::vector<pool_handle>& kept)
+{
+	p.clear();
+	kept.clear();
+
+	auto handles = std::vector<pool_handle>();
+	handles.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		handles.push_back(i % 3 ? p.insert<small_entity>(i)
+		                        : p.insert<large_entity>(i));
+	}
+
+	auto rng = std::mt19937_64(9);
+	std::shuffle(handles.begin(), handles.end(), rng);
+
+	const auto keep = n / 10;
+	for (size_t i = keep; i < n; ++i)
+		p.erase(handles[i]);
+	kept.assign(handles.begin(), handles.begin() + keep);
+}
+
+void print(const char* when, const pool_fragmentation& f)
+{
+	std::printf("  %s: %zu live in a span of %zu slots, %zu holes, "
+	            "density %.2f\n",
+	            when, f.live, f.span, f.holes(), f.density());
+}
+
+bench::result iterate(const bench::options& opt, const pool& p)
+{
+	return bench::measure(opt, p.size(), [&] {
+		auto sum = uint64_t(0);
+		p.for_each([&](const entity& e) { sum += e.update(); });
+		bench::keep(sum);
+	});
+}
+
+bench::result lookup(const bench::options& opt,
+                     const pool& p,
+                     const std::vector<pool_handle>& handles)
+{
+	return bench::measure(opt, handles.size(), [&] {
+		auto sum = uint64_t(0);
+		for (auto h : handles)
+			sum += p.get(h)->update();
+		bench::keep(sum);
+	});
+}
+
+void run(const bench::options& opt)
+{
+	pool p;
+	auto kept = std::vector<pool_handle>();
+	fill_sparse(p, opt.elements, kept);
+	print("before", p.fragmentation());
+
+	bench::report("compaction", "iterate, sparse", p.size(), iterate(opt, p));
+	bench::report("compaction", "handle lookup, sparse", kept.size(),
+	              lookup(opt, p, kept));
+
+	auto slices = size_t(0);
+	auto longest = std::chrono::steady_clock::duration::zero();
+	const auto compact = bench::measure(
+	    opt, kept.size(), [&] { fill_sparse(p, opt.elements, kept); },
+	    [&] {
+		    slices = 0;
+		    longest = std::chrono::steady_clock::duration::zero();
+
+		    auto done = false;
+		    while (!done)
+		    {
+			    const auto start = std::chrono::steady_clock::now();
+			    done = p.compact_for(slice);
+			    longest = std::max(longest, std::chrono::steady_clock::now() - start);
+			    ++slices;
+		    }
+	    });
+
+	bench::report("compaction", "compact, 100 us slices", kept.size(), compact);
+	std::printf("  %zu slices, longest %.1f us\n", slices,
+	            std::chrono::duration<double, std::micro>(longest).count());
+	print("after", p.fragmentation());
+
+	bench::report("compaction", "iterate, compacted", p.size(), iterate(opt, p));
+	bench::report("compaction", "handle lookup, compacted", kept.size(),
+	              lookup(opt, p, kept));
+}
+
+bench::registrar reg("compaction", &run);
+}
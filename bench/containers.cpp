@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <random>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "simple_hierarchy.h"
+
+// Basic operations on std::vector<local_derived> of simple_hierarchy types.
+namespace
+{
+using namespace simple_hierarchy;
+
+const auto S = sizeof(derived21);
+
+using ld = local_derived<base, S>;
+
+// Fills a vector with n objects of randomly chosen types.
+std::vector<ld> make_objects(size_t n)
+{
+	auto rng = std::mt19937(42);
+	auto kind = std::uniform_int_distribution<int>(0, 6);
+
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto t = static_cast<int>(i % 100);
+
+		switch (kind(rng))
+		{
+		case 0:
+			v.emplace_back(emplace_tag_t<base>(), t);
+			break;
+		case 1:
+			v.emplace_back(emplace_tag_t<derived1>(), "d1");
+			break;
+		case 2:
+			v.emplace_back(emplace_tag_t<derived11>(), float(t));
+			break;
+		case 3:
+			v.emplace_back(emplace_tag_t<derived12>(), short(t));
+			break;
+		case 4:
+			v.emplace_back(emplace_tag_t<derived2>(), double(t));
+			break;
+		case 5:
+			v.emplace_back(emplace_tag_t<derived21>(), "d21");
+			break;
+		default:
+			v.emplace_back(emplace_tag_t<derived22>(), double(t));
+			break;
+		}
+	}
+	return v;
+}
+
+// Sums the Base subobject addresses: offset handling only, no calls.
+void iterate(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_objects(n);
+
+	const auto r = bench::measure(opt, n, [&] {
+		auto sum = uintptr_t(0);
+		for (const auto& x : v)
+			sum += reinterpret_cast<uintptr_t>(x.get());
+		bench::keep(sum);
+	});
+
+	bench::report("containers", "iterate get()", n, r);
+}
+
+// Swaps neighbouring elements.
+void swap_pairs(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_objects(n);
+
+	const auto r = bench::measure(opt, n, [&] {
+		for (size_t i = 0; i + 1 < v.size(); i += 2)
+			swap(v[i], v[i + 1]);
+		bench::keep(v);
+	});
+
+	bench::report("containers", "swap pairs", n, r);
+}
+
+// Sorts by dynamic type, reshuffled before each run.
+void sort_by_type(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_objects(n);
+	auto rng = std::mt19937(7);
+
+	const auto by_type = [](const ld& a, const ld& b) {
+		return typeid(*a).before(typeid(*b));
+	};
+
+	const auto r = bench::measure(opt, n,
+	                              [&] { std::shuffle(v.begin(), v.end(), rng); },
+	                              [&] {
+		                              std::sort(v.begin(), v.end(), by_type);
+		                              bench::keep(v);
+		                          });
+
+	bench::report("containers", "std::sort by type", n, r);
+}
+
+// Calls the virtual message() on every element.
+void virtual_call(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_objects(n);
+
+	const auto r = bench::measure(opt, n, [&] {
+		auto sum = size_t(0);
+		for (const auto& x : v)
+			sum += x->message().size();
+		bench::keep(sum);
+	});
+
+	bench::report("containers", "virtual message()", n, r);
+}
+
+bench::registrar reg_iterate("containers/iterate", &iterate);
+bench::registrar reg_swap("containers/swap", &swap_pairs);
+bench::registrar reg_sort("containers/sort", &sort_by_type);
+bench::registrar reg_call("containers/virtual_call", &virtual_call);
+}
@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "local_coroutine.h"
+
+// Spawning and resuming coroutines: pooled frames vs. heap frames.
+namespace
+{
+const int yields = 4;
+
+local_task pooled(frame_allocator& frames, local_scheduler& scheduler, int& sum)
+{
+	for (int i = 0; i < yields; ++i)
+	{
+		sum += i;
+		co_await scheduler.yield();
+	}
+}
+
+local_task heap(local_scheduler& scheduler, int& sum)
+{
+	for (int i = 0; i < yields; ++i)
+	{
+		sum += i;
+		co_await scheduler.yield();
+	}
+}
+
+// Tasks spawned per batch; the pool holds one batch.
+const size_t batch = 1024;
+
+bench::result spawn_pooled(const bench::options& opt, size_t n)
+{
+	static local_frame_pool<128, batch> pool;
+	local_scheduler scheduler;
+	int sum = 0;
+
+	auto r = bench::measure(opt, n, [&] {
+		for (size_t done = 0; done < n; done += batch)
+		{
+			for (size_t i = 0; i < batch; ++i)
+				scheduler.spawn(pooled(pool, scheduler, sum));
+			scheduler.run();
+		}
+	});
+
+	bench::keep(sum);
+	if (pool.overflows())
+		std::printf("  (%zu frames overflowed the pool)\n", pool.overflows());
+	return r;
+}
+
+bench::result spawn_heap(const bench::options& opt, size_t n)
+{
+	local_scheduler scheduler;
+	int sum = 0;
+
+	auto r = bench::measure(opt, n, [&] {
+		for (size_t done = 0; done < n; done += batch)
+		{
+			for (size_t i = 0; i < batch; ++i)
+				scheduler.spawn(heap(scheduler, sum));
+			scheduler.run();
+		}
+	});
+
+	bench::keep(sum);
+	return r;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	bench::report("coroutine", "heap frames", n, spawn_heap(opt, n));
+	bench::report("coroutine", "local_frame_pool", n, spawn_pooled(opt, n));
+}
+
+bench::registrar reg("coroutine", &run);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// Hardware counters for the benchmark harness, via Linux perf_event_open.
+namespace bench
+{
+
+enum counter_id : size_t
+{
+	cycles,
+	instructions,
+	l1d_misses,
+	llc_misses,
+	branch_misses,
+	counter_count
+};
+
+// Short column names, indexed by counter_id.
+inline const char* counter_name(size_t id)
+{
+	static const char* names[counter_count] = {"cycles", "instr", "L1D-miss",
+	                                           "LLC-miss", "br-miss"};
+	return names[id];
+}
+
+/*
+     A set of counters, each opened independently, so that one missing
+    event (e.g. LLC on a VM) doesn't disable the others. If perf events
+    are unavailable (other OS, container, perf_event_paranoid), every
+    counter reports available() == false and the harness falls back to
+    wall-clock time only.
+
+     Counters are inherited: they count the opening thread, and threads
+    it creates afterwards, such as the workers of a multi-threaded case.
+    Threads that already existed when the counters were opened are not
+    counted; the harness opens them before running any case.
+*/
+class counters
+{
+public:
+	counters()
+	{
+		for (auto& fd : fds)
+			fd = -1;
+
+#if defined(__linux__)
+		const auto cache_miss = [](uint64_t cache) {
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		};
+
+		fds[cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		fds[instructions] =
+		    open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		fds[l1d_misses] =
+		    open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+		fds[llc_misses] =
+		    open(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+		fds[branch_misses] =
+		    open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+	}
+
+	~counters()
+	{
+#if defined(__linux__)
+		for (auto fd : fds)
+		{
+			if (fd != -1)
+				close(fd);
+		}
+#endif
+	}
+
+	counters(const counters&) = delete;
+	counters& operator=(const counters&) = delete;
+
+	// Returns true if at least one counter could be opened.
+	bool any_available() const noexcept
+	{
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			if (available(i))
+				return true;
+		}
+		return false;
+	}
+
+	bool available(size_t id) const noexcept
+	{
+		return fds[id] != -1;
+	}
+
+	// Resets and enables all open counters.
+	void start() noexcept
+	{
+#if defined(__linux__)
+		for (auto fd : fds)
+		{
+			if (fd != -1)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	// Disables all open counters and reads their values.
+	void stop() noexcept
+	{
+#if defined(__linux__)
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			values[i] = 0;
+			if (fds[i] != -1)
+			{
+				ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+				if (read(fds[i], &values[i], sizeof(values[i])) !=
+				    sizeof(values[i]))
+					values[i] = 0;
+			}
+		}
+#endif
+	}
+
+	// Value of a counter after the last stop().
+	uint64_t value(size_t id) const noexcept
+	{
+		return values[id];
+	}
+
+private:
+#if defined(__linux__)
+	/*
+	    Opens one user-space counter for this thread and the threads it
+	    creates later, returns -1 on failure.
+	*/
+	static int open(uint32_t type, uint64_t config)
+	{
+		auto attr = perf_event_attr();
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1; // reads and ioctls cover the inherited counters
+
+		const auto fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		return fd < 0 ? -1 : static_cast<int>(fd);
+	}
+#endif
+
+	int fds[counter_count];
+	uint64_t values[counter_count] = {};
+};
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "retirement_queue.h"
+
+/*
+    Latency of releasing objects whose destructors free memory, on the
+    hot path. Each operation gives up one object that owns eight heap
+    strings: either destroying it in place, or retiring it to a
+    retirement_queue drained by a background thread or at a quiet point
+    between rounds. Reports the mean and the tail of the per-operation
+    latency.
+*/
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+class resource
+{
+public:
+	virtual ~resource()
+	{
+	}
+};
+
+class session final : public resource
+{
+public:
+	explicit session(size_t id)
+	{
+		for (size_t i = 0; i < 8; ++i)
+			fields.push_back(std::string(48, char('a' + (id + i) % 26)));
+	}
+
+private:
+	std::vector<std::string> fields;
+};
+
+using value_type = local_derived<resource, sizeof(session)>;
+using queue = retirement_queue<resource, sizeof(session)>;
+
+const size_t round_size = 4096;
+
+enum class release
+{
+	destroy,
+	retire_background,
+	retire_drain
+};
+
+// Prints the mean and percentiles of the per-operation latencies.
+void summarize(const char* variant, std::vector<int64_t>& latencies)
+{
+	auto total = int64_t(0);
+	for (auto l : latencies)
+		total += l;
+
+	const auto percentile = [&](size_t per_mille) {
+		const auto k = std::min(latencies.size() * per_mille / 1000,
+		                        latencies.size() - 1);
+		std::nth_element(latencies.begin(), latencies.begin() + k,
+		                 latencies.end());
+		return static_cast<long long>(latencies[k]);
+	};
+
+	auto r = bench::result();
+	r.ns = static_cast<double>(total) / static_cast<double>(latencies.size());
+	bench::report("deferred_destruction", variant, latencies.size(), r);
+	std::printf("  p50 %lld ns, p99 %lld ns, p99.9 %lld ns\n", percentile(500),
+	            percentile(990), percentile(999));
+}
+
+void run_case(const char* variant, release how, size_t operations)
+{
+	queue q;
+	if (how == release::retire_background)
+		q.start();
+
+	auto objects = std::vector<value_type>();
+	objects.reserve(round_size);
+
+	auto latencies = std::vector<int64_t>();
+	latencies.reserve(operations);
+
+	for (size_t done = 0; done < operations;)
+	{
+		// build the next round, untimed
+		objects.clear();
+		const auto n = std::min(round_size, operations - done);
+		for (size_t i = 0; i < n; ++i)
+			objects.emplace_back(emplace_tag_t<session>(), done + i);
+
+		for (auto& o : objects)
+		{
+			const auto start = clock_type::now();
+
+			if (how == release::destroy)
+			{
+				value_type dying(std::move(o));
+			}
+			else
+				q.retire(std::move(o));
+
+			const auto stop = clock_type::now();
+			latencies.push_back(
+			    std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+			        .count());
+		}
+		done += n;
+
+		// quiet point between rounds
+		if (how == release::retire_drain)
+		{
+			q.flush();
+			q.drain();
+		}
+	}
+
+	summarize(variant, latencies);
+}
+
+void run(const bench::options& opt)
+{
+	run_case("destroy in place", release::destroy, opt.elements);
+	run_case("retire, drain in background", release::retire_background,
+	         opt.elements);
+	run_case("retire, drain at quiet point", release::retire_drain,
+	         opt.elements);
+}
+
+bench::registrar reg("deferred_destruction", &run);
+}
@@ -0,0 +1,139 @@
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_dispatch.h"
+
+// Virtual call vs. dispatch_likely when one type dominates.
+namespace
+{
+class shape
+{
+public:
+	virtual ~shape()
+	{
+	}
+
+	virtual double area() const = 0;
+};
+
+class circle final : public shape
+{
+public:
+	circle(double r) : r(r)
+	{
+	}
+
+	double area() const override
+	{
+		return 3.14159265358979 * r * r;
+	}
+
+private:
+	double r;
+};
+
+class square final : public shape
+{
+public:
+	square(double a) : a(a)
+	{
+	}
+
+	double area() const override
+	{
+		return a * a;
+	}
+
+private:
+	double a;
+};
+
+class rectangle final : public shape
+{
+public:
+	rectangle(double a, double b) : a(a), b(b)
+	{
+	}
+
+	double area() const override
+	{
+		return a * b;
+	}
+
+private:
+	double a;
+	double b;
+};
+
+using ld = local_derived<shape, sizeof(rectangle)>;
+
+// n shapes: 80% circles, 15% squares, 5% rectangles, shuffled.
+std::vector<ld> make_shapes(size_t n)
+{
+	auto rng = std::mt19937(42);
+	auto percent = std::uniform_int_distribution<int>(0, 99);
+
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto x = static_cast<double>(i % 100);
+		const auto p = percent(rng);
+
+		if (p < 80)
+			v.emplace_back(emplace_tag_t<circle>(), x);
+		else if (p < 95)
+			v.emplace_back(emplace_tag_t<square>(), x);
+		else
+			v.emplace_back(emplace_tag_t<rectangle>(), x, x + 1);
+	}
+	return v;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_shapes(n);
+
+	const auto area = [](const auto& s) { return s.area(); };
+
+	const auto virtual_call = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : v)
+			sum += x->area();
+		bench::keep(sum);
+	});
+
+	const auto likely1 = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : v)
+			sum += dispatch_likely<circle>(x, area);
+		bench::keep(sum);
+	});
+
+	const auto likely2 = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : v)
+			sum += dispatch_likely<circle, square>(x, area);
+		bench::keep(sum);
+	});
+
+	auto site = dispatch_histogram("bench");
+
+	const auto profiled = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : v)
+			sum += dispatch_likely<circle, square>(x, area, site);
+		bench::keep(sum);
+	});
+
+	bench::report("dispatch_likely", "virtual call", n, virtual_call);
+	bench::report("dispatch_likely", "likely<circle>", n, likely1);
+	bench::report("dispatch_likely", "likely<circle, square>", n, likely2);
+	bench::report("dispatch_likely", "likely<...> + histogram", n, profiled);
+}
+
+bench::registrar reg("dispatch_likely", &run);
+}
@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "local_result.h"
+
+/*
+    Cost of reporting an error through three levels of calls: the
+    innermost parser fails, and each caller passes the error on. The
+    error carries a position and a code, behind a virtual interface.
+    Compares throwing it, returning std::unique_ptr<error>, and returning
+    a local_result that holds it in-place. The success path is reported
+    for reference. The outermost call of each chain goes through a
+    function pointer, so the compiler can't fuse the allocation of an
+    error with its release.
+*/
+namespace
+{
+class error
+{
+public:
+	virtual ~error()
+	{
+	}
+
+	virtual uint64_t code() const = 0;
+};
+
+class syntax_error final : public error
+{
+public:
+	syntax_error(uint64_t position, uint64_t expected)
+	  : position(position), expected(expected)
+	{
+	}
+
+	uint64_t code() const override
+	{
+		return position * 31 + expected;
+	}
+
+private:
+	uint64_t position;
+	uint64_t expected;
+};
+
+// Inputs divisible by 8 are valid.
+bool valid(uint64_t input)
+{
+	return input % 8 == 0;
+}
+
+/* exceptions */
+
+class syntax_exception
+{
+public:
+	syntax_exception(uint64_t position, uint64_t expected)
+	  : e(position, expected)
+	{
+	}
+
+	syntax_error e;
+};
+
+uint64_t parse_throw(uint64_t input)
+{
+	if (!valid(input))
+		throw syntax_exception(input, 8);
+	return input / 8;
+}
+
+uint64_t validate_throw(uint64_t input)
+{
+	return parse_throw(input) + 1;
+}
+
+uint64_t load_throw(uint64_t input)
+{
+	return validate_throw(input) * 2;
+}
+
+/* std::unique_ptr */
+
+std::unique_ptr<error> parse_ptr(uint64_t input, uint64_t& out)
+{
+	if (!valid(input))
+		return std::make_unique<syntax_error>(input, 8);
+	out = input / 8;
+	return nullptr;
+}
+
+std::unique_ptr<error> validate_ptr(uint64_t input, uint64_t& out)
+{
+	if (auto e = parse_ptr(input, out))
+		return e;
+	out += 1;
+	return nullptr;
+}
+
+std::unique_ptr<error> load_ptr(uint64_t input, uint64_t& out)
+{
+	if (auto e = validate_ptr(input, out))
+		return e;
+	out *= 2;
+	return nullptr;
+}
+
+/* local_result */
+
+using result = local_result<uint64_t, error, sizeof(syntax_error)>;
+
+result parse_local(uint64_t input)
+{
+	if (!valid(input))
+		return syntax_error(input, 8);
+	return input / 8;
+}
+
+result validate_local(uint64_t input)
+{
+	auto r = parse_local(input);
+	if (!r)
+		return std::move(r).error();
+	return *r + 1;
+}
+
+result load_local(uint64_t input)
+{
+	auto r = validate_local(input);
+	if (!r)
+		return std::move(r).error();
+	return *r * 2;
+}
+
+std::vector<uint64_t> make_inputs(size_t n, bool fail)
+{
+	auto inputs = std::vector<uint64_t>(n);
+	for (size_t i = 0; i < n; ++i)
+		inputs[i] = 8 * i + (fail ? 1 + i % 7 : 0);
+	return inputs;
+}
+
+void run_path(const bench::options& opt, const char* path, bool fail)
+{
+	const auto inputs = make_inputs(opt.elements, fail);
+	const auto n = inputs.size();
+	auto variant = std::string();
+
+	auto load_throw_ptr = &load_throw;
+	auto load_ptr_ptr = &load_ptr;
+	auto load_local_ptr = &load_local;
+	bench::keep(load_throw_ptr);
+	bench::keep(load_ptr_ptr);
+	bench::keep(load_local_ptr);
+
+	variant = std::string(path) + ", exception";
+	bench::report("error_path", variant.c_str(), n, bench::measure(opt, n, [&] {
+		              auto sum = uint64_t(0);
+		              for (auto input : inputs)
+		              {
+			              try
+			              {
+				              sum += load_throw_ptr(input);
+			              }
+			              catch (const syntax_exception& x)
+			              {
+				              sum += x.e.code();
+			              }
+		              }
+		              bench::keep(sum);
+	              }));
+
+	variant = std::string(path) + ", unique_ptr<error>";
+	bench::report("error_path", variant.c_str(), n, bench::measure(opt, n, [&] {
+		              auto sum = uint64_t(0);
+		              for (auto input : inputs)
+		              {
+			              auto out = uint64_t(0);
+			              if (auto e = load_ptr_ptr(input, out))
+				              sum += e->code();
+			              else
+				              sum += out;
+		              }
+		              bench::keep(sum);
+	              }));
+
+	variant = std::string(path) + ", local_result";
+	bench::report("error_path", variant.c_str(), n, bench::measure(opt, n, [&] {
+		              auto sum = uint64_t(0);
+		              for (auto input : inputs)
+		              {
+			              auto r = load_local_ptr(input);
+			              sum += r ? *r : r.error()->code();
+		              }
+		              bench::keep(sum);
+	              }));
+}
+
+void run(const bench::options& opt)
+{
+	run_path(opt, "failure", true);
+	run_path(opt, "success", false);
+}
+
+bench::registrar reg("error_path", &run);
+}
@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "event_scheduler.h"
+
+// Hold model at 1M pending events: pop the earliest, schedule a new one.
+namespace
+{
+class event
+{
+public:
+	virtual ~event()
+	{
+	}
+
+	virtual uint64_t delay() const = 0;
+
+	uint64_t time = 0; // used by the priority_queue baseline only
+};
+
+class short_delay final : public event
+{
+public:
+	short_delay(uint64_t d) : d(d)
+	{
+	}
+
+	uint64_t delay() const override
+	{
+		return d;
+	}
+
+private:
+	uint64_t d;
+};
+
+class long_delay final : public event
+{
+public:
+	long_delay(uint64_t d, uint64_t extra) : d(d), extra(extra)
+	{
+	}
+
+	uint64_t delay() const override
+	{
+		return d + extra;
+	}
+
+private:
+	uint64_t d, extra;
+};
+
+const size_t pending = size_t(1) << 20;
+
+// Pseudo-random delays, the same for both variants.
+std::vector<uint64_t> make_delays(size_t n)
+{
+	auto rng = std::mt19937_64(3);
+	auto delay = std::uniform_int_distribution<uint64_t>(1, 1000000);
+
+	auto v = std::vector<uint64_t>(n);
+	for (auto& d : v)
+		d = delay(rng);
+	return v;
+}
+
+bench::result run_scheduler(const bench::options& opt, size_t n)
+{
+	const auto delays = make_delays(pending + n);
+
+	auto s = event_scheduler<event, sizeof(long_delay)>();
+	s.reserve(pending + 1);
+
+	auto schedule = [&](uint64_t now, size_t i) {
+		if (i % 2)
+			s.schedule<short_delay>(now + delays[i], delays[i] / 2);
+		else
+			s.schedule<long_delay>(now + delays[i], delays[i] / 4, 7);
+	};
+
+	for (size_t i = 0; i < pending; ++i)
+		schedule(0, i);
+
+	auto next = pending;
+
+	return bench::measure(opt, n, [&] {
+		auto sum = uint64_t(0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			s.run_next([&](uint64_t now, event& e) {
+				sum += e.delay();
+				schedule(now, next++ % delays.size());
+			});
+		}
+		bench::keep(sum);
+	});
+}
+
+struct later
+{
+	bool operator()(const std::unique_ptr<event>& a,
+	                const std::unique_ptr<event>& b) const
+	{
+		return a->time > b->time;
+	}
+};
+
+bench::result run_priority_queue(const bench::options& opt, size_t n)
+{
+	const auto delays = make_delays(pending + n);
+
+	auto storage = std::vector<std::unique_ptr<event>>();
+	storage.reserve(pending + 1);
+	auto q = std::priority_queue<std::unique_ptr<event>,
+	                             std::vector<std::unique_ptr<event>>, later>(
+	    later(), std::move(storage));
+
+	auto schedule = [&](uint64_t now, size_t i) {
+		auto e = std::unique_ptr<event>();
+		if (i % 2)
+			e.reset(new short_delay(delays[i] / 2));
+		else
+			e.reset(new long_delay(delays[i] / 4, 7));
+		e->time = now + delays[i];
+		q.push(std::move(e));
+	};
+
+	for (size_t i = 0; i < pending; ++i)
+		schedule(0, i);
+
+	auto next = pending;
+
+	return bench::measure(opt, n, [&] {
+		auto sum = uint64_t(0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			// top() is const; the event is destroyed after pop()
+			const auto now = q.top()->time;
+			sum += q.top()->delay();
+			q.pop();
+			schedule(now, next++ % delays.size());
+		}
+		bench::keep(sum);
+	});
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	bench::report("event_scheduler", "priority_queue<unique_ptr>", n,
+	              run_priority_queue(opt, n));
+	bench::report("event_scheduler", "event_scheduler (4-ary)", n,
+	              run_scheduler(opt, n));
+}
+
+bench::registrar reg("event_scheduler", &run);
+}
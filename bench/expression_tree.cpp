@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "node_arena.h"
+
+/*
+    Evaluation of one large generated expression tree. The baseline owns
+    its children through std::unique_ptr and is built while other heap
+    allocations come and go, as in a long-running engine; the node_arena
+    holds the same tree in one array, in evaluation order. Run with
+    --counters to see the cache misses.
+*/
+namespace
+{
+enum kind
+{
+	constant_kind,
+	variable_kind,
+	plus_kind,
+	minus_kind,
+	times_kind,
+	max_kind
+};
+
+// One node of the tree in post-order (reverse Polish notation).
+struct rpn
+{
+	kind k;
+	double value;   // constant_kind
+	uint32_t slot;  // variable_kind
+};
+
+const size_t variable_count = 16;
+
+// Appends a random tree of n nodes, children before parents.
+void generate(size_t n, std::mt19937_64& rng, std::vector<rpn>& out)
+{
+	if (n < 3)
+	{
+		const auto leaf = rng() % 2 == 0 ? constant_kind : variable_kind;
+		out.push_back(rpn{leaf, double(rng() % 100) / 10.0,
+		                  uint32_t(rng() % variable_count)});
+		return;
+	}
+
+	// split the rest between both sides, within 1:3, so depth is O(log n)
+	const auto rest = n - 1;
+	const auto left = rest / 4 + rng() % (rest / 2 + 1);
+	generate(left, rng, out);
+	generate(rest - left, rng, out);
+	out.push_back(rpn{kind(plus_kind + rng() % 4), 0.0, 0});
+}
+
+double apply(kind k, double l, double r)
+{
+	switch (k)
+	{
+	case plus_kind: return l + r;
+	case minus_kind: return l - r;
+	case times_kind: return l * r * 0.5;
+	default: return std::max(l, r);
+	}
+}
+
+/* std::unique_ptr */
+
+class heap_expr
+{
+public:
+	virtual ~heap_expr()
+	{
+	}
+
+	virtual double eval(const double* vars) const = 0;
+};
+
+class heap_constant final : public heap_expr
+{
+public:
+	explicit heap_constant(double v) : v(v)
+	{
+	}
+
+	double eval(const double*) const override
+	{
+		return v;
+	}
+
+private:
+	double v;
+};
+
+class heap_variable final : public heap_expr
+{
+public:
+	explicit heap_variable(uint32_t slot) : slot(slot)
+	{
+	}
+
+	double eval(const double* vars) const override
+	{
+		return vars[slot];
+	}
+
+private:
+	uint32_t slot;
+};
+
+template <kind K>
+class heap_binary final : public heap_expr
+{
+public:
+	heap_binary(std::unique_ptr<heap_expr> l, std::unique_ptr<heap_expr> r)
+	  : l(std::move(l)), r(std::move(r))
+	{
+	}
+
+	double eval(const double* vars) const override
+	{
+		return apply(K, l->eval(vars), r->eval(vars));
+	}
+
+private:
+	std::unique_ptr<heap_expr> l, r;
+};
+
+std::unique_ptr<heap_expr> make_heap_binary(kind k,
+                                            std::unique_ptr<heap_expr> l,
+                                            std::unique_ptr<heap_expr> r)
+{
+	switch (k)
+	{
+	case plus_kind:
+		return std::make_unique<heap_binary<plus_kind>>(std::move(l), std::move(r));
+	case minus_kind:
+		return std::make_unique<heap_binary<minus_kind>>(std::move(l),
+		                                                 std::move(r));
+	case times_kind:
+		return std::make_unique<heap_binary<times_kind>>(std::move(l),
+		                                                 std::move(r));
+	default:
+		return std::make_unique<heap_binary<max_kind>>(std::move(l), std::move(r));
+	}
+}
+
+/*
+    Builds the tree with other allocations of 16 to 256 bytes between
+    its nodes. About half of them stay alive in junk.
+*/
+std::unique_ptr<heap_expr> build_heap(const std::vector<rpn>& nodes,
+                                      std::vector<std::unique_ptr<char[]>>& junk)
+{
+	auto rng = std::mt19937_64(3);
+	auto stack = std::vector<std::unique_ptr<heap_expr>>();
+
+	for (const auto& n : nodes)
+	{
+		auto other = std::unique_ptr<char[]>(new char[16 + rng() % 241]);
+		if (rng() % 2 == 0)
+			junk.push_back(std::move(other));
+
+		if (n.k == constant_kind)
+			stack.push_back(std::make_unique<heap_constant>(n.value));
+		else if (n.k == variable_kind)
+			stack.push_back(std::make_unique<heap_variable>(n.slot));
+		else
+		{
+			auto r = std::move(stack.back());
+			stack.pop_back();
+			auto l = std::move(stack.back());
+			stack.pop_back();
+			stack.push_back(make_heap_binary(n.k, std::move(l), std::move(r)));
+		}
+	}
+	return std::move(stack.back());
+}
+
+/* node_arena */
+
+class arena_expr;
+
+using arena = node_arena<arena_expr, 16, alignof(double)>;
+
+class arena_expr
+{
+public:
+	virtual ~arena_expr()
+	{
+	}
+
+	// Evaluates recursively, through the arena.
+	virtual double eval(const arena& a,
+	                    arena::index_type self,
+	                    const double* vars) const = 0;
+
+	// Evaluates from the values of the children.
+	virtual double apply(child_values<double> c, const double* vars) const = 0;
+};
+
+class arena_constant final : public arena_expr
+{
+public:
+	explicit arena_constant(double v) : v(v)
+	{
+	}
+
+	double eval(const arena&, arena::index_type, const double*) const override
+	{
+		return v;
+	}
+
+	double apply(child_values<double>, const double*) const override
+	{
+		return v;
+	}
+
+private:
+	double v;
+};
+
+class arena_variable final : public arena_expr
+{
+public:
+	explicit arena_variable(uint32_t slot) : slot(slot)
+	{
+	}
+
+	double eval(const arena&,
+	            arena::index_type,
+	            const double* vars) const override
+	{
+		return vars[slot];
+	}
+
+	double apply(child_values<double>, const double* vars) const override
+	{
+		return vars[slot];
+	}
+
+private:
+	uint32_t slot;
+};
+
+template <kind K>
+class arena_binary final : public arena_expr
+{
+public:
+	double eval(const arena& a,
+	            arena::index_type self,
+	            const double* vars) const override
+	{
+		const auto c = a.children(self);
+		return ::apply(K, a[c[0]].eval(a, c[0], vars),
+		               a[c[1]].eval(a, c[1], vars));
+	}
+
+	double apply(child_values<double> c, const double*) const override
+	{
+		return ::apply(K, c[0], c[1]);
+	}
+};
+
+void build_arena(const std::vector<rpn>& nodes, arena& a)
+{
+	auto stack = std::vector<arena::index_type>();
+	a.reserve(nodes.size(), nodes.size());
+
+	for (const auto& n : nodes)
+	{
+		if (n.k == constant_kind)
+			stack.push_back(a.add<arena_constant>({}, n.value));
+		else if (n.k == variable_kind)
+			stack.push_back(a.add<arena_variable>({}, n.slot));
+		else
+		{
+			const auto children = stack.data() + stack.size() - 2;
+			arena::index_type parent;
+
+			switch (n.k)
+			{
+			case plus_kind:
+				parent = a.add<arena_binary<plus_kind>>(children, children + 2);
+				break;
+			case minus_kind:
+				parent = a.add<arena_binary<minus_kind>>(children, children + 2);
+				break;
+			case times_kind:
+				parent = a.add<arena_binary<times_kind>>(children, children + 2);
+				break;
+			default:
+				parent = a.add<arena_binary<max_kind>>(children, children + 2);
+				break;
+			}
+
+			stack.resize(stack.size() - 2);
+			stack.push_back(parent);
+		}
+	}
+}
+
+void run(const bench::options& opt)
+{
+	auto rng = std::mt19937_64(17);
+	auto nodes = std::vector<rpn>();
+	generate(opt.elements, rng, nodes);
+
+	auto vars = std::vector<double>(variable_count);
+	for (size_t i = 0; i < variable_count; ++i)
+		vars[i] = double(i) / 8.0;
+
+	{
+		auto junk = std::vector<std::unique_ptr<char[]>>();
+		const auto root = build_heap(nodes, junk);
+
+		bench::report("expression_tree", "unique_ptr<Node>, recursive",
+		              nodes.size(), bench::measure(opt, nodes.size(), [&] {
+			              bench::keep(root->eval(vars.data()));
+		              }));
+	}
+
+	auto a = arena();
+	build_arena(nodes, a);
+	const auto root = a.root();
+
+	bench::report("expression_tree", "node_arena, recursive", nodes.size(),
+	              bench::measure(opt, nodes.size(), [&] {
+		              bench::keep(a[root].eval(a, root, vars.data()));
+	              }));
+
+	auto values = std::vector<double>();
+	bench::report("expression_tree", "node_arena, one pass", nodes.size(),
+	              bench::measure(opt, nodes.size(), [&] {
+		              a.evaluate(values, [&](const arena_expr& e,
+		                                     child_values<double> c) {
+			              return e.apply(c, vars.data());
+		              });
+		              bench::keep(values.back());
+	              }));
+}
+
+bench::registrar reg("expression_tree", &run);
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_algorithm.h"
+
+// Per element virtual update vs. batch kernels over runs of one type.
+namespace
+{
+class particle
+{
+public:
+	virtual ~particle()
+	{
+	}
+
+	virtual void update(float dt) = 0;
+};
+
+class linear final : public particle
+{
+public:
+	linear(float x, float v) : x(x), y(x), vx(v), vy(-v)
+	{
+	}
+
+	void update(float dt) override
+	{
+		x += vx * dt;
+		y += vy * dt;
+	}
+
+	static void process_batch(batch_view<linear> run, float dt)
+	{
+		for (size_t i = 0; i < run.size(); ++i)
+		{
+			auto& p = run[i];
+			p.x += p.vx * dt;
+			p.y += p.vy * dt;
+		}
+	}
+
+private:
+	float x, y, vx, vy;
+};
+
+class damped final : public particle
+{
+public:
+	damped(float x, float v) : x(x), v(v), k(0.5f)
+	{
+	}
+
+	void update(float dt) override
+	{
+		v -= k * v * dt;
+		x += v * dt;
+	}
+
+	static void process_batch(batch_view<damped> run, float dt)
+	{
+		for (size_t i = 0; i < run.size(); ++i)
+		{
+			auto& p = run[i];
+			p.v -= p.k * p.v * dt;
+			p.x += p.v * dt;
+		}
+	}
+
+private:
+	float x, v, k;
+};
+
+using ld = local_derived<particle, sizeof(linear)>;
+
+// n particles, half of each type, sorted by type or shuffled.
+std::vector<ld> make_particles(size_t n, bool shuffled)
+{
+	auto kinds = std::vector<bool>(n);
+	for (size_t i = 0; i < n; ++i)
+		kinds[i] = i < n / 2;
+
+	if (shuffled)
+		std::shuffle(kinds.begin(), kinds.end(), std::mt19937(42));
+
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto x = static_cast<float>(i % 100);
+
+		if (kinds[i])
+			v.emplace_back(emplace_tag_t<linear>(), x, 1.0f);
+		else
+			v.emplace_back(emplace_tag_t<damped>(), x, 1.0f);
+	}
+	return v;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	const auto dt = 0.001f;
+
+	const auto update = [](particle& p, float dt) { p.update(dt); };
+
+	for (const auto shuffled : {false, true})
+	{
+		auto v = make_particles(n, shuffled);
+
+		const auto virtual_call = bench::measure(opt, n, [&] {
+			for (auto& p : v)
+				p->update(dt);
+			bench::keep(v);
+		});
+
+		const auto batched = bench::measure(opt, n, [&] {
+			for_each_batched<linear, damped>(v.begin(), v.end(), update, dt);
+			bench::keep(v);
+		});
+
+		bench::report("for_each_batched",
+		              shuffled ? "virtual, shuffled" : "virtual, sorted", n,
+		              virtual_call);
+		bench::report("for_each_batched",
+		              shuffled ? "batched, shuffled" : "batched, sorted", n,
+		              batched);
+	}
+
+	// type-segregated storage: one contiguous array per type
+
+	auto linears = std::vector<linear>(n / 2, linear(1.0f, 1.0f));
+	auto dampeds = std::vector<damped>(n - n / 2, damped(1.0f, 1.0f));
+
+	const auto segregated = bench::measure(opt, n, [&] {
+		linear::process_batch(
+		    batch_view<linear>(linears.data(), linears.size()), dt);
+		damped::process_batch(
+		    batch_view<damped>(dampeds.data(), dampeds.size()), dt);
+		bench::keep(linears);
+		bench::keep(dampeds);
+	});
+
+	bench::report("for_each_batched", "batched, segregated", n, segregated);
+}
+
+bench::registrar reg("for_each_batched", &run);
+}
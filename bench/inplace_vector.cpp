@@ -0,0 +1,121 @@
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_inplace_vector.h"
+
+// Per-request lists of polymorphic objects: std::vector vs. inplace vector.
+namespace
+{
+class handler
+{
+public:
+	virtual ~handler()
+	{
+	}
+
+	virtual int handle(int request) const = 0;
+};
+
+class add final : public handler
+{
+public:
+	add(int k) : k(k)
+	{
+	}
+
+	int handle(int request) const override
+	{
+		return request + k;
+	}
+
+private:
+	int k;
+};
+
+class mask final : public handler
+{
+public:
+	mask(int m, int k) : m(m), k(k)
+	{
+	}
+
+	int handle(int request) const override
+	{
+		return (request & m) ^ k;
+	}
+
+private:
+	int m, k;
+};
+
+const size_t per_request = 16;
+const size_t S = sizeof(mask);
+
+using slot = local_derived<handler, S>;
+
+// Builds the handler list of one request, runs it, and drops it.
+template <class List>
+int serve(int request)
+{
+	auto list = List();
+
+	for (size_t i = 0; i < per_request; ++i)
+	{
+		const auto k = static_cast<int>(i);
+		if ((request + k) % 3)
+			list.template emplace_back<add>(k);
+		else
+			list.template emplace_back<mask>(0xffff, k);
+	}
+
+	for (const auto& h : list)
+		request = h->handle(request);
+
+	return request;
+}
+
+// std::vector needs emplace_back(emplace_tag_t<U>, args...).
+struct vector_list : std::vector<slot>
+{
+	vector_list()
+	{
+		reserve(per_request);
+	}
+
+	template <class U, class... Args>
+	void emplace_back(Args... args)
+	{
+		std::vector<slot>::emplace_back(emplace_tag_t<U>(), args...);
+	}
+};
+
+using inplace_list = local_derived_inplace_vector<handler, S, per_request>;
+
+template <class List>
+bench::result serve_all(const bench::options& opt, size_t n)
+{
+	const auto requests = (n + per_request - 1) / per_request;
+
+	return bench::measure(opt, requests * per_request, [&] {
+		auto sum = 0;
+		for (size_t r = 0; r < requests; ++r)
+			sum += serve<List>(static_cast<int>(r));
+		bench::keep(sum);
+	});
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	std::printf("inplace_vector: sizeof %zu for %zu slots of %zu bytes\n",
+	            sizeof(inplace_list), per_request, sizeof(slot));
+
+	bench::report("inplace_vector", "std::vector<local_derived>", n,
+	              serve_all<vector_list>(opt, n));
+	bench::report("inplace_vector", "local_derived_inplace_vector", n,
+	              serve_all<inplace_list>(opt, n));
+}
+
+bench::registrar reg("inplace_vector", &run);
+}
@@ -0,0 +1,142 @@
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+
+// Virtual call vs. the cached hot method pointer over a mixed collection.
+namespace
+{
+class shape
+{
+public:
+	virtual ~shape()
+	{
+	}
+
+	virtual double area() const = 0;
+};
+
+class circle final : public shape
+{
+public:
+	circle(double r) : r(r)
+	{
+	}
+
+	double area() const override
+	{
+		return 3.14159265358979 * r * r;
+	}
+
+private:
+	double r;
+};
+
+class square final : public shape
+{
+public:
+	square(double a) : a(a)
+	{
+	}
+
+	double area() const override
+	{
+		return a * a;
+	}
+
+private:
+	double a;
+};
+
+class rectangle final : public shape
+{
+public:
+	rectangle(double a, double b) : a(a), b(b)
+	{
+	}
+
+	double area() const override
+	{
+		return a * b;
+	}
+
+private:
+	double a;
+	double b;
+};
+
+// Hot method policy: shape::area of U, called non-virtually.
+struct area_hot
+{
+	using signature = double();
+
+	template <class U>
+	static double call(U& obj)
+	{
+		return obj.U::area();
+	}
+};
+
+const auto S = sizeof(rectangle);
+
+using plain_ld = local_derived<shape, S>;
+using hot_ld =
+    local_derived<shape, S, alignof(std::max_align_t), uint8_t, area_hot>;
+
+// Fills v with n randomly chosen shapes.
+template <class LD>
+std::vector<LD> make_shapes(size_t n)
+{
+	auto rng = std::mt19937(42);
+	auto kind = std::uniform_int_distribution<int>(0, 2);
+
+	auto v = std::vector<LD>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto x = static_cast<double>(i % 100);
+
+		switch (kind(rng))
+		{
+		case 0:
+			v.emplace_back(emplace_tag_t<circle>(), x);
+			break;
+		case 1:
+			v.emplace_back(emplace_tag_t<square>(), x);
+			break;
+		default:
+			v.emplace_back(emplace_tag_t<rectangle>(), x, x + 1);
+			break;
+		}
+	}
+	return v;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	auto plain = make_shapes<plain_ld>(n);
+	auto hot = make_shapes<hot_ld>(n);
+
+	const auto virtual_ns = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : plain)
+			sum += x->area();
+		bench::keep(sum);
+	});
+
+	const auto hot_ns = bench::measure(opt, n, [&] {
+		auto sum = 0.0;
+		for (const auto& x : hot)
+			sum += x.invoke_hot();
+		bench::keep(sum);
+	});
+
+	bench::report("invoke_hot", "virtual call", n, virtual_ns);
+	bench::report("invoke_hot", "invoke_hot", n, hot_ns);
+}
+
+bench::registrar reg("invoke_hot", &run);
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "simple_hierarchy.h"
+
+/*
+     Dispatch cost as the number of dynamic types grows.
+
+     For K = 1, 2, 4 ... 64 generated siblings of simple_hierarchy::base,
+    calls the virtual depth() on every element of a vector, with the types
+    either shuffled or sorted. Sorted runs keep the indirect branch
+    predictable; shuffled ones show the cost of a megamorphic call site.
+*/
+namespace
+{
+using namespace simple_hierarchy;
+
+const size_t max_types = 64;
+
+// Name tag for the I-th generated type.
+template <size_t I>
+struct index_tag
+{
+	index_tag() : str("T" + std::to_string(I))
+	{
+	}
+	std::string str;
+};
+
+/*
+     The I-th generated type. depth() returns a different constant in
+    each, so identical code folding can't merge the overrides into one
+    call target.
+*/
+template <size_t I>
+class generated final : public derived<base, index_tag<I>, int>
+{
+public:
+	using derived<base, index_tag<I>, int>::derived;
+
+	int depth() const override
+	{
+		return static_cast<int>(I) + 1;
+	}
+};
+
+const auto S = sizeof(generated<0>);
+
+using ld = local_derived<base, S>;
+
+using emplacer = void (*)(std::vector<ld>&, int);
+
+template <size_t I>
+void emplace_generated(std::vector<ld>& v, int tag)
+{
+	v.emplace_back(emplace_tag_t<generated<I>>(), tag);
+}
+
+template <size_t... I>
+std::array<emplacer, sizeof...(I)> make_emplacers(std::index_sequence<I...>)
+{
+	return {{&emplace_generated<I>...}};
+}
+
+// Builds n objects using the first k generated types.
+std::vector<ld> make_objects(size_t n, size_t k, bool shuffled)
+{
+	static const auto emplacers =
+	    make_emplacers(std::make_index_sequence<max_types>());
+
+	auto types = std::vector<size_t>(n);
+	for (size_t i = 0; i < n; ++i)
+		types[i] = i * k / n; // sorted, equal runs
+
+	if (shuffled)
+		std::shuffle(types.begin(), types.end(), std::mt19937(42));
+
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+		emplacers[types[i]](v, static_cast<int>(i));
+
+	return v;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	for (size_t k = 1; k <= max_types; k *= 2)
+	{
+		for (const auto shuffled : {false, true})
+		{
+			auto v = make_objects(n, k, shuffled);
+
+			const auto r = bench::measure(opt, n, [&] {
+				auto sum = 0;
+				for (const auto& x : v)
+					sum += x->depth();
+				bench::keep(sum);
+			});
+
+			const auto variant = std::to_string(k) + " types, " +
+			                     (shuffled ? "shuffled" : "sorted");
+
+			bench::report("megamorphic", variant.c_str(), n, r);
+		}
+	}
+}
+
+bench::registrar reg("megamorphic", &run);
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "parallel_algorithm.h"
+
+/*
+    Scaling of the parallel algorithms with the number of threads, from
+    one to the number of cores, over a vector of local_derived holding
+    three particle types in random order. Each case also runs after the
+    type-sorted pre-pass, which keeps each chunk monomorphic. Prints the
+    speedup over the sequential loop.
+*/
+namespace
+{
+class particle
+{
+public:
+	virtual ~particle()
+	{
+	}
+
+	virtual void step(double dt) = 0;
+	virtual double energy() const = 0;
+};
+
+class ion final : public particle
+{
+public:
+	explicit ion(double v) : v(v), x(0)
+	{
+	}
+
+	void step(double dt) override
+	{
+		x += v * dt;
+		v *= 0.999;
+	}
+
+	double energy() const override
+	{
+		return 0.5 * v * v;
+	}
+
+private:
+	double v, x;
+};
+
+class electron final : public particle
+{
+public:
+	explicit electron(double v) : v(v), x(0), spin(1)
+	{
+	}
+
+	void step(double dt) override
+	{
+		x += v * dt;
+		spin = -spin;
+	}
+
+	double energy() const override
+	{
+		return 0.25 * v * v + spin * 1e-3;
+	}
+
+private:
+	double v, x, spin;
+};
+
+class photon final : public particle
+{
+public:
+	explicit photon(double f) : f(f), phase(0)
+	{
+	}
+
+	void step(double dt) override
+	{
+		phase += f * dt;
+		if (phase > 1)
+			phase -= 1;
+	}
+
+	double energy() const override
+	{
+		return f;
+	}
+
+private:
+	double f, phase;
+};
+
+using ld = local_derived<particle, sizeof(electron)>;
+
+std::vector<ld> make_particles(size_t n)
+{
+	auto rng = std::mt19937_64(11);
+	auto v = std::vector<ld>();
+	v.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto speed = static_cast<double>(rng() % 1000) / 100;
+		switch (rng() % 3)
+		{
+		case 0: v.emplace_back(emplace_tag_t<ion>(), speed); break;
+		case 1: v.emplace_back(emplace_tag_t<electron>(), speed); break;
+		default: v.emplace_back(emplace_tag_t<photon>(), speed); break;
+		}
+	}
+	return v;
+}
+
+// 1, 2, 4, ... up to the number of cores, and the number of cores.
+std::vector<size_t> thread_counts()
+{
+	const auto cores = thread_pool::default_threads();
+	auto counts = std::vector<size_t>();
+	for (size_t t = 1; t < cores; t *= 2)
+		counts.push_back(t);
+	counts.push_back(cores);
+	return counts;
+}
+
+void report(const char* algorithm,
+            const char* layout,
+            const std::string& threads,
+            size_t n,
+            const bench::result& r,
+            double sequential_ns)
+{
+	const auto variant =
+	    std::string(algorithm) + ", " + layout + ", " + threads;
+	bench::report("parallel_scaling", variant.c_str(), n, r);
+	std::printf("  speedup %.2fx\n", sequential_ns / r.ns);
+}
+
+void run_layout(const bench::options& opt,
+                const char* layout,
+                std::vector<ld>& v)
+{
+	const auto n = v.size();
+
+	const auto step = [](ld& x) { x->step(0.01); };
+	const auto energy = [](const ld& x) { return x->energy(); };
+	const auto plus = [](double a, double b) { return a + b; };
+	const auto fast = [](const ld& x) { return x->energy() > 2.5; };
+
+	// sequential loops, for reference
+
+	const auto for_each_ns = bench::measure(opt, n, [&] {
+		                         std::for_each(v.begin(), v.end(), step);
+	                         }).ns;
+
+	const auto reduce_ns = bench::measure(opt, n, [&] {
+		                       auto sum = 0.0;
+		                       for (auto& x : v)
+			                       sum += energy(x);
+		                       bench::keep(sum);
+	                       }).ns;
+
+	const auto count_ns = bench::measure(opt, n, [&] {
+		                      bench::keep(std::count_if(v.begin(), v.end(), fast));
+	                      }).ns;
+
+	for (auto threads : thread_counts())
+	{
+		thread_pool pool(threads);
+		const auto label = std::to_string(threads) + " threads";
+
+		report("for_each", layout, label, n,
+		       bench::measure(opt, n, [&] {
+			       parallel::for_each(pool, v.begin(), v.end(), step);
+		       }),
+		       for_each_ns);
+
+		report("transform_reduce", layout, label, n,
+		       bench::measure(opt, n, [&] {
+			       bench::keep(parallel::transform_reduce(
+			           pool, v.begin(), v.end(), 0.0, plus, energy));
+		       }),
+		       reduce_ns);
+
+		report("count_if", layout, label, n,
+		       bench::measure(opt, n, [&] {
+			       bench::keep(parallel::count_if(pool, v.begin(), v.end(), fast));
+		       }),
+		       count_ns);
+	}
+}
+
+void run(const bench::options& opt)
+{
+	std::printf("  %zu cores\n", thread_pool::default_threads());
+
+	auto v = make_particles(opt.elements);
+	run_layout(opt, "mixed", v);
+
+	const auto r = bench::measure(
+	    opt, v.size(), [&] { v = make_particles(opt.elements); },
+	    [&] { parallel::group_by_type<ion, electron, photon>(v.begin(), v.end()); });
+	bench::report("parallel_scaling", "group_by_type pre-pass", v.size(), r);
+
+	run_layout(opt, "grouped", v);
+}
+
+bench::registrar reg("parallel_scaling", &run);
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_algorithm.h"
+
+/*
+    The std algorithms against the relocating ones, on a vector of
+    local_derived in random order. Two thirds of the objects are
+    trivially relocatable, the rest hold a std::string and are relocated
+    with their move constructor. Prints the speedup of each pair.
+*/
+namespace
+{
+class item
+{
+public:
+	virtual ~item()
+	{
+	}
+
+	virtual uint64_t key() const = 0;
+};
+
+class particle final : public item
+{
+public:
+	explicit particle(uint64_t k) : k(k), x(1.0), y(2.0), z(3.0)
+	{
+	}
+
+	uint64_t key() const override
+	{
+		return k;
+	}
+
+private:
+	uint64_t k;
+	double x, y, z;
+};
+
+class label final : public item
+{
+public:
+	explicit label(uint64_t k) : k(k), text("label")
+	{
+	}
+
+	uint64_t key() const override
+	{
+		return k;
+	}
+
+private:
+	uint64_t k;
+	std::string text;
+};
+}
+
+template <>
+struct is_trivially_relocatable<particle> : std::true_type
+{
+};
+
+namespace
+{
+using ld = local_derived<item, sizeof(label)>;
+
+void fill(std::vector<ld>& v, const std::vector<uint64_t>& keys)
+{
+	v.clear();
+	for (auto k : keys)
+	{
+		if (k % 3)
+			v.emplace_back(emplace_tag_t<particle>(), k);
+		else
+			v.emplace_back(emplace_tag_t<label>(), k);
+	}
+}
+
+bool odd(const ld& x)
+{
+	return x->key() % 2 != 0;
+}
+
+template <class F, class G>
+void compare(const bench::options& opt,
+             const char* name,
+             const std::vector<uint64_t>& keys,
+             F&& with_std,
+             G&& with_relocation)
+{
+	const auto n = keys.size();
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	const auto setup = [&] { fill(v, keys); };
+
+	const auto a = bench::measure(opt, n, setup, [&] { with_std(v); });
+	const auto b = bench::measure(opt, n, setup, [&] { with_relocation(v); });
+
+	const auto variant_std = std::string("std::") + name;
+	const auto variant_relocating = std::string("relocating::") + name;
+	bench::report("relocation", variant_std.c_str(), n, a);
+	bench::report("relocation", variant_relocating.c_str(), n, b);
+	std::printf("  speedup %.2fx\n", a.ns / b.ns);
+}
+
+void run(const bench::options& opt)
+{
+	auto keys = std::vector<uint64_t>(opt.elements);
+	for (size_t i = 0; i < keys.size(); ++i)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(4));
+
+	compare(opt, "rotate", keys,
+	        [](std::vector<ld>& v) {
+		        std::rotate(v.begin(), v.begin() + v.size() / 3, v.end());
+	        },
+	        [](std::vector<ld>& v) {
+		        relocating::rotate(v.begin(), v.begin() + v.size() / 3, v.end());
+	        });
+
+	compare(opt, "partition", keys,
+	        [](std::vector<ld>& v) {
+		        bench::keep(std::partition(v.begin(), v.end(), odd));
+	        },
+	        [](std::vector<ld>& v) {
+		        bench::keep(relocating::partition(v.begin(), v.end(), odd));
+	        });
+
+	compare(opt, "stable_partition", keys,
+	        [](std::vector<ld>& v) {
+		        bench::keep(std::stable_partition(v.begin(), v.end(), odd));
+	        },
+	        [](std::vector<ld>& v) {
+		        bench::keep(relocating::stable_partition(v.begin(), v.end(), odd));
+	        });
+
+	compare(opt, "sort", keys,
+	        [](std::vector<ld>& v) {
+		        std::sort(v.begin(), v.end(), [](const ld& a, const ld& b) {
+			        return a->key() < b->key();
+		        });
+	        },
+	        [](std::vector<ld>& v) {
+		        relocating::sort_by(v.begin(), v.end(),
+		                            [](const ld& x) { return x->key(); });
+	        });
+
+	compare(opt, "erase_if", keys,
+	        [](std::vector<ld>& v) {
+		        v.erase(std::remove_if(v.begin(), v.end(), odd), v.end());
+	        },
+	        [](std::vector<ld>& v) { relocating::erase_if(v, odd); });
+}
+
+bench::registrar reg("relocation", &run);
+}
@@ -0,0 +1,113 @@
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "simple_hierarchy.h"
+#include "split_local_vector.h"
+
+/*
+     Filter and count by type: std::vector<local_derived> vs. the hot/cold
+    split_local_vector. Run with --elements=50000000 for the large case.
+*/
+namespace
+{
+using namespace simple_hierarchy;
+
+const auto S = sizeof(derived21);
+
+// Calls add(kind, tag) for n elements of randomly chosen types.
+template <class Add>
+void fill(size_t n, Add&& add)
+{
+	auto rng = std::mt19937(42);
+	auto kind = std::uniform_int_distribution<int>(0, 3);
+
+	for (size_t i = 0; i < n; ++i)
+		add(kind(rng), static_cast<int>(i % 100));
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	auto v = std::vector<local_derived<base, S>>();
+	v.reserve(n);
+	fill(n, [&](int kind, int t) {
+		switch (kind)
+		{
+		case 0:
+			v.emplace_back(emplace_tag_t<base>(), t);
+			break;
+		case 1:
+			v.emplace_back(emplace_tag_t<derived12>(), short(t));
+			break;
+		case 2:
+			v.emplace_back(emplace_tag_t<derived2>(), double(t));
+			break;
+		default:
+			v.emplace_back(emplace_tag_t<derived22>(), double(t));
+			break;
+		}
+	});
+
+	auto split = split_local_vector<base, S>();
+	split.reserve(n);
+	fill(n, [&](int kind, int t) {
+		switch (kind)
+		{
+		case 0:
+			split.emplace_back<base>(t);
+			break;
+		case 1:
+			split.emplace_back<derived12>(short(t));
+			break;
+		case 2:
+			split.emplace_back<derived2>(double(t));
+			break;
+		default:
+			split.emplace_back<derived22>(double(t));
+			break;
+		}
+	});
+
+	auto indices = std::vector<size_t>();
+	indices.reserve(n);
+
+	const auto vector_count = bench::measure(opt, n, [&] {
+		auto count = size_t(0);
+		for (const auto& x : v)
+			count += x.holds<derived12>();
+		bench::keep(count);
+	});
+
+	const auto split_count = bench::measure(opt, n, [&] {
+		bench::keep(split.count_type<derived12>());
+	});
+
+	const auto vector_filter = bench::measure(opt, n, [&] {
+		indices.clear();
+		for (size_t i = 0; i < v.size(); ++i)
+		{
+			if (v[i].holds<derived12>())
+				indices.push_back(i);
+		}
+		bench::keep(indices);
+	});
+
+	const auto split_filter = bench::measure(opt, n, [&] {
+		indices.clear();
+		split.find_all<derived12>(indices);
+		bench::keep(indices);
+	});
+
+	bench::report("split_layout", "vector<local_derived> count", n,
+	              vector_count);
+	bench::report("split_layout", "split_local_vector count", n, split_count);
+	bench::report("split_layout", "vector<local_derived> filter", n,
+	              vector_filter);
+	bench::report("split_layout", "split_local_vector filter", n,
+	              split_filter);
+}
+
+bench::registrar reg("split_layout", &run);
+}
@@ -0,0 +1,116 @@
+#include <iterator>
+#include <list>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "stable_local_vector.h"
+#include "simple_hierarchy.h"
+
+// Stable addresses: std::list<local_derived> vs. stable_local_vector.
+namespace
+{
+using namespace simple_hierarchy;
+
+const auto S = sizeof(derived21);
+
+using ld = local_derived<base, S>;
+
+// Fills c with n objects, then erases about a third, at random.
+template <class Container, class Emplace>
+void fill_with_holes(Container& c, size_t n, Emplace emplace)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto t = static_cast<int>(i);
+		emplace(c, i % 2 == 0, t);
+	}
+
+	auto rng = std::mt19937(42);
+	auto coin = std::uniform_int_distribution<int>(0, 2);
+
+	for (auto it = c.begin(); it != c.end();)
+	{
+		if (coin(rng) == 0)
+			it = c.erase(it);
+		else
+			++it;
+	}
+}
+
+template <class Container>
+bench::result iterate(const bench::options& opt, const Container& c)
+{
+	return bench::measure(opt, c.size(), [&] {
+		auto sum = 0;
+		for (const auto& x : c)
+			sum += x->depth();
+		bench::keep(sum);
+	});
+}
+
+// Erases n elements at random positions, each followed by an emplace.
+template <class Container, class Emplace>
+bench::result churn(const bench::options& opt,
+                    Container& c,
+                    size_t n,
+                    Emplace emplace)
+{
+	auto handles = std::vector<typename Container::iterator>();
+	for (auto it = c.begin(); it != c.end(); ++it)
+		handles.push_back(it);
+
+	auto rng = std::mt19937(7);
+	auto pick = std::uniform_int_distribution<size_t>(0, handles.size() - 1);
+	auto order = std::vector<size_t>(n);
+	for (auto& i : order)
+		i = pick(rng);
+
+	return bench::measure(opt, n, [&] {
+		for (auto i : order)
+		{
+			c.erase(handles[i]);
+			handles[i] = emplace(c);
+		}
+	});
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	auto list = std::list<ld>();
+	fill_with_holes(list, n, [](std::list<ld>& l, bool d, int t) {
+		if (d)
+			l.emplace_back(emplace_tag_t<derived2>(), double(t));
+		else
+			l.emplace_back(emplace_tag_t<base>(), t);
+	});
+
+	auto stable = stable_local_vector<base, S>();
+	fill_with_holes(stable, n, [](stable_local_vector<base, S>& v, bool d,
+	                              int t) {
+		if (d)
+			v.emplace<derived2>(double(t));
+		else
+			v.emplace<base>(t);
+	});
+
+	bench::report("stable_addresses", "std::list iterate", list.size(),
+	              iterate(opt, list));
+	bench::report("stable_addresses", "stable_local_vector iterate",
+	              stable.size(), iterate(opt, stable));
+
+	bench::report("stable_addresses", "std::list churn", n,
+	              churn(opt, list, n, [](std::list<ld>& l) {
+		              l.emplace_back(emplace_tag_t<base>(), 1);
+		              return std::prev(l.end());
+		          }));
+	bench::report("stable_addresses", "stable_local_vector churn", n,
+	              churn(opt, stable, n, [](stable_local_vector<base, S>& v) {
+		              return v.template emplace<base>(1);
+		          }));
+}
+
+bench::registrar reg("stable_addresses", &run);
+}
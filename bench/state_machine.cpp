@@ -0,0 +1,251 @@
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_state_machine.h"
+
+/*
+    Per-transition cost of a 10-state protocol parser. The lexer output
+    is a stream of tokens, one per parser state, and every token moves
+    the parser to another state. The baseline allocates each state with
+    std::unique_ptr; the local_state_machine constructs it in-place.
+*/
+namespace
+{
+// Parser states, in the order a message goes through them.
+enum phase
+{
+	request_line,
+	method,
+	target,
+	version,
+	header_name,
+	header_value,
+	header_end,
+	body_chunk,
+	chunk_end,
+	message_end
+};
+
+// A token that moves the parser to phase next.
+struct token
+{
+	int next;
+	uint32_t value;
+};
+
+// Tokens that may follow each phase.
+const std::vector<std::vector<int>> follows = {
+    {method},                             // request_line
+    {target},                             // method
+    {version},                            // target
+    {header_name, header_end},            // version
+    {header_value},                       // header_name
+    {header_name, header_end},            // header_value
+    {body_chunk, message_end},            // header_end
+    {body_chunk, chunk_end},              // body_chunk
+    {body_chunk, message_end},            // chunk_end
+    {request_line},                       // message_end
+};
+
+// A valid token stream, the same for both variants.
+std::vector<token> make_tokens(size_t n)
+{
+	auto rng = std::mt19937(5);
+
+	auto tokens = std::vector<token>(n);
+	auto at = int(message_end);
+	for (auto& t : tokens)
+	{
+		const auto& f = follows[at];
+		t.next = f[rng() % f.size()];
+		t.value = uint32_t(rng());
+		at = t.next;
+	}
+	return tokens;
+}
+
+uint64_t checksum = 0;
+
+// State of phase I, holding 8 to 32 bytes of parsed data.
+template <int I>
+struct payload
+{
+	explicit payload(const token& t) : value(t.value)
+	{
+		data[0] = uint8_t(t.value);
+	}
+
+	uint32_t value;
+	uint8_t data[4 + 8 * (I % 4)] = {};
+
+	void consume(const token& t)
+	{
+		checksum += value + data[0] + uint32_t(I) * t.value;
+	}
+};
+
+/* local_state_machine */
+
+class state
+{
+public:
+	virtual ~state()
+	{
+	}
+
+	virtual state_transition on_event(const token& t) = 0;
+};
+
+template <int I>
+class local_step;
+
+// Returns a transition to the state of phase next.
+state_transition to_phase(int next)
+{
+	switch (next)
+	{
+	case 0: return state_transition::to<local_step<0>>();
+	case 1: return state_transition::to<local_step<1>>();
+	case 2: return state_transition::to<local_step<2>>();
+	case 3: return state_transition::to<local_step<3>>();
+	case 4: return state_transition::to<local_step<4>>();
+	case 5: return state_transition::to<local_step<5>>();
+	case 6: return state_transition::to<local_step<6>>();
+	case 7: return state_transition::to<local_step<7>>();
+	case 8: return state_transition::to<local_step<8>>();
+	default: return state_transition::to<local_step<9>>();
+	}
+}
+
+template <int I>
+class local_step final : public state
+{
+public:
+	explicit local_step(const token& t) : p(t)
+	{
+	}
+
+	state_transition on_event(const token& t) override
+	{
+		p.consume(t);
+		return to_phase(t.next);
+	}
+
+private:
+	payload<I> p;
+};
+
+using parser = local_state_machine<state,
+                                   token,
+                                   local_step<0>,
+                                   local_step<1>,
+                                   local_step<2>,
+                                   local_step<3>,
+                                   local_step<4>,
+                                   local_step<5>,
+                                   local_step<6>,
+                                   local_step<7>,
+                                   local_step<8>,
+                                   local_step<9>>;
+
+/* std::unique_ptr */
+
+class heap_state
+{
+public:
+	virtual ~heap_state()
+	{
+	}
+
+	virtual std::unique_ptr<heap_state> on_event(const token& t) = 0;
+};
+
+// Allocates the state of phase t.next.
+std::unique_ptr<heap_state> make_phase(const token& t);
+
+template <int I>
+class heap_step final : public heap_state
+{
+public:
+	explicit heap_step(const token& t) : p(t)
+	{
+	}
+
+	std::unique_ptr<heap_state> on_event(const token& t) override
+	{
+		p.consume(t);
+		return make_phase(t);
+	}
+
+private:
+	payload<I> p;
+};
+
+std::unique_ptr<heap_state> make_phase(const token& t)
+{
+	switch (t.next)
+	{
+	case 0: return std::make_unique<heap_step<0>>(t);
+	case 1: return std::make_unique<heap_step<1>>(t);
+	case 2: return std::make_unique<heap_step<2>>(t);
+	case 3: return std::make_unique<heap_step<3>>(t);
+	case 4: return std::make_unique<heap_step<4>>(t);
+	case 5: return std::make_unique<heap_step<5>>(t);
+	case 6: return std::make_unique<heap_step<6>>(t);
+	case 7: return std::make_unique<heap_step<7>>(t);
+	case 8: return std::make_unique<heap_step<8>>(t);
+	default: return std::make_unique<heap_step<9>>(t);
+	}
+}
+
+const auto first = token{message_end, 0};
+
+bench::result run_local(const bench::options& opt,
+                        const std::vector<token>& tokens)
+{
+	return bench::measure(opt, tokens.size(), [&] {
+		checksum = 0;
+
+		parser m{emplace_tag_t<local_step<message_end>>(), first};
+		for (const auto& t : tokens)
+			m.process(t);
+
+		bench::keep(checksum);
+		bench::keep(m.index());
+	});
+}
+
+bench::result run_unique_ptr(const bench::options& opt,
+                             const std::vector<token>& tokens)
+{
+	return bench::measure(opt, tokens.size(), [&] {
+		checksum = 0;
+
+		std::unique_ptr<heap_state> current =
+		    std::make_unique<heap_step<message_end>>(first);
+		for (const auto& t : tokens)
+		{
+			auto next = current->on_event(t);
+			if (next)
+				current = std::move(next);
+		}
+
+		bench::keep(checksum);
+		bench::keep(current.get());
+	});
+}
+
+void run(const bench::options& opt)
+{
+	const auto tokens = make_tokens(opt.elements);
+
+	bench::report("state_machine", "unique_ptr<State>", opt.elements,
+	              run_unique_ptr(opt, tokens));
+	bench::report("state_machine", "local_state_machine", opt.elements,
+	              run_local(opt, tokens));
+}
+
+bench::registrar reg("state_machine", &run);
+}
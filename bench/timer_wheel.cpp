@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "timer_wheel.h"
+
+/*
+    Timeouts: arm opt.elements timers, cancel 90% of them, then run until
+    the rest expire. Run with --elements=10000000 for 10M armed timers.
+*/
+namespace
+{
+class timeout
+{
+public:
+	virtual ~timeout()
+	{
+	}
+
+	virtual void fire(uint64_t& sum) = 0;
+};
+
+class close_connection final : public timeout
+{
+public:
+	close_connection(uint64_t id, uint64_t deadline, uint32_t retries)
+	  : id(id), deadline(deadline), retries(retries)
+	{
+	}
+
+	void fire(uint64_t& sum) override
+	{
+		sum += id + deadline + retries;
+	}
+
+private:
+	uint64_t id, deadline;
+	uint32_t retries;
+};
+
+const uint64_t max_delay = 1 << 16;
+
+struct plan
+{
+	std::vector<uint64_t> delays;
+	std::vector<uint32_t> cancels; // indices of timers to cancel, 90%
+};
+
+plan make_plan(size_t n)
+{
+	auto rng = std::mt19937_64(11);
+	auto delay = std::uniform_int_distribution<uint64_t>(1, max_delay);
+	auto coin = std::uniform_int_distribution<int>(0, 9);
+
+	auto p = plan();
+	p.delays.resize(n);
+	for (auto& d : p.delays)
+		d = delay(rng);
+
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		if (coin(rng) != 0)
+			p.cancels.push_back(i);
+	}
+	std::shuffle(p.cancels.begin(), p.cancels.end(), rng);
+	return p;
+}
+
+bench::result run_wheel(const bench::options& opt, const plan& p)
+{
+	const auto n = p.delays.size();
+
+	timer_wheel<timeout, sizeof(close_connection)> w;
+	w.reserve(n);
+
+	auto handles = std::vector<timer_handle>(n);
+
+	return bench::measure(opt, n, [&] {
+		for (size_t i = 0; i < n; ++i)
+			handles[i] = w.arm<close_connection>(p.delays[i], i, p.delays[i], 3u);
+
+		for (auto i : p.cancels)
+			w.cancel(handles[i]);
+
+		auto sum = uint64_t(0);
+		w.advance(max_delay, [&](timeout& t) { t.fire(sum); });
+		bench::keep(sum);
+	});
+}
+
+bench::result run_multimap(const bench::options& opt, const plan& p)
+{
+	const auto n = p.delays.size();
+
+	using map = std::multimap<uint64_t, std::function<void(uint64_t&)>>;
+
+	auto timers = map();
+	auto handles = std::vector<map::iterator>(n);
+
+	return bench::measure(opt, n, [&] {
+		for (size_t i = 0; i < n; ++i)
+		{
+			const auto id = uint64_t(i);
+			const auto deadline = p.delays[i];
+			const auto retries = 3u;
+
+			handles[i] = timers.emplace(
+			    deadline, [id, deadline, retries](uint64_t& sum) {
+				    sum += id + deadline + retries;
+			    });
+		}
+
+		for (auto i : p.cancels)
+			timers.erase(handles[i]);
+
+		auto sum = uint64_t(0);
+		for (uint64_t now = 1; now <= max_delay; ++now)
+		{
+			while (!timers.empty() && timers.begin()->first <= now)
+			{
+				timers.begin()->second(sum);
+				timers.erase(timers.begin());
+			}
+		}
+		bench::keep(sum);
+	});
+}
+
+void run(const bench::options& opt)
+{
+	const auto p = make_plan(opt.elements);
+
+	bench::report("timer_wheel", "multimap<std::function>", opt.elements,
+	              run_multimap(opt, p));
+	bench::report("timer_wheel", "timer_wheel", opt.elements,
+	              run_wheel(opt, p));
+}
+
+bench::registrar reg("timer_wheel", &run);
+}
@@ -0,0 +1,83 @@
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "simple_hierarchy.h"
+
+// Exact type tests: dynamic_cast vs. holds<U>() / get_if<U>().
+namespace
+{
+using namespace simple_hierarchy;
+
+const auto S = sizeof(derived21);
+
+using ld = local_derived<base, S>;
+
+// Fills a vector with n objects of randomly chosen types.
+std::vector<ld> make_objects(size_t n)
+{
+	auto rng = std::mt19937(42);
+	auto kind = std::uniform_int_distribution<int>(0, 3);
+
+	auto v = std::vector<ld>();
+	v.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto t = static_cast<int>(i % 100);
+
+		switch (kind(rng))
+		{
+		case 0:
+			v.emplace_back(emplace_tag_t<base>(), t);
+			break;
+		case 1:
+			v.emplace_back(emplace_tag_t<derived12>(), short(t));
+			break;
+		case 2:
+			v.emplace_back(emplace_tag_t<derived2>(), double(t));
+			break;
+		default:
+			v.emplace_back(emplace_tag_t<derived22>(), double(t));
+			break;
+		}
+	}
+	return v;
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+	auto v = make_objects(n);
+
+	const auto cast = bench::measure(opt, n, [&] {
+		auto count = size_t(0);
+		for (const auto& x : v)
+			count += dynamic_cast<derived12*>(x.get()) != nullptr;
+		bench::keep(count);
+	});
+
+	const auto holds = bench::measure(opt, n, [&] {
+		auto count = size_t(0);
+		for (const auto& x : v)
+			count += x.holds<derived12>();
+		bench::keep(count);
+	});
+
+	const auto get_if = bench::measure(opt, n, [&] {
+		auto depth = 0;
+		for (const auto& x : v)
+		{
+			if (auto* d = x.get_if<derived12>())
+				depth += d->depth();
+		}
+		bench::keep(depth);
+	});
+
+	bench::report("type_query", "dynamic_cast count", n, cast);
+	bench::report("type_query", "holds<U> count", n, holds);
+	bench::report("type_query", "get_if<U> + call", n, get_if);
+}
+
+bench::registrar reg("type_query", &run);
+}
@@ -0,0 +1,116 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "local_derived.h"
+#include "local_derived_simd.h"
+#include "simple_hierarchy.h"
+#include "split_local_vector.h"
+
+// Counting and finding by type: dynamic_cast loop vs. type tag scans.
+namespace
+{
+using namespace simple_hierarchy;
+using namespace local_derived_internal;
+
+const auto S = sizeof(derived21);
+
+const char* level_name(simd_level level)
+{
+	switch (level)
+	{
+	case simd_level::avx2:
+		return "avx2";
+	case simd_level::sse2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+void run(const bench::options& opt)
+{
+	const auto n = opt.elements;
+
+	auto rng = std::mt19937(42);
+	auto kind = std::uniform_int_distribution<int>(0, 3);
+
+	auto v = std::vector<local_derived<base, S>>();
+	auto split = split_local_vector<base, S>();
+	v.reserve(n);
+	split.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto t = static_cast<int>(i % 100);
+
+		switch (kind(rng))
+		{
+		case 0:
+			v.emplace_back(emplace_tag_t<base>(), t);
+			split.emplace_back<base>(t);
+			break;
+		case 1:
+			v.emplace_back(emplace_tag_t<derived12>(), short(t));
+			split.emplace_back<derived12>(short(t));
+			break;
+		case 2:
+			v.emplace_back(emplace_tag_t<derived2>(), double(t));
+			split.emplace_back<derived2>(double(t));
+			break;
+		default:
+			v.emplace_back(emplace_tag_t<derived22>(), double(t));
+			split.emplace_back<derived22>(double(t));
+			break;
+		}
+	}
+
+	const auto cast = bench::measure(opt, n, [&] {
+		auto count = size_t(0);
+		for (const auto& x : v)
+			count += dynamic_cast<derived12*>(x.get()) != nullptr;
+		bench::keep(count);
+	});
+
+	bench::report("type_tags", "dynamic_cast count", n, cast);
+
+	const auto& tags = split.type_tags();
+	const auto tag = static_cast<uint8_t>(split.type_tag<derived12>());
+
+	auto levels = std::vector<simd_level>({simd_level::scalar});
+	if (detected_simd_level() != simd_level::scalar)
+		levels.push_back(simd_level::sse2);
+	if (detected_simd_level() == simd_level::avx2)
+		levels.push_back(simd_level::avx2);
+
+	auto indices = std::vector<size_t>();
+	indices.reserve(n);
+
+	for (auto level : levels)
+	{
+		const auto count = bench::measure(opt, n, [&] {
+			bench::keep(count_tags(tags.data(), tags.size(), tag, level));
+		});
+
+		const auto find = bench::measure(opt, n, [&] {
+			indices.clear();
+			find_tags(tags.data(), tags.size(), tag, indices, level);
+			bench::keep(indices);
+		});
+
+		const auto count_name = std::string("count_type ") + level_name(level);
+		const auto find_name = std::string("find_all ") + level_name(level);
+
+		bench::report("type_tags", count_name.c_str(), n, count);
+		bench::report("type_tags", find_name.c_str(), n, find);
+	}
+
+	const auto partition = bench::measure(opt, n, [&] {
+		bench::keep(split.partition_by_type());
+	});
+
+	bench::report("type_tags", "partition_by_type", n, partition);
+}
+
+bench::registrar reg("type_tags", &run);
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <type_traits>
 #include "local_derived.h"
+#include "local_derived_algorithm.h"
 
 // base class with a string tag
 class Base
@@ -126,7 +127,7 @@ int main()
 	for (auto& x : v)
 		x->message();
 
-	std::rotate(v.begin(), v.begin() + 3, v.end());
+	relocating::rotate(v.begin(), v.begin() + 3, v.end());
 
 	std::cerr << "\nRotate (begin, begin+3, end):\n\n";
 	for (auto& x : v)
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+     A bounded multi-producer, single-consumer ring buffer.
+
+     Values are constructed in their cell by try_emplace(), and consumed
+    in place by try_consume(); they are never copied or moved. Each cell
+    has a sequence number, as in D. Vyukov's bounded queue: producers
+    claim a cell with a CAS on the tail, the consumer needs no atomic
+    read-modify-write.
+
+     Requirements:
+     - try_consume() is called from one thread at a time
+*/
+template <class T>
+class mpsc_ring
+{
+public:
+	// capacity is rounded up to a power of two
+	explicit mpsc_ring(size_t capacity)
+	{
+		auto n = size_t(1);
+		while (n < capacity)
+			n *= 2;
+
+		cells = local_derived_internal::aligned_buffer(n * sizeof(cell),
+		                                               alignof(cell));
+		mask = n - 1;
+
+		for (size_t i = 0; i < n; ++i)
+			new (cell_at(i)) cell(i);
+	}
+
+	mpsc_ring(const mpsc_ring&) = delete;
+	mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+	~mpsc_ring()
+	{
+		while (try_consume([](T&) {}))
+			;
+
+		for (size_t i = 0; i <= mask; ++i)
+			cell_at(i)->~cell();
+	}
+
+	// Constructs a T at the tail. Returns false if the ring is full.
+	template <class... Args>
+	bool try_emplace(Args&&... args)
+	{
+		auto pos = tail.load(std::memory_order_relaxed);
+		cell* c;
+
+		for (;;)
+		{
+			c = cell_at(pos & mask);
+			const auto seq = c->sequence.load(std::memory_order_acquire);
+			const auto dif = static_cast<std::ptrdiff_t>(seq - pos);
+
+			if (dif == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1,
+				                               std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0)
+				return false;
+			else
+				pos = tail.load(std::memory_order_relaxed);
+		}
+
+		new (&c->value) T(std::forward<Args>(args)...);
+		c->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	    Calls f(T&) on the value at the head, then destroys it.
+	    Returns false if the ring is empty.
+	*/
+	template <class F>
+	bool try_consume(F&& f)
+	{
+		auto* c = cell_at(head & mask);
+		if (c->sequence.load(std::memory_order_acquire) != head + 1)
+			return false;
+
+		auto* value = reinterpret_cast<T*>(&c->value);
+		f(*value);
+		value->~T();
+
+		c->sequence.store(head + mask + 1, std::memory_order_release);
+		++head;
+		return true;
+	}
+
+	// Consumer side: true if no value is ready at the head.
+	bool empty() const noexcept
+	{
+		return cell_at(head & mask)->sequence.load(std::memory_order_acquire) !=
+		       head + 1;
+	}
+
+	size_t capacity() const noexcept
+	{
+		return mask + 1;
+	}
+
+private:
+	struct cell
+	{
+		explicit cell(size_t i) : sequence(i)
+		{
+		}
+
+		std::atomic<size_t> sequence;
+		std::aligned_storage_t<sizeof(T), alignof(T)> value;
+	};
+
+	cell* cell_at(size_t i) const noexcept
+	{
+		return reinterpret_cast<cell*>(cells.data()) + i;
+	}
+
+	local_derived_internal::aligned_buffer cells;
+	size_t mask = 0;
+
+	// producers and the consumer on separate cache lines
+	char pad0[64];
+	std::atomic<size_t> tail{0};
+	char pad1[64 - sizeof(std::atomic<size_t>)];
+	size_t head = 0;
+	char pad2[64 - sizeof(size_t)];
+};
+
+/*
+     A small actor runtime with in-place actors and messages.
+
+     Actors are local_derived<Actor, actor_size> values in a fixed pool,
+    each with a bounded mailbox of local_derived<Message, message_size>.
+    Each actor belongs to one worker thread (its affinity); a worker runs
+    an actor for up to batch messages per activation, then moves on.
+
+        actor_runtime<actor, 64, message, 32> rt(config);
+        auto a = rt.spawn<counter>(...);
+        rt.start();
+        rt.send<increment>(a, 1);
+
+     Params:
+      - Actor         the base class of actors
+      - actor_size    maximum allowed actor size, see local_derived
+      - Message       the base class of messages
+      - message_size  maximum allowed message size, see local_derived
+
+     Requirements are the same as for local_derived, plus:
+     - Actor has a method receive(Message&), called on its worker thread
+     - actors are spawned from one thread; spawning more than
+       config::max_actors throws std::length_error
+*/
+template <class Actor, size_t actor_size, class Message, size_t message_size>
+class actor_runtime
+{
+public:
+	using actor_type = local_derived<Actor, actor_size>;
+	using message_type = local_derived<Message, message_size>;
+	using actor_id = uint32_t;
+
+	struct config
+	{
+		size_t workers = 1;            // 0 is taken as 1
+		size_t max_actors = 1024;
+		size_t mailbox_capacity = 256; // messages, per actor
+		size_t batch = 16;             // messages per activation, 0 as 1
+		bool pin_threads = false;      // pin worker i to CPU i
+	};
+
+	explicit actor_runtime(const config& c)
+	  : settings(clamped(c)),
+	    entries(c.max_actors * sizeof(entry), alignof(entry))
+	{
+		for (size_t w = 0; w < settings.workers; ++w)
+			workers.emplace_back(new worker(c.max_actors));
+	}
+
+	actor_runtime(const actor_runtime&) = delete;
+	actor_runtime& operator=(const actor_runtime&) = delete;
+
+	// Stops the workers, then destroys all actors and pending messages.
+	~actor_runtime()
+	{
+		stop();
+
+		for (size_t i = 0; i < count.load(); ++i)
+			entry_at(static_cast<actor_id>(i))->~entry();
+	}
+
+	/* actors */
+
+	// Spawns a U on worker id % workers.
+	template <class U, class... Args>
+	actor_id spawn(Args&&... args)
+	{
+		const auto id = count.load(std::memory_order_relaxed);
+		return spawn_on<U>(id % workers.size(), std::forward<Args>(args)...);
+	}
+
+	/*
+	    Spawns a U on the given worker. Throws std::length_error if
+	    max_actors actors exist.
+	*/
+	template <class U, class... Args>
+	actor_id spawn_on(size_t worker, Args&&... args)
+	{
+		const auto id = count.load(std::memory_order_relaxed);
+		if (id >= settings.max_actors)
+			throw std::length_error("actor_runtime: more than max_actors actors");
+
+		new (entry_at(id)) entry(settings.mailbox_capacity,
+		                         static_cast<uint32_t>(worker % workers.size()),
+		                         emplace_tag_t<U>(), std::forward<Args>(args)...);
+
+		count.store(id + 1, std::memory_order_release);
+		return id;
+	}
+
+	/* messages */
+
+	/*
+	    Sends a U, constructed in the mailbox of actor to.
+	    Returns false if the mailbox is full. Any thread may send.
+
+	    Throws std::out_of_range if no actor to was spawned.
+	*/
+	template <class U, class... Args>
+	bool try_send(actor_id to, Args&&... args)
+	{
+		if (to >= count.load(std::memory_order_acquire))
+			throw std::out_of_range("actor_runtime: unknown actor_id");
+
+		auto* e = entry_at(to);
+
+		if (!e->mailbox.try_emplace(emplace_tag_t<U>(), std::forward<Args>(args)...))
+			return false;
+
+		// pairs with the fence in activate(): either the worker sees the
+		// message, or this sees the actor unscheduled
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!e->scheduled.exchange(true, std::memory_order_acq_rel))
+			schedule(e->worker, to);
+
+		return true;
+	}
+
+	/*
+	    Like try_send, but yields while the mailbox is full. Don't use it
+	    from an actor to an actor on the same worker.
+
+	    Throws std::out_of_range if no actor to was spawned.
+	*/
+	template <class U, class... Args>
+	void send(actor_id to, Args&&... args)
+	{
+		while (!try_send<U>(to, args...))
+			std::this_thread::yield();
+	}
+
+	/* workers */
+
+	void start()
+	{
+		for (size_t w = 0; w < workers.size(); ++w)
+			workers[w]->thread = std::thread([this, w] { run(w); });
+
+#if defined(__linux__)
+		if (settings.pin_threads)
+		{
+			const auto cpus = std::thread::hardware_concurrency();
+			for (size_t w = 0; w < workers.size(); ++w)
+			{
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				CPU_SET(static_cast<int>(cpus ? w % cpus : 0), &set);
+				pthread_setaffinity_np(workers[w]->thread.native_handle(),
+				                       sizeof(set), &set);
+			}
+		}
+#endif
+	}
+
+	// Stops and joins the workers; pending messages stay in the mailboxes.
+	void stop()
+	{
+		for (auto& w : workers)
+		{
+			{
+				std::lock_guard<std::mutex> lock(w->mutex);
+				w->stopping.store(true);
+			}
+			w->wake.notify_one();
+		}
+
+		for (auto& w : workers)
+		{
+			if (w->thread.joinable())
+				w->thread.join();
+			w->stopping.store(false);
+		}
+	}
+
+	size_t worker_count() const noexcept
+	{
+		return workers.size();
+	}
+
+	size_t actor_count() const noexcept
+	{
+		return count.load(std::memory_order_acquire);
+	}
+
+private:
+	// With no workers, or a batch of 0, no message would ever be received.
+	static config clamped(config c) noexcept
+	{
+		c.workers = c.workers ? c.workers : 1;
+		c.batch = c.batch ? c.batch : 1;
+		return c;
+	}
+
+	struct entry
+	{
+		template <class U, class... Args>
+		entry(size_t mailbox_capacity,
+		      uint32_t worker,
+		      emplace_tag_t<U> tag,
+		      Args&&... args)
+		  : actor(tag, std::forward<Args>(args)...),
+		    mailbox(mailbox_capacity),
+		    worker(worker)
+		{
+		}
+
+		actor_type actor;
+		mpsc_ring<message_type> mailbox;
+		std::atomic<bool> scheduled{false}; // queued or running
+		uint32_t worker;
+	};
+
+	struct worker
+	{
+		explicit worker(size_t max_actors) : ready(max_actors)
+		{
+		}
+
+		mpsc_ring<actor_id> ready; // each actor is queued at most once
+		std::atomic<bool> sleeping{false};
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::atomic<bool> stopping{false};
+		std::thread thread;
+	};
+
+	entry* entry_at(actor_id id) const noexcept
+	{
+		return reinterpret_cast<entry*>(entries.data()) + id;
+	}
+
+	void schedule(uint32_t w, actor_id id)
+	{
+		auto& wk = *workers[w];
+
+		const auto queued = wk.ready.try_emplace(id);
+		assert(queued && "the ready ring holds every actor");
+		(void)queued;
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (wk.sleeping.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(wk.mutex);
+			wk.wake.notify_one();
+		}
+	}
+
+	void run(size_t w)
+	{
+		auto& wk = *workers[w];
+		auto id = actor_id(0);
+		auto idle = 0;
+
+		while (!wk.stopping.load(std::memory_order_relaxed))
+		{
+			if (wk.ready.try_consume([&](actor_id& a) { id = a; }))
+			{
+				activate(static_cast<uint32_t>(w), id);
+				idle = 0;
+				continue;
+			}
+
+			// nothing to run: yield for a while, as replies tend to come
+			// soon, then sleep until scheduled or stopped
+			if (idle++ < spin_limit)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			idle = 0;
+
+			wk.sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			{
+				std::unique_lock<std::mutex> lock(wk.mutex);
+				wk.wake.wait(lock, [&] {
+					return wk.stopping.load(std::memory_order_relaxed) ||
+					       !wk.ready.empty();
+				});
+			}
+
+			wk.sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	// Delivers up to batch messages to an actor.
+	void activate(uint32_t w, actor_id id)
+	{
+		auto* e = entry_at(id);
+		auto& actor = *e->actor;
+
+		for (size_t n = 0; n < settings.batch; ++n)
+		{
+			if (!e->mailbox.try_consume([&](message_type& m) { actor.receive(*m); }))
+				break;
+		}
+
+		if (!e->mailbox.empty())
+		{
+			schedule(w, id); // more to do, after the other ready actors
+			return;
+		}
+
+		e->scheduled.store(false, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!e->mailbox.empty() &&
+		    !e->scheduled.exchange(true, std::memory_order_acq_rel))
+			schedule(w, id);
+	}
+
+	// idle yields before a worker sleeps
+	static constexpr int spin_limit = 64;
+
+	config settings;
+	local_derived_internal::aligned_buffer entries; // max_actors entries
+	std::atomic<size_t> count{0};
+	std::vector<std::unique_ptr<worker>> workers;
+};
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+// Identifies an object in a compacting_pool; stays valid across compaction.
+struct pool_handle
+{
+	uint32_t index = std::numeric_limits<uint32_t>::max();
+	uint32_t generation = 0;
+};
+
+// How sparse the slots of a compacting_pool are.
+struct pool_fragmentation
+{
+	size_t live = 0;     // objects in the pool
+	size_t span = 0;     // slots up to and including the last live one
+	size_t capacity = 0; // allocated slots
+
+	// Dead slots that iteration has to skip.
+	size_t holes() const noexcept
+	{
+		return span - live;
+	}
+
+	// Fraction of the span that is live, 1 if the pool is empty.
+	double density() const noexcept
+	{
+		return span ? static_cast<double>(live) / static_cast<double>(span) : 1.0;
+	}
+};
+
+/*
+     A pool of local_derived slots that can be compacted incrementally.
+
+     Objects live in one contiguous array of slots and are reached through
+    handles, by way of an indirection table. insert() appends after the
+    last used slot and erase() leaves a hole, so after a long run the
+    slots become sparse. compact() relocates live objects from the back
+    into the holes at the front, using the type-erased move of
+    local_derived, and updates the indirection table. It does a bounded
+    amount of work per call, so it can be interleaved with serving:
+
+        compacting_pool<session, 64> pool;
+        auto h = pool.insert<tcp_session>(...);
+        pool.erase(h);
+        while (!pool.compact(256)) // up to 256 relocations per call
+            serve();
+
+     Handles stay valid across compaction; pointers and references to
+    objects don't.
+
+     Params:
+      - Base       the base class of stored objects
+      - slot_size  maximum allowed object size, see local_derived
+      - alignment  minimum object alignment
+
+     Requirements are the same as for local_derived.
+
+     Handles are numbered with 32 bits; insert() throws std::length_error
+    when more would be needed.
+*/
+template <class Base,
+          size_t slot_size,
+          size_t alignment = alignof(std::max_align_t)>
+class compacting_pool
+{
+public:
+	using value_type = local_derived<Base, slot_size, alignment>;
+
+	compacting_pool() = default;
+
+	compacting_pool(const compacting_pool&) = delete;
+	compacting_pool& operator=(const compacting_pool&) = delete;
+
+	~compacting_pool()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Constructs a U from args in the slot after the last used one.
+	template <class U, class... Args>
+	pool_handle insert(Args&&... args)
+	{
+		if (used == capacity())
+			grow();
+
+		const auto index = allocate_handle();
+		const auto slot = static_cast<uint32_t>(used);
+
+		try
+		{
+			owner.push_back(index);
+			new (at(slot))
+			    value_type(emplace_tag_t<U>(), std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			owner.resize(used);
+			release_handle(index);
+			throw;
+		}
+		entries[index].slot = slot;
+
+		++used;
+		++live;
+		return pool_handle{index, entries[index].generation};
+	}
+
+	// Destroys the object, leaving a hole. Returns false if h is stale.
+	bool erase(pool_handle h)
+	{
+		if (!contains(h))
+			return false;
+
+		const auto slot = entries[h.index].slot;
+		at(slot)->~value_type();
+		owner[slot] = none;
+		release_handle(h.index);
+		--live;
+
+		if (slot < first_hole)
+			first_hole = slot;
+
+		trim();
+		return true;
+	}
+
+	/*
+	    Relocates up to max_moves live objects from the back of the pool
+	    into holes at the front. Returns true if the pool is compact, that
+	    is, there are no holes.
+	*/
+	bool compact(size_t max_moves)
+	{
+		for (size_t moves = 0; moves < max_moves; ++moves)
+		{
+			if (!relocate_one())
+				return true;
+		}
+		return live == used;
+	}
+
+	/*
+	    Same as above, for up to budget of time. The clock is read every
+	    few moves, so the slice may overrun by a few relocations.
+	*/
+	bool compact_for(std::chrono::nanoseconds budget)
+	{
+		using clock = std::chrono::steady_clock;
+
+		const auto deadline = clock::now() + budget;
+		do
+		{
+			if (compact(moves_per_clock_check))
+				return true;
+		} while (clock::now() < deadline);
+
+		return false;
+	}
+
+	// Destroys all objects; invalidates all handles, keeps the storage.
+	void clear()
+	{
+		for (size_t slot = 0; slot < used; ++slot)
+		{
+			if (owner[slot] != none)
+			{
+				at(slot)->~value_type();
+				release_handle(owner[slot]);
+			}
+		}
+
+		owner.clear();
+		used = 0;
+		live = 0;
+		first_hole = 0;
+	}
+
+	void reserve(size_t n)
+	{
+		if (n > capacity())
+			reallocate(n);
+	}
+
+	/* element access */
+
+	// Returns true if h refers to an object in the pool.
+	bool contains(pool_handle h) const noexcept
+	{
+		return h.index < entries.size() &&
+		       entries[h.index].generation == h.generation &&
+		       entries[h.index].slot != none;
+	}
+
+	// Returns the object h refers to, or nullptr if h is stale.
+	Base* get(pool_handle h) const noexcept
+	{
+		return contains(h) ? at(entries[h.index].slot)->get() : nullptr;
+	}
+
+	// Calls f(Base&) for each object, in slot order.
+	template <class F>
+	void for_each(F&& f) const
+	{
+		for (size_t slot = 0; slot < used; ++slot)
+		{
+			if (owner[slot] != none)
+				f(**at(slot));
+		}
+	}
+
+	/* observers */
+
+	size_t size() const noexcept
+	{
+		return live;
+	}
+
+	bool empty() const noexcept
+	{
+		return live == 0;
+	}
+
+	size_t capacity() const noexcept
+	{
+		return storage.size() / sizeof(value_type);
+	}
+
+	pool_fragmentation fragmentation() const noexcept
+	{
+		auto f = pool_fragmentation();
+		f.live = live;
+		f.span = used;
+		f.capacity = capacity();
+		return f;
+	}
+
+private:
+	static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+	static constexpr size_t moves_per_clock_check = 32;
+
+	// Handle table entry: the slot of the object, or none if free.
+	struct entry
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+
+	value_type* at(size_t slot) const noexcept
+	{
+		return reinterpret_cast<value_type*>(storage.data()) + slot;
+	}
+
+	/*
+	    Moves the last live object into the first hole. Returns false if
+	    there is no hole before it.
+	*/
+	bool relocate_one()
+	{
+		while (first_hole < used && owner[first_hole] != none)
+			++first_hole;
+
+		if (first_hole >= used)
+			return false;
+
+		// used - 1 is live, see trim()
+		const auto from = static_cast<uint32_t>(used - 1);
+		const auto to = static_cast<uint32_t>(first_hole);
+
+		new (at(to)) value_type(std::move(*at(from)));
+		at(from)->~value_type();
+
+		owner[to] = owner[from];
+		owner[from] = none;
+		entries[owner[to]].slot = to;
+
+		trim();
+		return true;
+	}
+
+	// Drops dead slots at the back, so the last used slot is live.
+	void trim()
+	{
+		while (used > 0 && owner[used - 1] == none)
+			--used;
+		owner.resize(used);
+
+		if (first_hole > used)
+			first_hole = used;
+	}
+
+	void grow()
+	{
+		reallocate(capacity() ? 2 * capacity() : 64);
+	}
+
+	// Relocates the used slots to storage for n slots.
+	void reallocate(size_t n)
+	{
+		auto bigger = local_derived_internal::aligned_buffer(
+		    n * sizeof(value_type), alignof(value_type));
+		auto* to = reinterpret_cast<value_type*>(bigger.data());
+
+		for (size_t slot = 0; slot < used; ++slot)
+		{
+			if (owner[slot] != none)
+			{
+				new (to + slot) value_type(std::move(*at(slot)));
+				at(slot)->~value_type();
+			}
+		}
+
+		storage = std::move(bigger);
+	}
+
+	uint32_t allocate_handle()
+	{
+		if (!free_handles.empty())
+		{
+			const auto index = free_handles.back();
+			free_handles.pop_back();
+			return index;
+		}
+
+		if (entries.size() >= none)
+			throw std::length_error("compacting_pool: too many objects");
+
+		// room to free every handle, so release_handle() doesn't throw
+		free_handles.reserve(entries.size() + 1);
+		entries.push_back(entry{none, 0});
+		return static_cast<uint32_t>(entries.size() - 1);
+	}
+
+	void release_handle(uint32_t index) noexcept
+	{
+		entries[index].slot = none;
+		++entries[index].generation;
+		free_handles.push_back(index);
+	}
+
+	local_derived_internal::aligned_buffer storage; // slots
+	std::vector<uint32_t> owner; // per used slot, its handle index or none
+	size_t used = 0;             // slots up to the last live one
+	size_t live = 0;             // objects in the pool
+	size_t first_hole = 0;       // no holes before this slot
+
+	std::vector<entry> entries;         // handle index to slot
+	std::vector<uint32_t> free_handles; // unused handle indices
+};
+
+template <class Base, size_t slot_size, size_t alignment>
+constexpr uint32_t compacting_pool<Base, slot_size, alignment>::none;
+
+template <class Base, size_t slot_size, size_t alignment>
+constexpr size_t compacting_pool<Base, slot_size, alignment>::moves_per_clock_check;
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <utility>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+/*
+     A runtime registry of types derived from Base.
+
+     Records the size, alignment, move wrapper and Base subobject offset
+    of each registered type, i.e. what local_derived keeps per object,
+    but known only at runtime. Used by dynamic_local_vector to compute
+    its element stride.
+*/
+template <class Base>
+class local_type_registry
+{
+public:
+	static_assert(std::has_virtual_destructor<Base>::value ||
+	                  allow_nonvirtual_destructor<Base>::value,
+	              "Base must have a virtual destructor.");
+
+	using MovePtr = void (*)(void*, void*);
+	using DestroyPtr = void (*)(void*);
+
+	// Per type information.
+	struct entry
+	{
+		size_t size;
+		size_t alignment;
+		size_t offset;      // offset to the Base subobject
+		MovePtr move;       // move wrapper, also identifies the type
+		DestroyPtr destroy; // nullptr if trivially destructible
+	};
+
+	// Registers U if needed, returns its entry (address is stable).
+	template <class U>
+	const entry& register_type()
+	{
+		static_assert(std::is_base_of<Base, U>::value,
+		              "U must be derived from Base.");
+
+		const auto move = &local_derived_internal::move_wrapper<U>::move;
+
+		if (const auto* e = find(move))
+			return *e;
+
+		entries.push_back(entry{
+		    sizeof(U), alignof(U),
+		    local_derived_internal::get_offset_of_base_within_derived<Base,
+		                                                              U>(),
+		    move, local_derived_internal::destroy_wrapper<U>::get()});
+
+		max_size_ = std::max(max_size_, sizeof(U));
+		max_alignment_ = std::max(max_alignment_, alignof(U));
+
+		return entries.back();
+	}
+
+	// Returns the entry of the type with the given move wrapper, or nullptr.
+	const entry* find(MovePtr move) const noexcept
+	{
+		for (const auto& e : entries)
+		{
+			if (e.move == move)
+				return &e;
+		}
+		return nullptr;
+	}
+
+	// Size of the largest registered type.
+	size_t max_size() const noexcept
+	{
+		return max_size_;
+	}
+
+	// Strictest alignment of the registered types.
+	size_t max_alignment() const noexcept
+	{
+		return max_alignment_;
+	}
+
+	size_t size() const noexcept
+	{
+		return entries.size();
+	}
+
+private:
+	std::deque<entry> entries; // deque: stable addresses
+	size_t max_size_ = sizeof(Base);
+	size_t max_alignment_ = alignof(Base);
+};
+
+/*
+     A vector of polymorphic objects with a runtime element stride.
+
+     Like std::vector<local_derived<Base, size, alignment>>, except size
+    and alignment are taken from a local_type_registry at construction.
+    Objects are destroyed through their registry entries.
+    Emplacing a type that doesn't fit registers it and rebuilds the vector
+    with a larger stride, relocating the objects with their move wrappers.
+
+     Each slot holds a pointer to the registry entry of its object,
+    followed by the object itself.
+
+     Requirements:
+     - the registry outlives the vector
+*/
+template <class Base>
+class dynamic_local_vector
+{
+public:
+	using registry_type = local_type_registry<Base>;
+	using entry = typename registry_type::entry;
+
+	// Uses the registry's current max size and alignment.
+	explicit dynamic_local_vector(registry_type& registry)
+	  : registry(&registry),
+	    layout(make_layout(registry.max_size(), registry.max_alignment()))
+	{
+	}
+
+	dynamic_local_vector(dynamic_local_vector&& other) noexcept
+	  : registry(other.registry),
+	    layout(other.layout),
+	    buffer(std::move(other.buffer)),
+	    count(other.count),
+	    capacity_(other.capacity_)
+	{
+		other.count = 0;
+		other.capacity_ = 0;
+	}
+
+	dynamic_local_vector(const dynamic_local_vector&) = delete;
+	dynamic_local_vector& operator=(const dynamic_local_vector&) = delete;
+	dynamic_local_vector& operator=(dynamic_local_vector&&) = delete;
+
+	~dynamic_local_vector()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	/*
+	    Constructs a U at the end.
+
+	    If U is larger or more strictly aligned than the current slots,
+	    registers it and rebuilds the vector first.
+	*/
+	template <class U, class... Args>
+	Base& emplace_back(Args&&... args)
+	{
+		const auto& e = registry->template register_type<U>();
+
+		if (e.size > payload_size() || e.alignment > layout.alignment)
+			rebuild();
+
+		if (count == capacity_)
+			reallocate(std::max<size_t>(capacity_ * 2, 8), layout);
+
+		auto* slot = slot_at(count);
+		new (payload(slot)) U(std::forward<Args>(args)...);
+		header(slot) = &e;
+		++count;
+
+		return *get(count - 1);
+	}
+
+	// Destroys the last object.
+	void pop_back()
+	{
+		--count;
+		destroy(slot_at(count));
+	}
+
+	// Destroys all objects, keeps the capacity.
+	void clear()
+	{
+		for (size_t i = 0; i < count; ++i)
+			destroy(slot_at(i));
+		count = 0;
+	}
+
+	void reserve(size_t n)
+	{
+		if (n > capacity_)
+			reallocate(n, layout);
+	}
+
+	/*
+	    Adopts the registry's current max size and alignment, if larger
+	    than the current layout. Relocates all objects.
+	*/
+	void rebuild()
+	{
+		if (registry->max_size() <= payload_size() &&
+		    registry->max_alignment() <= layout.alignment)
+			return;
+
+		const auto wider =
+		    make_layout(std::max(registry->max_size(), payload_size()),
+		                std::max(registry->max_alignment(), layout.alignment));
+
+		reallocate(capacity_, wider);
+	}
+
+	/* observers */
+
+	Base* get(size_t i) const noexcept
+	{
+		auto* slot = slot_at(i);
+		return reinterpret_cast<Base*>(
+		    reinterpret_cast<uintptr_t>(payload(slot)) + header(slot)->offset);
+	}
+
+	Base& operator[](size_t i) const noexcept
+	{
+		return *get(i);
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	bool empty() const noexcept
+	{
+		return count == 0;
+	}
+
+	size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+	// Distance between consecutive slots, in bytes.
+	size_t stride() const noexcept
+	{
+		return layout.stride;
+	}
+
+	size_t alignment() const noexcept
+	{
+		return layout.alignment;
+	}
+
+	// Maximum object size fitting in a slot.
+	size_t payload_size() const noexcept
+	{
+		return layout.stride - layout.header_size;
+	}
+
+	/* iteration */
+
+	template <class F>
+	void for_each(F&& f) const
+	{
+		for (size_t i = 0; i < count; ++i)
+			f(*get(i));
+	}
+
+private:
+	using header_type = const entry*;
+
+	// Slot layout: header, padding, object, padding.
+	struct slot_layout
+	{
+		size_t stride;
+		size_t alignment;
+		size_t header_size; // offset of the object within a slot
+	};
+
+	// Computes the slot layout for objects of the given size and alignment.
+	static slot_layout make_layout(size_t max_size, size_t max_alignment)
+	{
+		using local_derived_internal::align_up;
+
+		const auto alignment = std::max(max_alignment, alignof(header_type));
+		const auto header_size = align_up(sizeof(header_type), alignment);
+
+		return slot_layout{align_up(header_size + max_size, alignment),
+		                   alignment, header_size};
+	}
+
+	unsigned char* slot_at(size_t i) const noexcept
+	{
+		return buffer.data() + i * layout.stride;
+	}
+
+	static header_type& header(unsigned char* slot) noexcept
+	{
+		return *reinterpret_cast<header_type*>(slot);
+	}
+
+	unsigned char* payload(unsigned char* slot) const noexcept
+	{
+		return slot + layout.header_size;
+	}
+
+	// Destroys the object in a slot, if it needs destroying.
+	void destroy(unsigned char* slot) const
+	{
+		if (header(slot)->destroy)
+			header(slot)->destroy(payload(slot));
+	}
+
+	/*
+	    Moves all objects into a new buffer of the given capacity and
+	    layout, then destroys the originals.
+	*/
+	void reallocate(size_t new_capacity, const slot_layout& new_layout)
+	{
+		auto new_buffer = local_derived_internal::aligned_buffer(
+		    new_capacity * new_layout.stride, new_layout.alignment);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto* from = slot_at(i);
+			auto* to = new_buffer.data() + i * new_layout.stride;
+
+			const auto* e = header(from);
+			header(to) = e;
+			e->move(payload(from), to + new_layout.header_size);
+			destroy(from);
+		}
+
+		buffer = std::move(new_buffer);
+		capacity_ = new_capacity;
+		layout = new_layout;
+	}
+
+	registry_type* registry;
+	slot_layout layout;
+	local_derived_internal::aligned_buffer buffer;
+	size_t count = 0;
+	size_t capacity_ = 0;
+};
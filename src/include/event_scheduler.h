@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+/*
+     A priority queue of polymorphic events, for discrete-event simulation.
+
+     Events are stored in-place, as local_derived<Event, size>, in slots
+    that never move. The queue itself is a d-ary min-heap of small keys
+    (timestamp, sequence number, slot index): sifts move keys only.
+    Siblings start on a cache line boundary, so with 4 keys of 16 bytes
+    each level of a sift reads one cache line.
+    Events with equal timestamps run in the order they were scheduled.
+
+        event_scheduler<event, 64> s;
+        s.schedule<arrival>(10, ...);
+        while (s.run_next([&](uint64_t now, event& e) { e.fire(s, now); }))
+            ;
+
+     Params:
+      - Event      the base class of events
+      - event_size maximum allowed event size, see local_derived
+      - arity      children per heap node
+      - Time       timestamp type
+      - alignment  minimum event alignment
+
+     Requirements are the same as for local_derived, plus:
+     - arity >= 2
+
+     Slots are numbered with 32 bits; schedule() and reserve() throw
+    std::length_error when more would be needed.
+*/
+template <class Event,
+          size_t event_size,
+          size_t arity = 4,
+          class Time = uint64_t,
+          size_t alignment = alignof(std::max_align_t)>
+class event_scheduler
+{
+public:
+	using value_type = local_derived<Event, event_size, alignment>;
+	using time_type = Time;
+
+	static_assert(arity >= 2, "Requirement: arity >= 2");
+
+	// Heap entry; the event itself stays in its slot.
+	struct key
+	{
+		Time time;
+		uint32_t sequence; // insertion order, breaks ties
+		uint32_t slot;
+	};
+
+	// Slots per chunk of event storage.
+	static constexpr size_t chunk_slots = 1024;
+
+	event_scheduler()
+	{
+	}
+
+	event_scheduler(event_scheduler&& other) noexcept
+	  : key_buffer(std::move(other.key_buffer)),
+	    heap(other.heap),
+	    count(other.count),
+	    key_capacity(other.key_capacity),
+	    chunks(std::move(other.chunks)),
+	    free_slots(std::move(other.free_slots)),
+	    next_sequence(other.next_sequence)
+	{
+		other.heap = nullptr;
+		other.count = 0;
+		other.key_capacity = 0;
+		other.chunks.clear();
+		other.free_slots.clear();
+	}
+
+	event_scheduler(const event_scheduler&) = delete;
+	event_scheduler& operator=(const event_scheduler&) = delete;
+	event_scheduler& operator=(event_scheduler&&) = delete;
+
+	~event_scheduler()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Schedules a U, constructed from args, at time.
+	template <class U, class... Args>
+	void schedule(Time time, Args&&... args)
+	{
+		if (count == key_capacity)
+			reserve_keys(count ? count * 2 : 64);
+
+		const auto slot = allocate_slot();
+		try
+		{
+			new (at(slot))
+			    value_type(emplace_tag_t<U>(), std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			free_slots.push_back(slot); // fits, it was just taken out
+			throw;
+		}
+
+		heap[count++] = key{time, next_sequence++, slot};
+		sift_up(count - 1);
+	}
+
+	/*
+	    Removes the earliest event, calls f(time, event&) and destroys it.
+	    f may schedule new events. Returns false if there was none.
+	*/
+	template <class F>
+	bool run_next(F&& f)
+	{
+		if (count == 0)
+			return false;
+
+		const auto top = heap[0];
+		pop_key();
+
+		auto* e = at(top.slot);
+		f(top.time, **e);
+
+		e->~value_type();
+		free_slots.push_back(top.slot);
+		return true;
+	}
+
+	// Runs events up to and including time. Returns how many ran.
+	template <class F>
+	size_t run_until(Time time, F&& f)
+	{
+		auto ran = size_t(0);
+
+		while (count != 0 && !(time < heap[0].time))
+		{
+			run_next(f);
+			++ran;
+		}
+		return ran;
+	}
+
+	// Destroys all pending events, keeps the storage.
+	void clear()
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			at(heap[i].slot)->~value_type();
+			free_slots.push_back(heap[i].slot);
+		}
+		count = 0;
+	}
+
+	void reserve(size_t n)
+	{
+		if (n > key_capacity)
+			reserve_keys(n);
+		while (chunks.size() * chunk_slots < n)
+			add_chunk();
+	}
+
+	/* observers */
+
+	// Time of the earliest event; requires !empty().
+	Time next_time() const noexcept
+	{
+		return heap[0].time;
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	bool empty() const noexcept
+	{
+		return count == 0;
+	}
+
+private:
+	using slot_type =
+	    std::aligned_storage_t<sizeof(value_type), alignof(value_type)>;
+
+	value_type* at(uint32_t slot) const noexcept
+	{
+		auto* chunk = reinterpret_cast<slot_type*>(chunks[slot / chunk_slots].data());
+		return reinterpret_cast<value_type*>(chunk + slot % chunk_slots);
+	}
+
+	void add_chunk()
+	{
+		const auto first = chunks.size() * chunk_slots;
+		if (first + chunk_slots > std::numeric_limits<uint32_t>::max())
+			throw std::length_error("event_scheduler: too many events");
+
+		// allocate everything first, so a failure leaves no slot behind
+		free_slots.reserve(free_slots.size() + chunk_slots);
+		chunks.emplace_back(chunk_slots * sizeof(slot_type), alignof(slot_type));
+
+		// hand out the lowest slots first
+		for (size_t i = chunk_slots; i-- > 0;)
+			free_slots.push_back(static_cast<uint32_t>(first + i));
+	}
+
+	uint32_t allocate_slot()
+	{
+		if (free_slots.empty())
+			add_chunk();
+
+		const auto slot = free_slots.back();
+		free_slots.pop_back();
+		return slot;
+	}
+
+	void reserve_keys(size_t n)
+	{
+		auto buffer = local_derived_internal::aligned_buffer(
+		    (n + arity - 1) * sizeof(key), 64);
+		auto* keys = reinterpret_cast<key*>(buffer.data()) + (arity - 1);
+
+		std::copy(heap, heap + count, keys);
+
+		key_buffer = std::move(buffer);
+		heap = keys;
+		key_capacity = n;
+	}
+
+	static bool earlier(const key& a, const key& b) noexcept
+	{
+		if (a.time < b.time)
+			return true;
+		if (b.time < a.time)
+			return false;
+
+		// wraps after 2^32 events; compare as a signed distance
+		return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+	}
+
+	void sift_up(size_t i) noexcept
+	{
+		const auto k = heap[i];
+
+		while (i > 0)
+		{
+			const auto parent = (i - 1) / arity;
+			if (!earlier(k, heap[parent]))
+				break;
+
+			heap[i] = heap[parent];
+			i = parent;
+		}
+		heap[i] = k;
+	}
+
+	/*
+	    Removes the root: moves the hole down to a leaf along the earliest
+	    children, then sifts the last key up from there. The last key
+	    usually belongs near the bottom, so this saves a comparison per
+	    level over a plain sift down.
+	*/
+	void pop_key() noexcept
+	{
+		const auto n = --count;
+		if (n == 0)
+			return;
+
+		auto i = size_t(0);
+		for (;;)
+		{
+			const auto first = i * arity + 1;
+			if (first >= n)
+				break;
+
+			const auto last = first + arity < n ? first + arity : n;
+
+			auto best = first;
+			for (auto c = first + 1; c < last; ++c)
+				best = earlier(heap[c], heap[best]) ? c : best;
+
+			heap[i] = heap[best];
+			i = best;
+		}
+
+		heap[i] = heap[n];
+		sift_up(i);
+	}
+
+	// keys, with heap[0] at a cache line offset of arity - 1 keys
+	local_derived_internal::aligned_buffer key_buffer;
+	key* heap = nullptr;
+	size_t count = 0;
+	size_t key_capacity = 0;
+
+	std::vector<local_derived_internal::aligned_buffer> chunks;
+	std::vector<uint32_t> free_slots;
+	uint32_t next_sequence = 0;
+};
+
+template <class Event,
+          size_t event_size,
+          size_t arity,
+          class Time,
+          size_t alignment>
+constexpr size_t
+    event_scheduler<Event, event_size, arity, Time, alignment>::chunk_slots;
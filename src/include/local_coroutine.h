@@ -0,0 +1,366 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "local_coroutine.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+     Allocation-free coroutine frames.
+
+     A coroutine returning local_task, whose first parameter is a
+    frame_allocator (e.g. a local_frame_pool), gets its frame from that
+    allocator instead of the heap:
+
+        local_task handler(frame_allocator& frames, local_scheduler& s)
+        {
+            co_await s.yield();
+        }
+
+        local_frame_pool<256, 1024> pool;
+        local_scheduler scheduler;
+        scheduler.spawn(handler(pool, scheduler));
+        scheduler.run();
+
+    Other local_task coroutines use the global operator new.
+*/
+
+// Interface of a coroutine frame allocator.
+class frame_allocator
+{
+public:
+	virtual void* allocate(size_t bytes) = 0;
+	virtual void deallocate(void* frame, size_t bytes) noexcept = 0;
+
+protected:
+	~frame_allocator() = default;
+};
+
+/*
+     A pool of count in-place frame buffers, of frame_size bytes each.
+
+     Frames larger than frame_size, or allocated while all buffers are in
+    use, fall back to the heap and are counted as overflows; check
+    overflows() and largest_frame() to size the pool.
+
+     Params:
+      - frame_size  size of each buffer
+      - count       number of buffers
+      - alignment   buffer alignment
+
+     Requirements:
+     - frame_size > 0, count > 0
+     - alignment >= alignof(std::max_align_t)
+*/
+template <size_t frame_size,
+          size_t count,
+          size_t alignment = alignof(std::max_align_t)>
+class local_frame_pool final : public frame_allocator
+{
+public:
+	static_assert(frame_size > 0 && count > 0,
+	              "Requirement: frame_size > 0 and count > 0");
+
+	static_assert(alignment >= alignof(std::max_align_t),
+	              "Frames require at least the alignment of max_align_t.");
+
+	local_frame_pool() noexcept
+	{
+		for (size_t i = 0; i < count; ++i)
+			free_list[i] = count - 1 - i;
+	}
+
+	local_frame_pool(const local_frame_pool&) = delete;
+	local_frame_pool& operator=(const local_frame_pool&) = delete;
+
+	void* allocate(size_t bytes) override
+	{
+		largest = bytes > largest ? bytes : largest;
+
+		if (bytes > frame_size || free_count == 0)
+		{
+			++overflow_count;
+			return ::operator new(bytes);
+		}
+
+		return &buffers[free_list[--free_count]];
+	}
+
+	void deallocate(void* frame, size_t bytes) noexcept override
+	{
+		if (!owns(frame))
+		{
+			::operator delete(frame, bytes);
+			return;
+		}
+
+		free_list[free_count++] = static_cast<size_t>(
+		    static_cast<buffer*>(frame) - static_cast<buffer*>(buffers));
+	}
+
+	// Number of frames that didn't fit, and were allocated on the heap.
+	size_t overflows() const noexcept
+	{
+		return overflow_count;
+	}
+
+	// Size of the largest frame requested.
+	size_t largest_frame() const noexcept
+	{
+		return largest;
+	}
+
+	// Number of buffers in use.
+	size_t in_use() const noexcept
+	{
+		return count - free_count;
+	}
+
+private:
+	using buffer = std::aligned_storage_t<frame_size, alignment>;
+
+	bool owns(void* frame) const noexcept
+	{
+		const auto p = reinterpret_cast<uintptr_t>(frame);
+		return p >= reinterpret_cast<uintptr_t>(buffers) &&
+		       p < reinterpret_cast<uintptr_t>(buffers + count);
+	}
+
+	buffer buffers[count];
+	size_t free_list[count]; // indices of free buffers
+	size_t free_count = count;
+	size_t overflow_count = 0;
+	size_t largest = 0;
+};
+
+/*
+     A lazily started coroutine, run by local_scheduler.
+
+     Owns the coroutine until handed to a scheduler.
+*/
+class local_task
+{
+public:
+	struct promise_type
+	{
+		local_task get_return_object() noexcept
+		{
+			return local_task(handle::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void return_void() noexcept
+		{
+		}
+
+		void unhandled_exception() noexcept
+		{
+			std::terminate();
+		}
+
+		// Index among the tasks of the scheduler that owns it.
+		size_t owner_index = 0;
+
+		// Frame from a frame_allocator passed as the first argument.
+		template <class... Args>
+		static void* operator new(size_t bytes,
+		                          frame_allocator& frames,
+		                          Args&...)
+		{
+			// the allocator is saved after the frame for operator delete
+			const auto total = frame_bytes(bytes) + sizeof(frame_allocator*);
+
+			auto* frame = frames.allocate(total);
+			allocator_of(frame, bytes) = &frames;
+			return frame;
+		}
+
+		// Frame from the heap, for other coroutines.
+		static void* operator new(size_t bytes)
+		{
+			const auto total = frame_bytes(bytes) + sizeof(frame_allocator*);
+
+			auto* frame = ::operator new(total);
+			allocator_of(frame, bytes) = nullptr;
+			return frame;
+		}
+
+		static void operator delete(void* frame, size_t bytes) noexcept
+		{
+			auto* frames = allocator_of(frame, bytes);
+			const auto total = frame_bytes(bytes) + sizeof(frame_allocator*);
+
+			if (frames)
+				frames->deallocate(frame, total);
+			else
+				::operator delete(frame, total);
+		}
+
+	private:
+		// Frame size, rounded up for the allocator pointer.
+		static size_t frame_bytes(size_t bytes) noexcept
+		{
+			const auto a = alignof(frame_allocator*);
+			return (bytes + a - 1) / a * a;
+		}
+
+		static frame_allocator*& allocator_of(void* frame,
+		                                      size_t bytes) noexcept
+		{
+			return *reinterpret_cast<frame_allocator**>(
+			    static_cast<unsigned char*>(frame) + frame_bytes(bytes));
+		}
+	};
+
+	using handle = std::coroutine_handle<promise_type>;
+
+	local_task(local_task&& other) noexcept
+	  : coroutine(std::exchange(other.coroutine, nullptr))
+	{
+	}
+
+	local_task(const local_task&) = delete;
+	local_task& operator=(const local_task&) = delete;
+	local_task& operator=(local_task&&) = delete;
+
+	~local_task()
+	{
+		if (coroutine)
+			coroutine.destroy();
+	}
+
+	// Gives up ownership of the coroutine.
+	handle release() noexcept
+	{
+		return std::exchange(coroutine, nullptr);
+	}
+
+private:
+	explicit local_task(handle coroutine) noexcept : coroutine(coroutine)
+	{
+	}
+
+	handle coroutine;
+};
+
+/*
+     A single-threaded round-robin scheduler.
+
+     Resumes spawned tasks in FIFO order until all of them finish, and
+    destroys each finished task, returning its frame to its allocator.
+    Owns every spawned task until it finishes: the destructor also
+    destroys tasks suspended on something other than yield().
+*/
+class local_scheduler
+{
+public:
+	// Awaitable that requeues the current task.
+	struct yield_awaiter
+	{
+		local_scheduler* scheduler;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(local_task::handle h) const
+		{
+			scheduler->ready.push_back(h);
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	local_scheduler()
+	{
+	}
+
+	local_scheduler(const local_scheduler&) = delete;
+	local_scheduler& operator=(const local_scheduler&) = delete;
+
+	~local_scheduler()
+	{
+		for (auto h : tasks)
+			h.destroy();
+	}
+
+	// Takes ownership of a task and queues it.
+	void spawn(local_task&& task)
+	{
+		// make room first, so nothing throws once the task is released
+		tasks.reserve(tasks.size() + 1);
+		ready.emplace_back();
+
+		auto h = task.release();
+		h.promise().owner_index = tasks.size();
+		tasks.push_back(h);
+		ready.back() = h;
+	}
+
+	// Lets other tasks run: co_await scheduler.yield();
+	yield_awaiter yield() noexcept
+	{
+		return yield_awaiter{this};
+	}
+
+	// Runs until no task is ready. Returns the number of resumptions.
+	size_t run()
+	{
+		auto resumed = size_t(0);
+
+		while (!ready.empty())
+		{
+			auto h = ready.front();
+			ready.pop_front();
+
+			h.resume();
+			++resumed;
+
+			if (h.done())
+				finish(h);
+		}
+
+		return resumed;
+	}
+
+	size_t pending() const noexcept
+	{
+		return ready.size();
+	}
+
+private:
+	// Destroys a finished task; the last task takes its index.
+	void finish(local_task::handle h) noexcept
+	{
+		auto& last = tasks.back();
+		last.promise().owner_index = h.promise().owner_index;
+		tasks[last.promise().owner_index] = last;
+		tasks.pop_back();
+
+		h.destroy();
+	}
+
+	std::deque<local_task::handle> ready;
+	std::vector<local_task::handle> tasks; // owned, ready or not
+};
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 #include <limits>
@@ -12,6 +13,43 @@ struct emplace_tag_t
 {
 };
 
+/*
+     Opt-in to store objects whose Base has no virtual destructor.
+
+     local_derived destroys objects through their exact type, so a
+    virtual destructor isn't needed for it. It's still required by
+    default, as it guards against other code deleting through Base*.
+    Specialize as std::true_type to lift the requirement for Base:
+
+        template <>
+        struct allow_nonvirtual_destructor<MyBase> : std::true_type
+        {
+        };
+*/
+template <class Base>
+struct allow_nonvirtual_destructor : std::false_type
+{
+};
+
+/*
+     Opt-in to relocate objects of type U by copying their bytes.
+
+     U is trivially relocatable if moving it to new storage and then
+    destroying the original has the same effect as copying its bytes.
+    That holds for most classes that don't point into themselves, but
+    can't be detected for polymorphic classes. relocate_to() copies such
+    objects with memcpy. Specialize as std::true_type for U:
+
+        template <>
+        struct is_trivially_relocatable<MyDerived> : std::true_type
+        {
+        };
+*/
+template <class U>
+struct is_trivially_relocatable : std::is_trivially_copyable<U>
+{
+};
+
 // forward declarations
 
 namespace local_derived_internal
@@ -24,6 +62,12 @@ size_t add_offsets(size_t other_offset);
 
 template <class U>
 struct move_wrapper;
+
+template <class U>
+struct destroy_wrapper;
+
+template <class Hot>
+struct hot_slot;
 }
 
 
@@ -39,21 +83,26 @@ struct move_wrapper;
       - size       maximum allowed object size (fixed buffer size)
       - alignment  minimum object alignment
       - Offset     small integer for offset within buffer
+      - Hot        optional hot method policy, see invoke_hot()
 
      Requirements:
     Base:
-     - has a virtual destructor
+     - has a virtual destructor, or allow_nonvirtual_destructor<Base>
      - alignof(Base) <= alignment
     Derived:
      - has a move-constructor
      - alignof(Derived) <= alignment
+    Hot (if not void):
+     - Hot::signature is the function type R(Args...) of the hot method
+     - Hot::call<U>(U&, Args...) calls the method of U non-virtually
     Other:
      - size <= std::numeric_limits<Offset>::max
 */
 template <class Base,
           size_t size,
           size_t alignment = alignof(std::max_align_t),
-          class Offset = uint8_t>
+          class Offset = uint8_t,
+          class Hot = void>
 class local_derived
 {
 public:
@@ -64,7 +113,8 @@ public:
 	    size > 0 && size <= std::numeric_limits<Offset>::max(),
 	    "Requirement: 0 < size <= std::numeric_limits<Offset>::max()");
 
-	static_assert(std::has_virtual_destructor<Base>::value,
+	static_assert(std::has_virtual_destructor<Base>::value ||
+	                  allow_nonvirtual_destructor<Base>::value,
 	              "Base must have a virtual destructor.");
 
 	static_assert(alignof(Base) <= alignment,
@@ -123,8 +173,11 @@ public:
 
 	// Constructs by moving other.
 	local_derived(local_derived&& other)
-	  : wrapped_move(other.wrapped_move),
-	    offset(other.offset) // same offset and move
+	  : offset(other.offset),
+	    bitwise(other.bitwise),
+	    hot(other.hot),
+	    wrapped_move(other.wrapped_move),
+	    wrapped_destroy(other.wrapped_destroy) // same offset and functions
 	{
 		wrapped_move(&other.data, &data); // just move the object
 	}
@@ -136,6 +189,7 @@ public:
 	     - U must be derived from Base
 	     - other's storage must be smaller or equal in size
 	     - other's alignment must not be stricter
+	     - other must use the same hot method policy
 	*/
 	template <class U,
 	          size_t other_size,
@@ -143,8 +197,12 @@ public:
 	          class OtherOffset,
 	          class = std::enable_if_t<std::is_base_of<Base, U>::value>>
 	local_derived(
-	    local_derived<U, other_size, other_alignment, OtherOffset>&& other)
-	  : wrapped_move(other.wrapped_move)
+	    local_derived<U, other_size, other_alignment, OtherOffset, Hot>&&
+	        other)
+	  : bitwise(other.bitwise),
+	    hot(other.hot),
+	    wrapped_move(other.wrapped_move),
+	    wrapped_destroy(other.wrapped_destroy)
 	{
 		static_assert(other_size <= size, "other's storage must not be larger");
 		static_assert(other_alignment <= alignment,
@@ -161,10 +219,13 @@ public:
 
 	/* destructor */
 
-	// Destructor calls the virtual destructor of the stored object.
+	/*
+	    Destructor calls the destructor of the stored object directly,
+	    or nothing if it's trivially destructible.
+	*/
 	~local_derived()
 	{
-		get()->~Base();
+		destroy(wrapped_destroy, &data);
 	}
 
 	/* assignment */
@@ -179,8 +240,6 @@ public:
 		static_assert(alignof(U) <= alignment,
 		              "aligment requirement of U must not be stricter");
 
-		get()->~Base(); // call the stored object's destructor
-
 		return (*this = local_derived(val));
 	}
 
@@ -202,10 +261,13 @@ public:
 	{
 		if (&other != this) // self-assignment check
 		{
-			get()->~Base(); // call the stored object's destructor
+			destroy(wrapped_destroy, &data); // destroy the stored object
 
 			offset = other.offset;
+			bitwise = other.bitwise;
+			hot = other.hot;
 			wrapped_move = other.wrapped_move;
+			wrapped_destroy = other.wrapped_destroy;
 			wrapped_move(&other.data, &data); // move the assigned object.
 		}
 		return *this;
@@ -218,6 +280,7 @@ public:
 	     - U must be derived from to Base
 	     - other's storage space must be smaller or equal in size
 	     - other's alignment must not be stricter
+	     - other must use the same hot method policy
 	*/
 	template <class U,
 	          size_t other_size,
@@ -225,17 +288,23 @@ public:
 	          class OtherOffset,
 	          class = std::enable_if_t<std::is_base_of<Base, U>::value>>
 	local_derived& operator=(
-	    local_derived<U, other_size, other_alignment, OtherOffset>&& other)
+	    local_derived<U, other_size, other_alignment, OtherOffset, Hot>&&
+	        other)
 	{
 		static_assert(other_size <= size, "other's storage must not be larger");
 		static_assert(other_alignment <= alignment,
 		              "other's alignment requirement must not be stricter");
 
+		destroy(wrapped_destroy, &data); // destroy the stored object
+
 		// get offset to the Base subobject
 		offset = static_cast<Offset>(
 		    local_derived_internal::add_offsets<Base, U>(other.offset));
-		wrapped_move = other.wrapped_move; // copy the move pointer
-		wrapped_move(&other.data, &data);  // move the assigned object.
+		bitwise = other.bitwise;                 // copy the relocation kind
+		hot = other.hot;                         // copy the hot method pointer
+		wrapped_move = other.wrapped_move;       // copy the move pointer
+		wrapped_destroy = other.wrapped_destroy; // copy the destroy pointer
+		wrapped_move(&other.data, &data);        // move the assigned object.
 
 		return *this;
 	}
@@ -243,6 +312,33 @@ public:
 	// No copy assignment.
 	local_derived& operator=(const local_derived&) = delete;
 
+	/* modifiers */
+
+	/*
+	    Destroys the stored object and constructs a U in its place, from
+	    args. Nothing is moved, and no temporary is made.
+
+	    There is no empty state to fall back to, so if the constructor of U
+	    throws, std::terminate is called.
+
+	    Requirements:
+	     - U must be derived from Base
+	     - args must not refer to the stored object
+	*/
+	template <class U, class... Args>
+	U& emplace(Args&&... args) noexcept
+	{
+		static_assert(std::is_base_of<Base, U>::value,
+		              "U must be derived from Base.");
+		static_assert(sizeof(U) <= size, "size of U must not be larger");
+		static_assert(alignof(U) <= alignment,
+		              "aligment requirement of U must not be stricter");
+		destroy(wrapped_destroy, &data);
+
+		initialize_construction_from_value<U>();
+		return *new (&data) U(std::forward<Args>(args)...);
+	}
+
 	/* observers */
 
 	// Returns the stored pointer.
@@ -265,21 +361,115 @@ public:
 		return get();
 	}
 
+	/* type queries */
+
+	/*
+	    Returns true if the stored object is exactly of type U.
+
+	     Compares the saved move wrapper with the one of U, so it costs
+	    a pointer compare instead of an RTTI lookup.
+	*/
+	template <class U>
+	bool holds() const noexcept
+	{
+		static_assert(std::is_base_of<Base, U>::value,
+		              "U must be derived from Base.");
+
+		return wrapped_move == &local_derived_internal::move_wrapper<U>::move;
+	}
+
+	// Returns true if the stored object is exactly of one of the types Ts.
+	template <class... Ts>
+	bool holds_any_of() const noexcept
+	{
+		const bool matches[] = {false, holds<Ts>()...};
+
+		for (auto m : matches)
+		{
+			if (m)
+				return true;
+		}
+		return false;
+	}
+
+	// Returns the stored object if it's exactly of type U, or nullptr.
+	template <class U>
+	U* get_if() const noexcept
+	{
+		return holds<U>() ? reinterpret_cast<U*>(
+		                        reinterpret_cast<uintptr_t>(&data))
+		                  : nullptr;
+	}
+
+	/*
+	    Calls the hot method of the stored object.
+
+	     The address of Hot::call<U> is saved at construction, so the call
+	    goes directly to U's implementation, without loading the vtable.
+	*/
+	template <class... Args>
+	decltype(auto) invoke_hot(Args&&... args) const
+	{
+		static_assert(!std::is_void<Hot>::value,
+		              "invoke_hot requires a Hot method policy.");
+
+		return hot.invoke(const_cast<void*>(static_cast<const void*>(&data)),
+		                  std::forward<Args>(args)...);
+	}
+
 	/* swap */
 
 	// Exchanges contents.
 	void swap(local_derived& other)
 	{
+		if (&other == this)
+			return;
+
 		std::aligned_storage_t<size, alignment> other_temp; // temporary buffer
 
 		other.wrapped_move(&other.data, &other_temp); // move other to temp
-		wrapped_move(&data, &other.data);             // move this to other
+		destroy(other.wrapped_destroy, &other.data);
+		wrapped_move(&data, &other.data); // move this to other
+		destroy(wrapped_destroy, &data);
 
 		using std::swap;
-		swap(wrapped_move, other.wrapped_move); // swap moves
-		swap(offset, other.offset);             // swap offsets
+		swap(wrapped_move, other.wrapped_move);       // swap moves
+		swap(wrapped_destroy, other.wrapped_destroy); // swap destroys
+		swap(offset, other.offset);                   // swap offsets
+		swap(bitwise, other.bitwise);                 // swap relocation kinds
+		swap(hot, other.hot);                         // swap hot methods
 
 		wrapped_move(&other_temp, &data); // move temp to this
+		destroy(wrapped_destroy, &other_temp);
+	}
+
+	/* relocation */
+
+	/*
+	    Moves this wrapper with the stored object into uninitialized
+	    storage for a local_derived at out, then destroys the stored object
+	    here. Afterwards *this is uninitialized storage too: its destructor
+	    must not run, e.g. the caller constructs or relocates into it.
+
+	    Copies the bytes if the stored object is trivially relocatable,
+	    see is_trivially_relocatable.
+	*/
+	void relocate_to(void* out)
+	{
+		if (bitwise)
+		{
+			std::memcpy(out, static_cast<void*>(this), sizeof(local_derived));
+			return;
+		}
+
+		new (out) local_derived(std::move(*this));
+		destroy(wrapped_destroy, &data);
+	}
+
+	// Returns true if the stored object is trivially relocatable.
+	bool trivially_relocatable() const noexcept
+	{
+		return bitwise;
 	}
 
 private:
@@ -287,8 +477,15 @@ private:
 	template <class U>
 	void initialize_construction_from_value()
 	{
-		// save the move wrapper function
+		// save the move and destroy wrapper functions
 		wrapped_move = &local_derived_internal::move_wrapper<U>::move;
+		wrapped_destroy = local_derived_internal::destroy_wrapper<U>::get();
+
+		// save the hot method of U
+		hot.template initialize<U>();
+
+		// save whether U can be relocated with memcpy
+		bitwise = is_trivially_relocatable<U>::value;
 
 		// get the offset to the base subobject
 		offset = static_cast<Offset>(
@@ -297,20 +494,37 @@ private:
 	}
 
 	using MovePtr = void (*)(void*, void*);
+	using DestroyPtr = void (*)(void*);
+
+	// Destroys the object at memory, if it needs destroying.
+	static void destroy(DestroyPtr wrapped, void* memory)
+	{
+		if (wrapped)
+			wrapped(memory);
+	}
 
 	std::aligned_storage_t<size, alignment> data; // object data
 	Offset offset; // offset to the Base subobject within data
 
+	// true if the stored object is trivially relocatable
+	bool bitwise;
+
+	// pointer to the hot method of the stored object (empty if Hot is void)
+	local_derived_internal::hot_slot<Hot> hot;
+
 	// pointer to a std::move wrapper for the stored object
 	MovePtr wrapped_move;
 
-	template <class, size_t, size_t, class>
+	// pointer to the destructor wrapper, nullptr if trivially destructible
+	DestroyPtr wrapped_destroy;
+
+	template <class, size_t, size_t, class, class>
 	friend class local_derived;
 };
 
-template <class Base, size_t size, size_t alignment, class Offset>
-inline void swap(local_derived<Base, size, alignment, Offset>& lhs,
-                 local_derived<Base, size, alignment, Offset>&
+template <class Base, size_t size, size_t alignment, class Offset, class Hot>
+inline void swap(local_derived<Base, size, alignment, Offset, Hot>& lhs,
+                 local_derived<Base, size, alignment, Offset, Hot>&
                      rhs) noexcept(noexcept(lhs.swap(rhs)))
 {
 	lhs.swap(rhs);
@@ -377,4 +591,66 @@ struct move_wrapper
 		new (out) U(std::move(*reinterpret_cast<U*>(in)));
 	}
 };
+
+// Calls the hot method of U, bypassing virtual dispatch.
+template <class Hot, class U, class R, class... Args>
+struct hot_wrapper
+{
+	// memory - beginning of the object
+	static R call(void* memory, Args... args)
+	{
+		return Hot::template call<U>(*reinterpret_cast<U*>(memory),
+		                             std::forward<Args>(args)...);
+	}
+};
+
+template <class Hot, class Signature>
+struct hot_slot_impl;
+
+// Pointer to the hot method wrapper of the stored object.
+template <class Hot, class R, class... Args>
+struct hot_slot_impl<Hot, R(Args...)>
+{
+	using HotPtr = R (*)(void*, Args...);
+
+	template <class U>
+	void initialize()
+	{
+		invoke = &hot_wrapper<Hot, U, R, Args...>::call;
+	}
+
+	HotPtr invoke;
+};
+
+template <class Hot>
+struct hot_slot : hot_slot_impl<Hot, typename Hot::signature>
+{
+};
+
+// No hot method: nothing to store.
+template <>
+struct hot_slot<void>
+{
+	template <class U>
+	void initialize()
+	{
+	}
+};
+
+// Wrapper for the destructor of U.
+template <class U>
+struct destroy_wrapper
+{
+	// memory - beginning of the object
+	static void destroy(void* memory)
+	{
+		reinterpret_cast<U*>(memory)->~U();
+	}
+
+	// Returns the wrapper, or nullptr if there's nothing to call.
+	static constexpr void (*get())(void*)
+	{
+		return std::is_trivially_destructible<U>::value ? nullptr : &destroy;
+	}
+};
 }
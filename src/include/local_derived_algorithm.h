@@ -0,0 +1,593 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+// Algorithms over ranges of local_derived objects.
+
+namespace local_derived_internal
+{
+template <class It, class V = typename std::iterator_traits<It>::value_type>
+struct is_vector_iterator
+    : std::integral_constant<
+          bool,
+          !std::is_same<V, bool>::value &&
+              (std::is_same<It, typename std::vector<V>::iterator>::value ||
+               std::is_same<It,
+                            typename std::vector<V>::const_iterator>::value)>
+{
+};
+}
+
+/*
+     True if It points into contiguous storage, so the algorithms below
+    can work on the objects through pointers: pointers (also the iterators
+    of std::array in most libraries), std::vector iterators, and in C++20
+    any std::contiguous_iterator. Specialize as std::true_type for other
+    iterators of contiguous containers:
+
+        template <>
+        struct is_contiguous_iterator<MyArray::iterator> : std::true_type
+        {
+        };
+*/
+template <class It>
+struct is_contiguous_iterator
+    : std::integral_constant<
+          bool,
+          std::is_pointer<It>::value ||
+              local_derived_internal::is_vector_iterator<It>::value
+#if defined(__cpp_lib_concepts)
+              || std::contiguous_iterator<It>
+#endif
+          >
+{
+};
+
+namespace local_derived_internal
+{
+template <class It>
+void require_contiguous()
+{
+	static_assert(is_contiguous_iterator<It>::value,
+	              "the range must be contiguous storage, e.g. a std::vector; "
+	              "see is_contiguous_iterator.");
+}
+}
+
+/*
+     A run of objects of type U, placed at a fixed stride.
+
+     For a run within a container of local_derived, stride is the size
+    of the wrapper. For type-segregated storage (e.g. std::vector<U>),
+    stride is sizeof(U) and contiguous() returns true.
+*/
+template <class U>
+class batch_view
+{
+public:
+	batch_view(U* first, size_t count, size_t stride = sizeof(U)) noexcept
+	  : first(first),
+	    count(count),
+	    stride_bytes(stride)
+	{
+	}
+
+	U& operator[](size_t i) const noexcept
+	{
+		return *reinterpret_cast<U*>(reinterpret_cast<uintptr_t>(first) +
+		                             i * stride_bytes);
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	size_t stride() const noexcept
+	{
+		return stride_bytes;
+	}
+
+	// Returns true if the objects form an array, i.e. data()[i] is valid.
+	bool contiguous() const noexcept
+	{
+		return stride_bytes == sizeof(U);
+	}
+
+	U* data() const noexcept
+	{
+		return first;
+	}
+
+private:
+	U* first;
+	size_t count;
+	size_t stride_bytes;
+};
+
+namespace local_derived_internal
+{
+template <class...>
+using void_t = void;
+
+template <class U, class ArgList, class = void>
+struct has_process_batch : std::false_type
+{
+};
+
+template <class U, class... Args>
+struct has_process_batch<
+    U,
+    void (*)(Args...),
+    void_t<decltype(U::process_batch(std::declval<batch_view<U>>(),
+                                     std::declval<Args&>()...))>>
+    : std::true_type
+{
+};
+
+template <class... Us>
+struct batch_dispatcher;
+
+// Maximum size of a run passed to process_batch at once, in bytes.
+const size_t batch_bytes = 16 * 1024;
+}
+
+/*
+     Calls batch kernels for runs of identical dynamic types.
+
+     Splits [first, last) into runs of objects of the same exact type.
+    For a run of one of the types Us, calls
+
+        U::process_batch(batch_view<U>(...), args...)
+
+    once for the whole run, so types with SIMD-friendly fields can process
+    it with one loop. Long runs are split into blocks of about 16 KB, to
+    be processed while still in cache. Objects of other types are passed
+    one by one to fallback(Base&, args...), typically a virtual call.
+
+     Requirements:
+     - [first, last) is contiguous storage of local_derived (e.g. vector),
+       see is_contiguous_iterator
+     - each of Us has a static process_batch(batch_view<U>, Args&...)
+*/
+template <class... Us, class It, class F, class... Args>
+void for_each_batched(It first, It last, F&& fallback, Args&&... args)
+{
+	using wrapper = typename std::iterator_traits<It>::value_type;
+
+	local_derived_internal::require_contiguous<It>();
+
+	while (first != last)
+	{
+		if (!local_derived_internal::batch_dispatcher<Us...>::run(
+		        first, last, sizeof(wrapper), args...))
+		{
+			fallback(**first, args...); // not a batched type
+			++first;
+		}
+	}
+}
+
+namespace local_derived_internal
+{
+// No batched type matched.
+template <>
+struct batch_dispatcher<>
+{
+	template <class It, class... Args>
+	static bool run(It&, It, size_t, Args&...)
+	{
+		return false;
+	}
+};
+
+/*
+     If *first holds U, processes the run of U starting there, advances
+    first past it and returns true. Otherwise tries the rest.
+*/
+template <class U, class... Rest>
+struct batch_dispatcher<U, Rest...>
+{
+	template <class It, class... Args>
+	static bool run(It& first, It last, size_t stride, Args&... args)
+	{
+		static_assert(has_process_batch<U, void (*)(Args...)>::value,
+		              "U must have a static process_batch(batch_view<U>, "
+		              "Args...).");
+
+		auto* head = first->template get_if<U>();
+
+		if (!head)
+			return batch_dispatcher<Rest...>::run(first, last, stride, args...);
+
+		// detecting the run loads every element, so cap its size for the
+		// kernel to find the objects still in L1
+
+		const auto max_count = std::max<size_t>(batch_bytes / stride, 1);
+
+		auto count = size_t(1);
+		for (++first; count < max_count && first != last &&
+		              first->template holds<U>();
+		     ++first)
+			++count;
+
+		U::process_batch(batch_view<U>(head, count, stride), args...);
+		return true;
+	}
+};
+}
+
+namespace local_derived_internal
+{
+// Uninitialized storage for one object of type W.
+template <class W>
+using raw_slot = std::aligned_storage_t<sizeof(W), alignof(W)>;
+
+template <class W>
+W* as_object(raw_slot<W>& slot) noexcept
+{
+	return reinterpret_cast<W*>(&slot);
+}
+
+/*
+     Relocates [first, last) to d_first, front to back, so d_first may
+    overlap the source if it's before first. Runs of trivially relocatable
+    objects are moved with one memmove.
+*/
+template <class W>
+void relocate_forward(W* first, W* last, W* d_first)
+{
+	while (first != last)
+	{
+		auto run = first;
+		while (run != last && run->trivially_relocatable())
+			++run;
+
+		if (run != first)
+		{
+			std::memmove(static_cast<void*>(d_first),
+			             static_cast<const void*>(first),
+			             static_cast<size_t>(run - first) * sizeof(W));
+			d_first += run - first;
+			first = run;
+			continue;
+		}
+
+		first->relocate_to(d_first);
+		++first;
+		++d_first;
+	}
+}
+
+// Same as above, back to front, so d_last may overlap the source after last.
+template <class W>
+void relocate_backward(W* first, W* last, W* d_last)
+{
+	while (first != last)
+	{
+		auto run = last;
+		while (run != first && (run - 1)->trivially_relocatable())
+			--run;
+
+		if (run != last)
+		{
+			d_last -= last - run;
+			std::memmove(static_cast<void*>(d_last),
+			             static_cast<const void*>(run),
+			             static_cast<size_t>(last - run) * sizeof(W));
+			last = run;
+			continue;
+		}
+
+		--last;
+		--d_last;
+		last->relocate_to(d_last);
+	}
+}
+
+// Storage for count objects of type W, see aligned_buffer.
+template <class W>
+local_derived_internal::aligned_buffer make_relocation_buffer(size_t count)
+{
+	return local_derived_internal::aligned_buffer(count * sizeof(W), alignof(W));
+}
+}
+
+/*
+     Algorithms over contiguous ranges of local_derived that relocate
+    objects instead of move-assigning them.
+
+     A move assignment destroys the target, copies the metadata and
+    moves the object, and leaves a moved-from object behind to be
+    destroyed later. These algorithms move each object into storage that
+    is uninitialized at the time, and end the source without another
+    destructor call; trivially relocatable objects (see
+    is_trivially_relocatable) are copied with memcpy, in runs.
+
+     The iterators must point into contiguous storage of local_derived,
+    e.g. a std::vector (see is_contiguous_iterator), and erase_if needs a
+    container with data(). Predicates and key functions take the wrapper,
+    as with the std algorithms. If one throws, the range still holds
+    every object, in unspecified order, and the exception is rethrown.
+*/
+namespace relocating
+{
+/*
+     Relocates n objects from first to uninitialized storage at d_first,
+    which must not overlap. Afterwards the source is uninitialized.
+    Returns the end of the destination.
+*/
+template <class W>
+W* uninitialized_relocate_n(W* first, size_t n, W* d_first)
+{
+	local_derived_internal::relocate_forward(first, first + n, d_first);
+	return d_first + n;
+}
+
+/*
+     Same as std::rotate. Moves the shorter side to a buffer and the
+    longer side with runs of memmove, so each object is relocated at most
+    twice.
+*/
+template <class It>
+It rotate(It first, It middle, It last)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+
+	if (first == middle)
+		return last;
+	if (middle == last)
+		return first;
+
+	auto* f = std::addressof(*first);
+	auto* m = f + (middle - first);
+	auto* l = f + (last - first);
+
+	const auto left = static_cast<size_t>(m - f);
+	const auto right = static_cast<size_t>(l - m);
+	auto buffer =
+	    local_derived_internal::make_relocation_buffer<W>(std::min(left, right));
+	auto* b = reinterpret_cast<W*>(buffer.data());
+
+	if (left <= right)
+	{
+		local_derived_internal::relocate_forward(f, m, b);
+		local_derived_internal::relocate_forward(m, l, f);
+		local_derived_internal::relocate_forward(b, b + left, f + right);
+	}
+	else
+	{
+		local_derived_internal::relocate_forward(m, l, b);
+		local_derived_internal::relocate_backward(f, m, l);
+		local_derived_internal::relocate_forward(b, b + right, f);
+	}
+	return first + (last - middle);
+}
+
+/*
+     Same as std::partition. Keeps one misplaced object aside and moves
+    the hole between the two ends, so each misplaced object is relocated
+    once.
+*/
+template <class It, class Pred>
+It partition(It first, It last, Pred pred)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+
+	auto l = first;
+	auto r = last;
+
+	while (l != r && pred(*l))
+		++l;
+	if (l == r)
+		return l;
+
+	local_derived_internal::raw_slot<W> aside;
+	l->relocate_to(&aside);
+	auto* hole = std::addressof(*l);
+
+	try
+	{
+		for (;;)
+		{
+			do
+				--r;
+			while (r != l && !pred(*r));
+			if (r == l)
+				break;
+			r->relocate_to(hole);
+			hole = std::addressof(*r);
+
+			do
+				++l;
+			while (l != r && pred(*l));
+			if (l == r)
+				break;
+			l->relocate_to(hole);
+			hole = std::addressof(*l);
+		}
+	}
+	catch (...)
+	{
+		// fill the hole, so the range holds valid objects
+		local_derived_internal::as_object<W>(aside)->relocate_to(hole);
+		throw;
+	}
+
+	local_derived_internal::as_object<W>(aside)->relocate_to(hole);
+	return l;
+}
+
+/*
+     Same as std::stable_partition. Relocates the objects for which pred
+    is false to a buffer, closes the gaps, and relocates them back.
+*/
+template <class It, class Pred>
+It stable_partition(It first, It last, Pred pred)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+
+	if (first == last)
+		return first;
+
+	auto* const f = std::addressof(*first);
+	auto* const l = f + (last - first);
+
+	auto buffer = local_derived_internal::make_relocation_buffer<W>(
+	    static_cast<size_t>(l - f));
+	auto* rejected = reinterpret_cast<W*>(buffer.data());
+	auto* rejected_end = rejected;
+
+	auto* out = f;
+	try
+	{
+		for (auto* it = f; it != l; ++it)
+		{
+			if (pred(*it))
+			{
+				if (out != it)
+					it->relocate_to(out);
+				++out;
+			}
+			else
+			{
+				it->relocate_to(rejected_end);
+				++rejected_end;
+			}
+		}
+	}
+	catch (...)
+	{
+		// the rejected objects fill the holes between out and it
+		local_derived_internal::relocate_forward(rejected, rejected_end, out);
+		throw;
+	}
+
+	local_derived_internal::relocate_forward(rejected, rejected_end, out);
+	return first + (out - f);
+}
+
+/*
+     Sorts by key(const W&), stable. Computes each key once, sorts the
+    keys, then relocates each object once into its place, following the
+    cycles of the permutation.
+*/
+template <class It, class Key>
+void sort_by(It first, It last, Key key)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+	using K = std::decay_t<decltype(key(*first))>;
+
+	const auto n = static_cast<size_t>(last - first);
+	if (n < 2)
+		return;
+
+	auto keyed = std::vector<std::pair<K, size_t>>();
+	keyed.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		keyed.emplace_back(key(first[i]), i);
+
+	std::sort(keyed.begin(), keyed.end());
+
+	// source[i] is the index of the object that goes to i
+	auto source = std::vector<size_t>(n);
+	for (size_t i = 0; i < n; ++i)
+		source[i] = keyed[i].second;
+
+	auto* base = std::addressof(*first);
+	local_derived_internal::raw_slot<W> aside;
+
+	for (size_t start = 0; start < n; ++start)
+	{
+		if (source[start] == start)
+			continue;
+
+		base[start].relocate_to(&aside);
+
+		auto hole = start;
+		while (source[hole] != start)
+		{
+			const auto next = source[hole];
+			base[next].relocate_to(base + hole);
+			source[hole] = hole;
+			hole = next;
+		}
+
+		local_derived_internal::as_object<W>(aside)->relocate_to(base + hole);
+		source[hole] = hole;
+	}
+}
+
+/*
+     Erases the objects for which pred is true from a contiguous
+    container, e.g. std::vector. The survivors keep their order. Each
+    survivor after the first erased object is relocated once, and moves
+    at most one erased object out of its way; the erased objects are then
+    destroyed by c.erase() at the end. Returns the number erased.
+*/
+template <class Container, class Pred>
+size_t erase_if(Container& c, Pred pred)
+{
+	using W = typename Container::value_type;
+
+	if (c.empty())
+		return 0;
+
+	auto* const first = c.data();
+	auto* const last = first + c.size();
+
+	auto* write = first;
+	while (write != last && !pred(*write))
+		++write;
+	if (write == last)
+		return 0;
+
+	// [write + 1, read) are erased objects, write is a hole
+	local_derived_internal::raw_slot<W> aside;
+	write->relocate_to(&aside);
+
+	try
+	{
+		for (auto* read = write + 1; read != last; ++read)
+		{
+			if (pred(*read))
+				continue;
+
+			read->relocate_to(write);
+			if (write + 1 != read)
+				(write + 1)->relocate_to(read);
+			++write;
+		}
+	}
+	catch (...)
+	{
+		// fill the hole; nothing is erased
+		local_derived_internal::as_object<W>(aside)->relocate_to(write);
+		throw;
+	}
+
+	local_derived_internal::as_object<W>(aside)->relocate_to(write);
+
+	const auto kept = write - first;
+	c.erase(c.begin() + kept, c.end());
+	return static_cast<size_t>(last - first - kept);
+}
+}
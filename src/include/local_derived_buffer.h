@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace local_derived_internal
+{
+/*
+     An uninitialized heap buffer with a runtime alignment.
+
+     Owns raw memory only; the user constructs and destroys objects in it.
+*/
+class aligned_buffer
+{
+public:
+	aligned_buffer() noexcept
+	{
+	}
+
+	aligned_buffer(size_t bytes, size_t alignment)
+	  : raw(::operator new(bytes + alignment)),
+	    bytes(bytes)
+	{
+		const auto address = reinterpret_cast<uintptr_t>(raw);
+		const auto aligned = (address + alignment - 1) / alignment * alignment;
+
+		memory = reinterpret_cast<unsigned char*>(aligned);
+	}
+
+	aligned_buffer(aligned_buffer&& other) noexcept
+	  : raw(other.raw),
+	    memory(other.memory),
+	    bytes(other.bytes)
+	{
+		other.raw = nullptr;
+		other.memory = nullptr;
+		other.bytes = 0;
+	}
+
+	aligned_buffer& operator=(aligned_buffer&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	aligned_buffer(const aligned_buffer&) = delete;
+	aligned_buffer& operator=(const aligned_buffer&) = delete;
+
+	~aligned_buffer()
+	{
+		::operator delete(raw);
+	}
+
+	void swap(aligned_buffer& other) noexcept
+	{
+		using std::swap;
+		swap(raw, other.raw);
+		swap(memory, other.memory);
+		swap(bytes, other.bytes);
+	}
+
+	unsigned char* data() const noexcept
+	{
+		return memory;
+	}
+
+	size_t size() const noexcept
+	{
+		return bytes;
+	}
+
+private:
+	void* raw = nullptr;             // as returned by operator new
+	unsigned char* memory = nullptr; // aligned start
+	size_t bytes = 0;
+};
+
+// Rounds n up to a multiple of alignment.
+inline size_t align_up(size_t n, size_t alignment) noexcept
+{
+	return (n + alignment - 1) / alignment * alignment;
+}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+
+namespace local_derived_internal
+{
+template <class... Us>
+struct likely_dispatcher;
+}
+
+/*
+     Speculative devirtualization.
+
+     Checks the exact type of the stored object against U1, U2, ... in
+    order, using holds<U>(). On a match, calls fn with a U&, so calls to
+    final overrides of U can be inlined. Otherwise calls fn with a Base&,
+    falling back to virtual dispatch.
+
+     fn must return the same type for all of its argument types.
+
+     Example:
+        dispatch_likely<Circle, Square>(shape, [](auto& s) {
+            return s.area(); // inlined for Circle and Square
+        });
+*/
+template <class... Us, class LD, class F>
+decltype(auto) dispatch_likely(LD& ld, F&& fn)
+{
+	return local_derived_internal::likely_dispatcher<Us...>::dispatch(ld, fn);
+}
+
+/*
+     Per call site histogram of the dynamic types seen by dispatch_likely.
+
+     Use one static instance per call site, and pass it to
+    dispatch_likely to choose the hot type list from data:
+
+        static auto site = dispatch_histogram("render");
+        dispatch_likely<Circle>(shape, draw, site);
+        ...
+        site.print(std::cerr);
+
+     Recording uses RTTI and a hash lookup; it's meant for profiling
+    builds. Not thread-safe.
+*/
+class dispatch_histogram
+{
+public:
+	struct entry
+	{
+		const std::type_info* type;
+		size_t count;
+	};
+
+	explicit dispatch_histogram(const char* name = "") : name(name)
+	{
+	}
+
+	// Records one call on an object of the given dynamic type.
+	void record(const std::type_info& type, bool predicted)
+	{
+		auto& e = counts[std::type_index(type)];
+		e.type = &type;
+		++e.count;
+
+		++(predicted ? hits : misses);
+	}
+
+	// Returns the recorded types, most frequent first.
+	std::vector<entry> sorted() const
+	{
+		auto result = std::vector<entry>();
+		result.reserve(counts.size());
+
+		for (const auto& c : counts)
+			result.push_back(c.second);
+
+		std::sort(result.begin(), result.end(),
+		          [](const entry& a, const entry& b) {
+			          return a.count > b.count;
+			      });
+		return result;
+	}
+
+	// Calls that matched one of the listed types.
+	size_t predicted() const noexcept
+	{
+		return hits;
+	}
+
+	// Calls that fell back to virtual dispatch.
+	size_t mispredicted() const noexcept
+	{
+		return misses;
+	}
+
+	void print(std::ostream& out) const
+	{
+		out << "dispatch site " << name << ": " << hits << " predicted, "
+		    << misses << " virtual\n";
+
+		for (const auto& e : sorted())
+			out << "  " << e.count << "  " << e.type->name() << '\n';
+	}
+
+	void clear()
+	{
+		counts.clear();
+		hits = 0;
+		misses = 0;
+	}
+
+private:
+	const char* name;
+	std::unordered_map<std::type_index, entry> counts;
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+// Same as dispatch_likely above, also recording the type in a histogram.
+template <class... Us, class LD, class F>
+decltype(auto) dispatch_likely(LD& ld, F&& fn, dispatch_histogram& site)
+{
+	site.record(typeid(*ld), ld.template holds_any_of<Us...>());
+
+	return local_derived_internal::likely_dispatcher<Us...>::dispatch(ld, fn);
+}
+
+namespace local_derived_internal
+{
+// No more candidates: virtual call through Base&.
+template <>
+struct likely_dispatcher<>
+{
+	template <class LD, class F>
+	static auto dispatch(LD& ld, F& fn) -> decltype(fn(*ld))
+	{
+		return fn(*ld);
+	}
+};
+
+// Tries U, then the rest.
+template <class U, class... Rest>
+struct likely_dispatcher<U, Rest...>
+{
+	template <class LD, class F>
+	static auto dispatch(LD& ld, F& fn) -> decltype(fn(*ld))
+	{
+		if (auto* p = ld.template get_if<U>())
+			return fn(*p);
+
+		return likely_dispatcher<Rest...>::dispatch(ld, fn);
+	}
+};
+}
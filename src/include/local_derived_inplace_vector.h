@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "local_derived.h"
+
+/*
+     A fixed-capacity vector of local_derived, with all N slots in-place.
+
+     Like std::vector<local_derived<Base, slot_size, alignment>>, but never
+    allocates: use it on the stack or as a member for short-lived lists.
+    Erasing relocates the following elements (move, then destroy).
+
+     Params:
+      - Base       the base class of objects to store
+      - slot_size  maximum allowed object size, see local_derived
+      - N          capacity
+      - alignment  minimum object alignment
+
+     Requirements are the same as for local_derived, plus:
+     - N > 0
+
+     Adding an element when full throws std::bad_alloc, as with
+    std::inplace_vector; try_emplace_back returns nullptr instead.
+*/
+template <class Base,
+          size_t slot_size,
+          size_t N,
+          size_t alignment = alignof(std::max_align_t)>
+class local_derived_inplace_vector
+{
+public:
+	using value_type = local_derived<Base, slot_size, alignment>;
+	using iterator = value_type*;
+	using const_iterator = const value_type*;
+
+	static_assert(N > 0, "Requirement: N > 0");
+
+	local_derived_inplace_vector() noexcept
+	{
+	}
+
+	// Relocates the elements of other, leaving it empty.
+	local_derived_inplace_vector(local_derived_inplace_vector&& other)
+	{
+		for (size_t i = 0; i < other.count; ++i)
+			relocate(other.at(i), at(i));
+
+		count = other.count;
+		other.count = 0;
+	}
+
+	local_derived_inplace_vector(const local_derived_inplace_vector&) = delete;
+	local_derived_inplace_vector& operator=(
+	    const local_derived_inplace_vector&) = delete;
+	local_derived_inplace_vector& operator=(
+	    local_derived_inplace_vector&&) = delete;
+
+	~local_derived_inplace_vector()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Constructs a U at the end. Throws std::bad_alloc if full.
+	template <class U, class... Args>
+	value_type& emplace_back(Args&&... args)
+	{
+		if (count == N)
+			throw std::bad_alloc();
+
+		return *try_emplace_back<U>(std::forward<Args>(args)...);
+	}
+
+	// Constructs a U at the end. Returns nullptr if full.
+	template <class U, class... Args>
+	value_type* try_emplace_back(Args&&... args)
+	{
+		if (count == N)
+			return nullptr;
+
+		auto* v = new (at(count))
+		    value_type(emplace_tag_t<U>(), std::forward<Args>(args)...);
+		++count;
+		return v;
+	}
+
+	// Throws std::bad_alloc if full.
+	void push_back(value_type&& value)
+	{
+		if (count == N)
+			throw std::bad_alloc();
+
+		new (at(count)) value_type(std::move(value));
+		++count;
+	}
+
+	void pop_back() noexcept
+	{
+		at(--count)->~value_type();
+	}
+
+	// Removes the element at pos, relocating the following ones.
+	iterator erase(const_iterator pos)
+	{
+		return erase(pos, pos + 1);
+	}
+
+	// Removes [first, last), relocating the following elements.
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		const auto i = static_cast<size_t>(first - begin());
+		const auto j = static_cast<size_t>(last - begin());
+
+		if (i == j)
+			return begin() + i;
+
+		for (size_t k = i; k < j; ++k)
+			at(k)->~value_type();
+
+		for (size_t k = j; k < count; ++k)
+			relocate(at(k), at(k - (j - i)));
+
+		count -= j - i;
+		return begin() + i;
+	}
+
+	/*
+	    Removes the i-th element, relocating the last one into its place.
+	    Doesn't preserve the order.
+	*/
+	void swap_remove(size_t i)
+	{
+		at(i)->~value_type();
+
+		if (i + 1 != count)
+			relocate(at(count - 1), at(i));
+
+		--count;
+	}
+
+	void clear() noexcept
+	{
+		for (size_t i = 0; i < count; ++i)
+			at(i)->~value_type();
+		count = 0;
+	}
+
+	/* observers */
+
+	value_type& operator[](size_t i) noexcept
+	{
+		return *at(i);
+	}
+
+	const value_type& operator[](size_t i) const noexcept
+	{
+		return *at(i);
+	}
+
+	value_type& back() noexcept
+	{
+		return *at(count - 1);
+	}
+
+	iterator begin() noexcept
+	{
+		return at(0);
+	}
+
+	iterator end() noexcept
+	{
+		return at(count);
+	}
+
+	const_iterator begin() const noexcept
+	{
+		return at(0);
+	}
+
+	const_iterator end() const noexcept
+	{
+		return at(count);
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	bool empty() const noexcept
+	{
+		return count == 0;
+	}
+
+	bool full() const noexcept
+	{
+		return count == N;
+	}
+
+	static constexpr size_t capacity() noexcept
+	{
+		return N;
+	}
+
+private:
+	using slot_type =
+	    std::aligned_storage_t<sizeof(value_type), alignof(value_type)>;
+
+	value_type* at(size_t i) noexcept
+	{
+		return reinterpret_cast<value_type*>(&slots[i]);
+	}
+
+	const value_type* at(size_t i) const noexcept
+	{
+		return reinterpret_cast<const value_type*>(&slots[i]);
+	}
+
+	// Moves from into the raw slot to, then destroys from.
+	static void relocate(value_type* from, value_type* to)
+	{
+		new (to) value_type(std::move(*from));
+		from->~value_type();
+	}
+
+	slot_type slots[N];
+	size_t count = 0;
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// x86 with SSE2 enabled; 32-bit builds without it (e.g. -march=i686)
+// fall back to the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOCAL_DERIVED_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(LOCAL_DERIVED_X86) && (defined(__GNUC__) || defined(__clang__))
+#define LOCAL_DERIVED_TARGET_AVX2 __attribute__((target("avx2")))
+#define LOCAL_DERIVED_CTZ(x) __builtin_ctz(x)
+#elif defined(LOCAL_DERIVED_X86)
+#define LOCAL_DERIVED_TARGET_AVX2
+#define LOCAL_DERIVED_CTZ(x) local_derived_internal::ctz_msvc(x)
+#endif
+
+/*
+     Scans of one byte type tags per element, with runtime CPU dispatch:
+    AVX2 or SSE2 on x86 builds with SSE2 enabled, scalar elsewhere.
+*/
+namespace local_derived_internal
+{
+enum class simd_level
+{
+	scalar,
+	sse2,
+	avx2
+};
+
+/* scalar */
+
+inline size_t count_tags_scalar(const uint8_t* tags, size_t n, uint8_t tag)
+{
+	auto count = size_t(0);
+	for (size_t i = 0; i < n; ++i)
+		count += tags[i] == tag;
+	return count;
+}
+
+inline void find_tags_scalar(const uint8_t* tags,
+                             size_t n,
+                             uint8_t tag,
+                             std::vector<size_t>& out)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (tags[i] == tag)
+			out.push_back(i);
+	}
+}
+
+#if defined(LOCAL_DERIVED_X86)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+inline unsigned ctz_msvc(unsigned x)
+{
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return static_cast<unsigned>(index);
+}
+#endif
+
+/* SSE2, 16 tags per step */
+
+inline size_t count_tags_sse2(const uint8_t* tags, size_t n, uint8_t tag)
+{
+	const auto needle = _mm_set1_epi8(static_cast<char>(tag));
+	const auto zero = _mm_setzero_si128();
+
+	auto total = size_t(0);
+	size_t i = 0;
+
+	while (i + 16 <= n)
+	{
+		// byte counters, flushed before they can overflow
+		auto counters = _mm_setzero_si128();
+
+		for (size_t block = 0; block < 255 && i + 16 <= n; ++block, i += 16)
+		{
+			const auto v =
+			    _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+			counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(v, needle));
+		}
+
+		const auto sums = _mm_sad_epu8(counters, zero);
+		total += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+		         static_cast<size_t>(_mm_extract_epi16(sums, 4));
+	}
+
+	return total + count_tags_scalar(tags + i, n - i, tag);
+}
+
+inline void find_tags_sse2(const uint8_t* tags,
+                           size_t n,
+                           uint8_t tag,
+                           std::vector<size_t>& out)
+{
+	const auto needle = _mm_set1_epi8(static_cast<char>(tag));
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const auto v =
+		    _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+		auto mask =
+		    static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+
+		for (; mask; mask &= mask - 1)
+			out.push_back(i + LOCAL_DERIVED_CTZ(mask));
+	}
+
+	for (; i < n; ++i)
+	{
+		if (tags[i] == tag)
+			out.push_back(i);
+	}
+}
+
+/* AVX2, 32 tags per step */
+
+LOCAL_DERIVED_TARGET_AVX2
+inline size_t count_tags_avx2(const uint8_t* tags, size_t n, uint8_t tag)
+{
+	const auto needle = _mm256_set1_epi8(static_cast<char>(tag));
+	const auto zero = _mm256_setzero_si256();
+
+	auto total = size_t(0);
+	size_t i = 0;
+
+	while (i + 32 <= n)
+	{
+		// byte counters, flushed before they can overflow
+		auto counters = _mm256_setzero_si256();
+
+		for (size_t block = 0; block < 255 && i + 32 <= n; ++block, i += 32)
+		{
+			const auto v =
+			    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+			counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(v, needle));
+		}
+
+		alignas(32) uint64_t sums[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sums),
+		                   _mm256_sad_epu8(counters, zero));
+		total += static_cast<size_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+	}
+
+	return total + count_tags_scalar(tags + i, n - i, tag);
+}
+
+LOCAL_DERIVED_TARGET_AVX2
+inline void find_tags_avx2(const uint8_t* tags,
+                           size_t n,
+                           uint8_t tag,
+                           std::vector<size_t>& out)
+{
+	const auto needle = _mm256_set1_epi8(static_cast<char>(tag));
+
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		const auto v =
+		    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+		auto mask = static_cast<unsigned>(
+		    _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+
+		for (; mask; mask &= mask - 1)
+			out.push_back(i + LOCAL_DERIVED_CTZ(mask));
+	}
+
+	for (; i < n; ++i)
+	{
+		if (tags[i] == tag)
+			out.push_back(i);
+	}
+}
+
+// Returns true if the CPU and OS support AVX2.
+inline bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	const auto osxsave = (info[2] & (1 << 27)) != 0;
+	const auto avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // LOCAL_DERIVED_X86
+
+// The best level supported by this CPU, detected once.
+inline simd_level detected_simd_level()
+{
+#if defined(LOCAL_DERIVED_X86)
+	static const auto level =
+	    cpu_has_avx2() ? simd_level::avx2 : simd_level::sse2;
+	return level;
+#else
+	return simd_level::scalar;
+#endif
+}
+
+// Counts the tags equal to tag.
+inline size_t count_tags(const uint8_t* tags,
+                         size_t n,
+                         uint8_t tag,
+                         simd_level level = detected_simd_level())
+{
+	switch (level)
+	{
+#if defined(LOCAL_DERIVED_X86)
+	case simd_level::avx2:
+		return count_tags_avx2(tags, n, tag);
+	case simd_level::sse2:
+		return count_tags_sse2(tags, n, tag);
+#endif
+	default:
+		return count_tags_scalar(tags, n, tag);
+	}
+}
+
+// Appends the indices of the tags equal to tag to out.
+inline void find_tags(const uint8_t* tags,
+                      size_t n,
+                      uint8_t tag,
+                      std::vector<size_t>& out,
+                      simd_level level = detected_simd_level())
+{
+	switch (level)
+	{
+#if defined(LOCAL_DERIVED_X86)
+	case simd_level::avx2:
+		find_tags_avx2(tags, n, tag, out);
+		break;
+	case simd_level::sse2:
+		find_tags_sse2(tags, n, tag, out);
+		break;
+#endif
+	default:
+		find_tags_scalar(tags, n, tag, out);
+		break;
+	}
+}
+}
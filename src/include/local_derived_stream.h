@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+namespace local_derived_internal
+{
+// Per type operations of a stream record.
+struct stream_ops
+{
+	void (*destroy)(void*); // nullptr if trivially destructible
+	size_t offset;          // offset to the Base subobject
+};
+
+template <class Base, class U>
+struct stream_ops_for
+{
+	static void destroy(void* object)
+	{
+		reinterpret_cast<U*>(object)->~U();
+	}
+
+	static const stream_ops ops;
+};
+
+template <class Base, class U>
+const stream_ops stream_ops_for<Base, U>::ops = {
+    std::is_trivially_destructible<U>::value ? nullptr
+                                             : &stream_ops_for<Base, U>::destroy,
+    get_offset_of_base_within_derived<Base, U>()};
+
+// Precedes each object in a stream.
+struct stream_header
+{
+	const stream_ops* ops;
+	uint32_t object; // offset from the header to the object
+	uint32_t next;   // offset from the header to the next header
+};
+}
+
+/*
+     An append-only stream of polymorphic objects, stored back to back.
+
+     Each object takes its exact size and alignment, plus a small header
+    (type operations, offsets), instead of a fixed-size local_derived
+    slot. Intended for record once, replay many times workloads such
+    as command buffers.
+
+     Objects live in chunks that are never reallocated, so addresses
+    are stable until clear(). Iteration is forward-only.
+
+     Objects are destroyed through their exact type, so Base doesn't need
+    a virtual destructor. If it has none, and neither do the stored types,
+    they are trivially destructible and clear() is O(1).
+
+     Requirements:
+     - alignof(U) <= alignof(std::max_align_t)
+     - sizeof(U) fits in a chunk (see the constructor)
+*/
+template <class Base>
+class local_derived_stream
+{
+	using header = local_derived_internal::stream_header;
+
+	struct chunk
+	{
+		local_derived_internal::aligned_buffer memory;
+		size_t used;
+	};
+
+public:
+	static const size_t alignment = alignof(std::max_align_t);
+
+	// Forward iterator over the stored objects, as Base&.
+	class iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Base;
+		using difference_type = std::ptrdiff_t;
+		using pointer = Base*;
+		using reference = Base&;
+
+		iterator() noexcept
+		{
+		}
+
+		Base& operator*() const noexcept
+		{
+			return *operator->();
+		}
+
+		Base* operator->() const noexcept
+		{
+			const auto* h = current();
+			return reinterpret_cast<Base*>(reinterpret_cast<uintptr_t>(h) +
+			                               h->object + h->ops->offset);
+		}
+
+		iterator& operator++() noexcept
+		{
+			position += current()->next;
+			skip_finished_chunks();
+			return *this;
+		}
+
+		iterator operator++(int) noexcept
+		{
+			auto old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator==(const iterator& other) const noexcept
+		{
+			return index == other.index && position == other.position;
+		}
+
+		bool operator!=(const iterator& other) const noexcept
+		{
+			return !(*this == other);
+		}
+
+	private:
+		friend class local_derived_stream;
+
+		iterator(const std::vector<chunk>* chunks, size_t index) noexcept
+		  : chunks(chunks),
+		    index(index)
+		{
+			skip_finished_chunks();
+		}
+
+		const header* current() const noexcept
+		{
+			return reinterpret_cast<const header*>(
+			    (*chunks)[index].memory.data() + position);
+		}
+
+		// Moves to the next non-empty chunk at the end of the current one.
+		void skip_finished_chunks() noexcept
+		{
+			while (index < chunks->size() &&
+			       position == (*chunks)[index].used)
+			{
+				++index;
+				position = 0;
+			}
+		}
+
+		const std::vector<chunk>* chunks = nullptr;
+		size_t index = 0;
+		size_t position = 0;
+	};
+
+	// chunk_bytes - size of each memory chunk
+	explicit local_derived_stream(size_t chunk_bytes = 64 * 1024)
+	  : chunk_bytes(chunk_bytes)
+	{
+	}
+
+	local_derived_stream(local_derived_stream&& other) noexcept
+	  : chunks(std::move(other.chunks)),
+	    last(other.last),
+	    chunk_bytes(other.chunk_bytes),
+	    count(other.count),
+	    nontrivial(other.nontrivial)
+	{
+		other.chunks.clear();
+		other.last = 0;
+		other.count = 0;
+		other.nontrivial = 0;
+	}
+
+	local_derived_stream& operator=(local_derived_stream&&) = delete;
+
+	local_derived_stream(const local_derived_stream&) = delete;
+	local_derived_stream& operator=(const local_derived_stream&) = delete;
+
+	~local_derived_stream()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Appends a U constructed in-place.
+	template <class U, class... Args>
+	U& emplace_back(Args&&... args)
+	{
+		static_assert(std::is_base_of<Base, U>::value,
+		              "U must be derived from Base.");
+		static_assert(alignof(U) <= alignment,
+		              "aligment requirement of U must not be stricter");
+
+		auto r = record();
+		auto* h = reinterpret_cast<header*>(allocate(sizeof(U), alignof(U), r));
+		auto* u = new (reinterpret_cast<unsigned char*>(h) + r.object)
+		    U(std::forward<Args>(args)...);
+
+		const auto& ops = local_derived_internal::stream_ops_for<Base, U>::ops;
+		*h = header{&ops, static_cast<uint32_t>(r.object),
+		            static_cast<uint32_t>(r.next)};
+
+		++count;
+		if (ops.destroy)
+			++nontrivial;
+
+		return *u;
+	}
+
+	// Appends a U, by copy or move.
+	template <class U,
+	          class = std::enable_if_t<
+	              std::is_base_of<Base, std::remove_reference_t<U>>::value>>
+	void push_back(U&& val)
+	{
+		emplace_back<std::decay_t<U>>(std::forward<U>(val));
+	}
+
+	/*
+	    Destroys all objects, keeps the memory.
+
+	    O(1) if all objects are trivially destructible.
+	*/
+	void clear() noexcept
+	{
+		if (nontrivial)
+		{
+			for (auto it = begin(); it != end(); ++it)
+			{
+				const auto* h = it.current();
+				if (h->ops->destroy)
+				{
+					h->ops->destroy(const_cast<unsigned char*>(
+					    reinterpret_cast<const unsigned char*>(h) + h->object));
+				}
+			}
+		}
+
+		for (size_t i = 0; i <= last && i < chunks.size(); ++i)
+			chunks[i].used = 0;
+
+		last = 0;
+		count = 0;
+		nontrivial = 0;
+	}
+
+	/* observers */
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	bool empty() const noexcept
+	{
+		return count == 0;
+	}
+
+	// Bytes used by objects and headers.
+	size_t bytes_used() const noexcept
+	{
+		auto bytes = size_t(0);
+		for (const auto& c : chunks)
+			bytes += c.used;
+		return bytes;
+	}
+
+	/* iteration */
+
+	// Calls f(Base&) on each object; a tighter loop than the iterators.
+	template <class F>
+	void for_each(F&& f) const
+	{
+		for (const auto& c : chunks)
+		{
+			auto* position = c.memory.data();
+			auto* const end = position + c.used;
+
+			while (position != end)
+			{
+				const auto* h = reinterpret_cast<const header*>(position);
+				f(*reinterpret_cast<Base*>(position + h->object +
+				                           h->ops->offset));
+				position += h->next;
+			}
+		}
+	}
+
+	iterator begin() const noexcept
+	{
+		return iterator(&chunks, 0);
+	}
+
+	iterator end() const noexcept
+	{
+		return iterator(&chunks, chunks.size());
+	}
+
+private:
+	// Offsets of the object and the next header, from the header of a record.
+	struct record
+	{
+		size_t object;
+		size_t next;
+	};
+
+	/*
+	    Layout of a record for an object of the given size and alignment,
+	    starting at offset used of a chunk. Chunks are aligned to
+	    alignment, so aligning the offset within the chunk aligns the
+	    object's address.
+	*/
+	static record record_at(size_t used, size_t size, size_t align) noexcept
+	{
+		using local_derived_internal::align_up;
+
+		const auto object = align_up(used + sizeof(header), align) - used;
+		return record{object, align_up(object + size, alignof(header))};
+	}
+
+	// Returns space for a record in the last chunk, and its layout in r.
+	unsigned char* allocate(size_t size, size_t align, record& r)
+	{
+		if (!chunks.empty())
+			r = record_at(chunks[last].used, size, align);
+
+		if (chunks.empty() || chunks[last].used + r.next > chunk_capacity(last))
+		{
+			r = record_at(0, size, align);
+			next_chunk(r.next);
+		}
+
+		auto& c = chunks[last];
+		auto* start = c.memory.data() + c.used;
+		c.used += r.next;
+		return start;
+	}
+
+	size_t chunk_capacity(size_t i) const noexcept
+	{
+		return chunks[i].memory.size();
+	}
+
+	// Moves to a (possibly reused) chunk that can hold bytes.
+	void next_chunk(size_t bytes)
+	{
+		if (!chunks.empty())
+			++last;
+
+		// a reused chunk too small for this record stays for later ones;
+		// a new chunk is inserted before it
+		if (last == chunks.size() || chunk_capacity(last) < bytes)
+		{
+			chunks.insert(chunks.begin() + last,
+			              chunk{local_derived_internal::aligned_buffer(
+			                        std::max(chunk_bytes, bytes), alignment),
+			                    0});
+		}
+	}
+
+	std::vector<chunk> chunks;
+	size_t last = 0; // index of the chunk being filled
+	size_t chunk_bytes;
+	size_t count = 0;
+	size_t nontrivial = 0; // objects with a non-trivial destructor
+};
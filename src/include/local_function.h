@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "local_derived.h"
+
+/*
+     A move-only callable, stored in-place.
+
+     Like std::function, but the callable is always stored in a fixed
+    buffer, and the invoker is stored next to the move and destroy
+    pointers: a call is one indirect call.
+
+        local_function<int(int) const, 32> f = [k](int x) { return k * x; };
+
+     Params:
+      - Signature  R(Args...), optionally const and (since C++17) noexcept
+      - size       maximum allowed callable size (fixed buffer size)
+      - alignment  minimum callable alignment
+
+     Requirements:
+    Callable:
+     - has a move-constructor
+     - sizeof(Callable) <= size, alignof(Callable) <= alignment
+     - callable with Args..., as const if Signature is const,
+       with a result convertible to R
+     - the call and the conversion noexcept, if Signature is noexcept
+    Other:
+     - size > 0
+
+     Calling an empty local_function throws std::bad_function_call
+    (terminates, if Signature is noexcept).
+*/
+template <class Signature,
+          size_t size,
+          size_t alignment = alignof(std::max_align_t)>
+class local_function;
+
+namespace local_function_internal
+{
+template <class...>
+using void_t = void;
+
+template <class F, class R, class ArgList, class = void>
+struct is_callable_r : std::false_type
+{
+};
+
+template <class F, class R, class... Args>
+struct is_callable_r<
+    F,
+    R,
+    void (*)(Args...),
+    void_t<decltype(std::declval<F>()(std::declval<Args>()...))>>
+    : std::integral_constant<
+          bool,
+          std::is_void<R>::value ||
+              std::is_convertible<decltype(std::declval<F>()(
+                                      std::declval<Args>()...)),
+                                  R>::value>
+{
+};
+
+template <class F, class R, class ArgList, class = void>
+struct is_nothrow_callable_r : std::false_type
+{
+};
+
+template <class F, class R, class... Args>
+struct is_nothrow_callable_r<
+    F,
+    R,
+    void (*)(Args...),
+    void_t<decltype(std::declval<F>()(std::declval<Args>()...))>>
+    : std::integral_constant<bool,
+                             noexcept(static_cast<R>(std::declval<F>()(
+                                 std::declval<Args>()...)))>
+{
+};
+
+[[noreturn]] inline void throw_bad_function_call()
+{
+	throw std::bad_function_call();
+}
+
+// Calls the stored callable of type F.
+template <class F, bool Const, bool Noexcept, class R, class... Args>
+struct invoke_wrapper
+{
+	using object = std::conditional_t<Const, const F, F>;
+
+	// memory - beginning of the callable
+	static R invoke(void* memory, Args&&... args) noexcept(Noexcept)
+	{
+		return static_cast<R>((*reinterpret_cast<object*>(memory))(
+		    std::forward<Args>(args)...));
+	}
+};
+
+// Invoker of an empty local_function.
+template <bool Noexcept, class R, class... Args>
+struct empty_wrapper
+{
+	static R invoke(void*, Args&&...) noexcept(Noexcept)
+	{
+		throw_bad_function_call();
+	}
+};
+
+/*
+     Storage shared by the local_function specializations.
+*/
+template <size_t size,
+          size_t alignment,
+          bool Const,
+          bool Noexcept,
+          class R,
+          class... Args>
+class function_base
+{
+public:
+	static_assert(size > 0, "Requirement: size > 0");
+
+	/* constructors */
+
+	function_base() noexcept
+	{
+	}
+
+	function_base(std::nullptr_t) noexcept
+	{
+	}
+
+	// Constructs by moving or copying a callable.
+	template <class F,
+	          class U = std::decay_t<F>,
+	          class = std::enable_if_t<!std::is_base_of<function_base, U>::value &&
+	                                   !std::is_same<U, std::nullptr_t>::value>>
+	function_base(F&& f) noexcept(
+	    std::is_nothrow_constructible<U, F&&>::value)
+	{
+		static_assert(sizeof(U) <= size, "size of F must not be larger");
+		static_assert(alignof(U) <= alignment,
+		              "aligment requirement of F must not be stricter");
+		static_assert(
+		    is_callable_r<std::conditional_t<Const, const U&, U&>,
+		                  R,
+		                  void (*)(Args...)>::value,
+		    "F must be callable with Args..., returning R.");
+		static_assert(
+		    !Noexcept ||
+		        is_nothrow_callable_r<std::conditional_t<Const, const U&, U&>,
+		                              R,
+		                              void (*)(Args...)>::value,
+		    "F must be noexcept when called, for a noexcept signature.");
+
+		new (&data) U(std::forward<F>(f));
+		initialize<U>();
+	}
+
+	function_base(function_base&& other) noexcept
+	{
+		move_from(other);
+	}
+
+	function_base& operator=(function_base&& other) noexcept
+	{
+		if (&other != this)
+		{
+			reset();
+			move_from(other);
+		}
+		return *this;
+	}
+
+	function_base(const function_base&) = delete;
+	function_base& operator=(const function_base&) = delete;
+
+	~function_base()
+	{
+		reset();
+	}
+
+	/* modifiers */
+
+	// Destroys the callable, if any.
+	void reset() noexcept
+	{
+		if (wrapped_destroy)
+			wrapped_destroy(&data);
+
+		invoker = &empty_wrapper<Noexcept, R, Args...>::invoke;
+		wrapped_move = nullptr;
+		wrapped_destroy = nullptr;
+	}
+
+	void swap(function_base& other) noexcept
+	{
+		if (&other == this)
+			return;
+
+		function_base tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+	/* observers */
+
+	explicit operator bool() const noexcept
+	{
+		return wrapped_move != nullptr;
+	}
+
+protected:
+	using InvokePtr = R (*)(void*, Args&&...);
+
+	R call(Args&&... args) const noexcept(Noexcept)
+	{
+		return invoker(const_cast<data_t*>(&data), std::forward<Args>(args)...);
+	}
+
+private:
+	template <class U>
+	void initialize() noexcept
+	{
+		invoker = &invoke_wrapper<U, Const, Noexcept, R, Args...>::invoke;
+		wrapped_move = &local_derived_internal::move_wrapper<U>::move;
+		wrapped_destroy = local_derived_internal::destroy_wrapper<U>::get();
+	}
+
+	// Moves the callable out of other, leaving it empty.
+	void move_from(function_base& other) noexcept
+	{
+		if (!other)
+			return;
+
+		other.wrapped_move(&other.data, &data);
+		invoker = other.invoker;
+		wrapped_move = other.wrapped_move;
+		wrapped_destroy = other.wrapped_destroy;
+		other.reset();
+	}
+
+	using data_t = std::aligned_storage_t<size, alignment>;
+	using MovePtr = void (*)(void*, void*);
+	using DestroyPtr = void (*)(void*);
+
+	data_t data;
+	InvokePtr invoker = &empty_wrapper<Noexcept, R, Args...>::invoke;
+	MovePtr wrapped_move = nullptr;
+	DestroyPtr wrapped_destroy = nullptr;
+};
+}
+
+template <class R, class... Args, size_t size, size_t alignment>
+class local_function<R(Args...), size, alignment>
+  : public local_function_internal::
+        function_base<size, alignment, false, false, R, Args...>
+{
+	using base =
+	    local_function_internal::function_base<size, alignment, false, false, R, Args...>;
+
+public:
+	using base::base;
+	local_function() = default;
+
+	R operator()(Args... args)
+	{
+		return this->call(std::forward<Args>(args)...);
+	}
+};
+
+template <class R, class... Args, size_t size, size_t alignment>
+class local_function<R(Args...) const, size, alignment>
+  : public local_function_internal::
+        function_base<size, alignment, true, false, R, Args...>
+{
+	using base =
+	    local_function_internal::function_base<size, alignment, true, false, R, Args...>;
+
+public:
+	using base::base;
+	local_function() = default;
+
+	R operator()(Args... args) const
+	{
+		return this->call(std::forward<Args>(args)...);
+	}
+};
+
+#if defined(__cpp_noexcept_function_type)
+
+template <class R, class... Args, size_t size, size_t alignment>
+class local_function<R(Args...) noexcept, size, alignment>
+  : public local_function_internal::
+        function_base<size, alignment, false, true, R, Args...>
+{
+	using base =
+	    local_function_internal::function_base<size, alignment, false, true, R, Args...>;
+
+public:
+	using base::base;
+	local_function() = default;
+
+	R operator()(Args... args) noexcept
+	{
+		return this->call(std::forward<Args>(args)...);
+	}
+};
+
+template <class R, class... Args, size_t size, size_t alignment>
+class local_function<R(Args...) const noexcept, size, alignment>
+  : public local_function_internal::
+        function_base<size, alignment, true, true, R, Args...>
+{
+	using base =
+	    local_function_internal::function_base<size, alignment, true, true, R, Args...>;
+
+public:
+	using base::base;
+	local_function() = default;
+
+	R operator()(Args... args) const noexcept
+	{
+		return this->call(std::forward<Args>(args)...);
+	}
+};
+
+#endif
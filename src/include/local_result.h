@@ -0,0 +1,294 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "local_derived.h"
+
+// tag type for constructing the value of a local_result in-place
+struct value_tag_t
+{
+};
+
+/*
+     Holds either a value of type T, or an error of any type derived from
+    ErrorBase, in-place.
+
+     The error is a local_derived<ErrorBase, size>, so it's stored and
+    moved the same way, without allocating. Passing an error up to a
+    caller with another value type costs one relocation:
+
+        local_result<config, parse_error, 32> load(...)
+        {
+            auto r = read_file(...); // local_result<text, parse_error, 32>
+            if (!r)
+                return std::move(r).error();
+
+            if (r->empty())
+                return missing_field("name");
+
+            return config(*r);
+        }
+
+     Params:
+      - T          the value type
+      - ErrorBase  the base class of errors
+      - size       maximum allowed error size, see local_derived
+      - alignment  minimum error alignment
+
+     Requirements are the same as for local_derived, plus:
+     - T must be move constructible, and nothrow move constructible for
+       move assignment
+     - errors must not throw when moved
+     - T must not be derived from ErrorBase
+*/
+template <class T,
+          class ErrorBase,
+          size_t size,
+          size_t alignment = alignof(std::max_align_t)>
+class local_result
+{
+public:
+	using value_type = T;
+	using error_type = local_derived<ErrorBase, size, alignment>;
+
+	static_assert(!std::is_base_of<ErrorBase, T>::value,
+	              "T must not be derived from ErrorBase.");
+
+	/* constructors */
+
+	// Constructs with a value.
+	local_result(const T& value) : ok(true)
+	{
+		new (&data) T(value);
+	}
+
+	// Constructs with a value.
+	local_result(T&& value) : ok(true)
+	{
+		new (&data) T(std::move(value));
+	}
+
+	// Constructs the value in-place from args.
+	template <class... Args>
+	explicit local_result(value_tag_t, Args&&... args) : ok(true)
+	{
+		new (&data) T(std::forward<Args>(args)...);
+	}
+
+	// Constructs with an error, by copying or moving a derived class instance.
+	template <class E,
+	          class = std::enable_if_t<
+	              std::is_base_of<ErrorBase, std::decay_t<E>>::value>>
+	local_result(E&& error) : ok(false)
+	{
+		new (&data) error_type(std::forward<E>(error));
+	}
+
+	/*
+	    Constructs an error in-place.
+
+	    Use emplace_tag_t<E>() as the first parameter
+	    to indicate the error class to emplace.
+	*/
+	template <class E, class... Args>
+	local_result(emplace_tag_t<E> tag, Args&&... args) : ok(false)
+	{
+		new (&data) error_type(tag, std::forward<Args>(args)...);
+	}
+
+	/*
+	    Constructs with the error of another result, e.g. from
+	    std::move(r).error(). Moves it, without allocating.
+
+	    Requirements are the same as for the converting move constructor of
+	    local_derived.
+	*/
+	template <class E,
+	          size_t other_size,
+	          size_t other_alignment,
+	          class Offset,
+	          class Hot>
+	local_result(
+	    local_derived<E, other_size, other_alignment, Offset, Hot>&& error)
+	  : ok(false)
+	{
+		new (&data) error_type(std::move(error));
+	}
+
+	// Constructs by moving other.
+	local_result(local_result&& other) noexcept(
+	    std::is_nothrow_move_constructible<T>::value)
+	  : ok(other.ok)
+	{
+		if (ok)
+			new (&data) T(std::move(*other.value_ptr()));
+		else
+			new (&data) error_type(std::move(*other.error_ptr()));
+	}
+
+	// No copy constructor.
+	local_result(const local_result&) = delete;
+
+	/* destructor */
+
+	~local_result()
+	{
+		destroy();
+	}
+
+	/* assignment */
+
+	/*
+	    Assigns by moving other. Destroys the held value or error first,
+	    so the move that follows must not throw, or this would be left
+	    holding neither.
+	*/
+	local_result& operator=(local_result&& other) noexcept
+	{
+		static_assert(std::is_nothrow_move_constructible<T>::value,
+		              "move assignment requires T to be nothrow move "
+		              "constructible.");
+
+		if (&other == this)
+			return *this;
+
+		destroy();
+		ok = other.ok;
+		if (ok)
+			new (&data) T(std::move(*other.value_ptr()));
+		else
+			new (&data) error_type(std::move(*other.error_ptr()));
+		return *this;
+	}
+
+	// No copy assignment.
+	local_result& operator=(const local_result&) = delete;
+
+	/* observers */
+
+	// Returns true if this holds a value.
+	bool has_value() const noexcept
+	{
+		return ok;
+	}
+
+	// Returns true if this holds a value.
+	explicit operator bool() const noexcept
+	{
+		return ok;
+	}
+
+	// Returns true if this holds an error of exactly type E.
+	template <class E>
+	bool has_error() const noexcept
+	{
+		return !ok && error_ptr()->template holds<E>();
+	}
+
+	/*
+	    Returns the value.
+
+	    Requirements:
+	     - this must hold a value
+	*/
+	T& value() & noexcept
+	{
+		assert(ok && "local_result holds an error");
+		return *value_ptr();
+	}
+
+	const T& value() const & noexcept
+	{
+		assert(ok && "local_result holds an error");
+		return *value_ptr();
+	}
+
+	T&& value() && noexcept
+	{
+		assert(ok && "local_result holds an error");
+		return std::move(*value_ptr());
+	}
+
+	T& operator*() & noexcept
+	{
+		return value();
+	}
+
+	const T& operator*() const & noexcept
+	{
+		return value();
+	}
+
+	T* operator->() noexcept
+	{
+		return &value();
+	}
+
+	const T* operator->() const noexcept
+	{
+		return &value();
+	}
+
+	// Returns the value, or fallback if this holds an error.
+	template <class U>
+	T value_or(U&& fallback) const &
+	{
+		return ok ? *value_ptr() : static_cast<T>(std::forward<U>(fallback));
+	}
+
+	/*
+	    Returns the error.
+
+	    Requirements:
+	     - this must hold an error
+	*/
+	error_type& error() & noexcept
+	{
+		assert(!ok && "local_result holds a value");
+		return *error_ptr();
+	}
+
+	const error_type& error() const & noexcept
+	{
+		assert(!ok && "local_result holds a value");
+		return *error_ptr();
+	}
+
+	// Returns the error, to be moved to another result.
+	error_type&& error() && noexcept
+	{
+		assert(!ok && "local_result holds a value");
+		return std::move(*error_ptr());
+	}
+
+private:
+	T* value_ptr() const noexcept
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(&data));
+	}
+
+	error_type* error_ptr() const noexcept
+	{
+		return reinterpret_cast<error_type*>(reinterpret_cast<uintptr_t>(&data));
+	}
+
+	void destroy()
+	{
+		if (ok)
+			value_ptr()->~T();
+		else
+			error_ptr()->~error_type();
+	}
+
+	static constexpr size_t storage_size =
+	    sizeof(T) > sizeof(error_type) ? sizeof(T) : sizeof(error_type);
+	static constexpr size_t storage_alignment =
+	    alignof(T) > alignof(error_type) ? alignof(T) : alignof(error_type);
+
+	std::aligned_storage_t<storage_size, storage_alignment> data;
+	bool ok;
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include "local_derived.h"
+
+namespace local_state_machine_internal
+{
+// The address of id identifies U, without requiring U to be complete.
+template <class U>
+struct state_id
+{
+	static const char id;
+};
+
+template <class U>
+const char state_id<U>::id = 0;
+}
+
+/*
+     Result of handling an event: either stay in the current state, or
+    move to the state of type U, returned by to<U>().
+
+     U is identified by address alone, so a state may return a transition
+    to a state that is declared after it.
+*/
+class state_transition
+{
+public:
+	// Stays in the current state.
+	state_transition() noexcept = default;
+
+	// Moves to the state of type U.
+	template <class U>
+	static state_transition to() noexcept
+	{
+		return state_transition(&local_state_machine_internal::state_id<U>::id);
+	}
+
+	// Stays in the current state.
+	static state_transition stay() noexcept
+	{
+		return state_transition();
+	}
+
+	// Returns true if this is not a transition.
+	bool stays() const noexcept
+	{
+		return target == nullptr;
+	}
+
+	// Returns true if this is a transition to U.
+	template <class U>
+	bool is() const noexcept
+	{
+		return target == &local_state_machine_internal::state_id<U>::id;
+	}
+
+private:
+	explicit state_transition(const void* target) noexcept : target(target)
+	{
+	}
+
+	const void* target = nullptr;
+
+	template <class State, class Event, class... States>
+	friend class local_state_machine;
+};
+
+/*
+     A state machine that keeps the current state in-place.
+
+     The current state is a local_derived<State, size>, with size and
+    alignment large enough for any of States. process(e) calls the event
+    handler of the current state, which returns the next state's type.
+    The engine then destroys the current state and constructs the next
+    one directly in the same buffer, with no temporary and no move.
+
+     The next state is constructed from the event if it's constructible
+    from const Event&, or else by default. A state that is neither can
+    only be entered with transition(args...).
+
+        class state
+        {
+        public:
+            virtual ~state() {}
+            virtual state_transition on_event(const char& c) = 0;
+        };
+
+        class idle : public state
+        {
+            state_transition on_event(const char& c) override
+            {
+                return c == '$' ? state_transition::to<command>()
+                                : state_transition::stay();
+            }
+        };
+
+        local_state_machine<state, char, idle, command> m{
+            emplace_tag_t<idle>()};
+        m.process('$'); // m.in<command>() == true
+
+     Params:
+      - State   the base class of states
+      - Event   the type of events
+      - States  all states that may be entered
+
+     Requirements:
+     - State must declare state_transition on_event(const Event&)
+     - each of States must be derived from State
+     - each of States must be nothrow destructible, and its constructor
+       must not throw, as there is no empty state to fall back to
+
+     A transition to a type that is not one of States leaves the event
+    unhandled: the current state is kept, and process() returns false,
+    in debug and release builds alike.
+*/
+template <class State, class Event, class... States>
+class local_state_machine
+{
+public:
+	static_assert(sizeof...(States) > 0, "Requirement: at least one state");
+
+	static constexpr size_t state_count = sizeof...(States);
+
+	// Size and alignment of the largest of States.
+	static constexpr size_t state_size = std::max({sizeof(States)...});
+	static constexpr size_t state_alignment = std::max({alignof(States)...});
+
+	using value_type = local_derived<State, state_size, state_alignment>;
+
+	/*
+	    Starts in the state of type U, constructed from args.
+
+	    Use emplace_tag_t<U>() as the first parameter
+	*/
+	template <class U, class... Args>
+	explicit local_state_machine(emplace_tag_t<U> tag, Args&&... args)
+	  : current(tag, std::forward<Args>(args)...), current_index(index_of<U>())
+	{
+		static_assert(index_of<U>() < state_count, "U must be one of States.");
+	}
+
+	local_state_machine(const local_state_machine&) = delete;
+	local_state_machine& operator=(const local_state_machine&) = delete;
+
+	/*
+	    Handles e in the current state, and enters the next state if the
+	    handler returns a transition.
+
+	    Returns true if the state changed; false if the handler stayed,
+	    or returned a transition to a type not in States.
+	*/
+	bool process(const Event& e)
+	{
+		const auto t = current->on_event(e);
+
+		if (t.stays())
+			return false;
+
+		for (size_t i = 0; i < state_count; ++i)
+		{
+			if (ids[i] == t.target)
+			{
+				enters[i](current, e);
+				current_index = i;
+				return true;
+			}
+		}
+
+		return false; // unhandled: not one of States
+	}
+
+	/*
+	    Destroys the current state and constructs a U from args in its
+	    place.
+
+	    Must not be called from within an event handler.
+	*/
+	template <class U, class... Args>
+	U& transition(Args&&... args) noexcept
+	{
+		static_assert(index_of<U>() < state_count, "U must be one of States.");
+
+		auto& next = current.template emplace<U>(std::forward<Args>(args)...);
+		current_index = index_of<U>();
+		return next;
+	}
+
+	/* observers */
+
+	// Returns the current state.
+	State& state() noexcept
+	{
+		return *current;
+	}
+
+	// Returns the current state.
+	const State& state() const noexcept
+	{
+		return *current;
+	}
+
+	// Returns true if the current state is exactly of type U.
+	template <class U>
+	bool in() const noexcept
+	{
+		return current_index == index_of<U>();
+	}
+
+	// Returns the position of the current state's type in States.
+	size_t index() const noexcept
+	{
+		return current_index;
+	}
+
+	// Returns the position of U in States, or state_count if not found.
+	template <class U>
+	static constexpr size_t index_of() noexcept
+	{
+		constexpr bool matches[] = {std::is_same<U, States>::value...};
+
+		for (size_t i = 0; i < state_count; ++i)
+		{
+			if (matches[i])
+				return i;
+		}
+		return state_count;
+	}
+
+private:
+	using enter_function = void (*)(value_type&, const Event&);
+
+	// How the engine constructs U: from the event, by default, or not at all.
+	template <class U>
+	using entry = std::integral_constant<
+	    int,
+	    std::is_constructible<U, const Event&>::value
+	        ? 2
+	        : std::is_default_constructible<U>::value ? 1 : 0>;
+
+	// Constructs U in place of the current state.
+	template <class U>
+	static void enter(value_type& current, const Event& e) noexcept
+	{
+		enter<U>(current, e, entry<U>());
+	}
+
+	template <class U>
+	static void enter(value_type& current,
+	                  const Event& e,
+	                  std::integral_constant<int, 2>)
+	{
+		current.template emplace<U>(e);
+	}
+
+	template <class U>
+	static void enter(value_type& current,
+	                  const Event&,
+	                  std::integral_constant<int, 1>)
+	{
+		current.template emplace<U>();
+	}
+
+	template <class U>
+	static void enter(value_type&, const Event&, std::integral_constant<int, 0>)
+	{
+		assert(false && "U can only be entered with transition()");
+		std::terminate();
+	}
+
+	static constexpr const void* ids[] = {
+	    &local_state_machine_internal::state_id<States>::id...};
+	static constexpr enter_function enters[] = {&enter<States>...};
+
+	value_type current;
+	size_t current_index;
+};
+
+template <class State, class Event, class... States>
+constexpr size_t local_state_machine<State, Event, States...>::state_count;
+
+template <class State, class Event, class... States>
+constexpr size_t local_state_machine<State, Event, States...>::state_size;
+
+template <class State, class Event, class... States>
+constexpr size_t local_state_machine<State, Event, States...>::state_alignment;
+
+template <class State, class Event, class... States>
+constexpr const void* local_state_machine<State, Event, States...>::ids[];
+
+template <class State, class Event, class... States>
+constexpr typename local_state_machine<State, Event, States...>::enter_function
+    local_state_machine<State, Event, States...>::enters[];
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+
+// The 32-bit indices of a node's children, in order.
+class node_children
+{
+public:
+	using index_type = uint32_t;
+
+	node_children(const index_type* first, const index_type* last) noexcept
+	  : first(first), last(last)
+	{
+	}
+
+	const index_type* begin() const noexcept
+	{
+		return first;
+	}
+
+	const index_type* end() const noexcept
+	{
+		return last;
+	}
+
+	size_t size() const noexcept
+	{
+		return static_cast<size_t>(last - first);
+	}
+
+	index_type operator[](size_t i) const noexcept
+	{
+		return first[i];
+	}
+
+private:
+	const index_type* first;
+	const index_type* last;
+};
+
+// The values of a node's children, in order, during evaluate().
+template <class T>
+class child_values
+{
+public:
+	child_values(const T* values, node_children children) noexcept
+	  : values(values), children(children)
+	{
+	}
+
+	size_t size() const noexcept
+	{
+		return children.size();
+	}
+
+	const T& operator[](size_t i) const noexcept
+	{
+		return values[children[i]];
+	}
+
+private:
+	const T* values;
+	node_children children;
+};
+
+/*
+     An arena of tree nodes, stored in-place in one contiguous array.
+
+     Each node is a local_derived<Node, node_size>, and links to its
+    children by 32-bit index. A node can only be added after its children,
+    so building a tree bottom-up lays it out in evaluation (post-)order:
+    evaluate() computes every node in one forward pass over the array,
+    and a recursive walk moves mostly forward through memory. Children
+    may be shared, so the nodes form a DAG.
+
+        node_arena<expr, 32> a;
+        auto x = a.add<variable>({}, 0);
+        auto one = a.add<constant>({}, 1.0);
+        auto sum = a.add<plus>({x, one});
+
+        auto values = std::vector<double>();
+        a.evaluate(values, [&](const expr& e, child_values<double> c) {
+            return e.eval(c);
+        });
+
+     Params:
+      - Node       the base class of nodes
+      - node_size  maximum allowed node size, see local_derived
+      - alignment  minimum node alignment
+
+     Requirements are the same as for local_derived.
+*/
+template <class Node,
+          size_t node_size,
+          size_t alignment = alignof(std::max_align_t)>
+class node_arena
+{
+public:
+	using value_type = local_derived<Node, node_size, alignment>;
+	using index_type = node_children::index_type;
+
+	static constexpr index_type none = std::numeric_limits<index_type>::max();
+
+	node_arena()
+	{
+		first_child.push_back(0);
+	}
+
+	/* modifiers */
+
+	/*
+	    Appends a U, constructed from args, with the given children.
+	    Returns its index.
+
+	    Throws std::out_of_range if one of children is not in the arena
+	    yet, and std::length_error past 2^32 - 1 nodes or child links. If
+	    it throws, or the constructor of U does, the arena is unchanged.
+	*/
+	template <class U, class... Args>
+	index_type add(std::initializer_list<index_type> children, Args&&... args)
+	{
+		return add<U>(children.begin(), children.end(),
+		              std::forward<Args>(args)...);
+	}
+
+	// Same as above, for the children in [first, last).
+	template <class U, class... Args>
+	index_type add(const index_type* first,
+	               const index_type* last,
+	               Args&&... args)
+	{
+		if (nodes.size() >= none)
+			throw std::length_error("node_arena: too many nodes");
+		if (static_cast<size_t>(last - first) >= none - links.size())
+			throw std::length_error("node_arena: too many child links");
+
+		const auto index = static_cast<index_type>(nodes.size());
+		for (auto c = first; c != last; ++c)
+		{
+			if (*c >= index)
+				throw std::out_of_range(
+				    "node_arena: children must be added first");
+		}
+
+		const auto linked = links.size();
+		try
+		{
+			links.insert(links.end(), first, last);
+			first_child.push_back(static_cast<index_type>(links.size()));
+			nodes.emplace_back(emplace_tag_t<U>(), std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			links.resize(linked);
+			first_child.resize(nodes.size() + 1);
+			throw;
+		}
+		return index;
+	}
+
+	// Removes all nodes, keeps the storage.
+	void clear()
+	{
+		nodes.clear();
+		links.clear();
+		first_child.resize(1);
+	}
+
+	// Reserves storage for n nodes with child_links children in total.
+	void reserve(size_t n, size_t child_links)
+	{
+		nodes.reserve(n);
+		first_child.reserve(n + 1);
+		links.reserve(child_links);
+	}
+
+	/* element access */
+
+	Node& operator[](index_type i) noexcept
+	{
+		return *nodes[i];
+	}
+
+	const Node& operator[](index_type i) const noexcept
+	{
+		return *nodes[i];
+	}
+
+	// Returns the stored node.
+	value_type& slot(index_type i) noexcept
+	{
+		return nodes[i];
+	}
+
+	const value_type& slot(index_type i) const noexcept
+	{
+		return nodes[i];
+	}
+
+	node_children children(index_type i) const noexcept
+	{
+		return node_children(links.data() + first_child[i],
+		                     links.data() + first_child[i + 1]);
+	}
+
+	// The last node added, which is the root of a tree built bottom-up.
+	index_type root() const noexcept
+	{
+		return nodes.empty() ? none : static_cast<index_type>(nodes.size() - 1);
+	}
+
+	/*
+	    Computes the value of every node in index order, so each one after
+	    its children. values[i] = f(node i, child_values<T>).
+	*/
+	template <class T, class F>
+	void evaluate(std::vector<T>& values, F&& f) const
+	{
+		values.resize(nodes.size());
+
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			const auto c = children(static_cast<index_type>(i));
+			values[i] = f(*nodes[i], child_values<T>(values.data(), c));
+		}
+	}
+
+	/* observers */
+
+	size_t size() const noexcept
+	{
+		return nodes.size();
+	}
+
+	bool empty() const noexcept
+	{
+		return nodes.empty();
+	}
+
+	// Total number of child links.
+	size_t link_count() const noexcept
+	{
+		return links.size();
+	}
+
+private:
+	std::vector<value_type> nodes;         // in-place nodes, in index order
+	std::vector<index_type> first_child;   // per node, then one past the end
+	std::vector<index_type> links;         // children of all nodes, in order
+};
+
+template <class Node, size_t node_size, size_t alignment>
+constexpr typename node_arena<Node, node_size, alignment>::index_type
+    node_arena<Node, node_size, alignment>::none;
@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_algorithm.h"
+
+// Parallel algorithms over ranges of local_derived objects.
+
+/*
+     A fixed set of threads, running one job at a time.
+
+     run(tasks, f) calls f(i) once for each i in [0, tasks), spread over
+    the workers and the calling thread, and returns when all calls have
+    returned. Tasks are taken in index order from a shared counter, so
+    faster threads take more of them.
+
+     The pool is size() threads in total, including the caller of run();
+    a pool of size 1 runs everything on the caller.
+*/
+class thread_pool
+{
+public:
+	// Starts threads - 1 workers. By default, one thread per core.
+	explicit thread_pool(size_t threads = default_threads())
+	{
+		for (size_t w = 1; w < threads; ++w)
+			workers.emplace_back([this] { work(); });
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// Joins the workers.
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& t : workers)
+			t.join();
+	}
+
+	// Number of threads that run tasks, including the caller of run().
+	size_t size() const noexcept
+	{
+		return workers.size() + 1;
+	}
+
+	static size_t default_threads() noexcept
+	{
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	/*
+	    Calls f(i) for each i in [0, tasks) and waits for all of them.
+	    Calls from several threads are serialized.
+
+	    Requirements:
+	     - f must not throw
+	     - f must not call run() on this pool
+	*/
+	template <class F>
+	void run(size_t tasks, F&& f)
+	{
+		using function = std::remove_reference_t<F>;
+
+		std::lock_guard<std::mutex> serial(run_mutex);
+
+		if (workers.empty() || tasks < 2)
+		{
+			for (size_t i = 0; i < tasks; ++i)
+				f(i);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job.invoke = [](void* context, size_t i) {
+				(*static_cast<function*>(context))(i);
+			};
+			job.context = &f;
+			job.tasks = tasks;
+			next.store(0, std::memory_order_relaxed);
+			joined = 0;
+			++generation;
+		}
+		wake.notify_all();
+
+		execute();
+
+		// every worker checks in, so none can still be looking at this job
+		// once run() returns
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this] {
+			return joined == workers.size() && active == 0;
+		});
+	}
+
+private:
+	struct job_t
+	{
+		void (*invoke)(void*, size_t) = nullptr;
+		void* context = nullptr;
+		size_t tasks = 0;
+	};
+
+	void execute() noexcept
+	{
+		for (;;)
+		{
+			const auto i = next.fetch_add(1, std::memory_order_relaxed);
+			if (i >= job.tasks)
+				return;
+			job.invoke(job.context, i);
+		}
+	}
+
+	void work()
+	{
+		auto seen = size_t(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+
+			seen = generation;
+			++joined;
+			++active;
+
+			lock.unlock();
+			execute();
+			lock.lock();
+
+			--active;
+			if (joined == workers.size() && active == 0)
+				finished.notify_one();
+		}
+	}
+
+	std::mutex run_mutex; // held by run() for the whole job
+
+	std::mutex mutex; // guards the members below, and job while it's set
+	std::condition_variable wake;
+	std::condition_variable finished;
+	job_t job;
+	size_t generation = 0;
+	size_t joined = 0; // workers that took the current job
+	size_t active = 0; // workers still running it
+	bool stopping = false;
+
+	std::atomic<size_t> next{0}; // next task index
+
+	std::vector<std::thread> workers;
+};
+
+namespace local_derived_internal
+{
+// Size of a cache line, assumed for chunking.
+const size_t cache_line = 64;
+
+// Target size of a chunk of work, in bytes.
+const size_t chunk_bytes = 16 * 1024;
+
+constexpr size_t gcd(size_t a, size_t b) noexcept
+{
+	return b == 0 ? a : gcd(b, a % b);
+}
+
+template <class It>
+void require_random_access()
+{
+	static_assert(
+	    std::is_same<typename std::iterator_traits<It>::iterator_category,
+	                 std::random_access_iterator_tag>::value,
+	    "parallel algorithms require random access iterators.");
+}
+}
+
+/*
+     Number of elements of type W in a chunk of parallel work: about
+    16 KB, and a multiple of the elements that span a whole number of
+    cache lines. A chunk of a cache line aligned array then starts and
+    ends on line boundaries, so threads writing to neighbouring chunks
+    never share a line.
+
+     Depends only on W, so the partition of a range, and the result of a
+    reduction over it, doesn't change with the number of threads.
+*/
+template <class W>
+constexpr size_t parallel_chunk_size() noexcept
+{
+	using namespace local_derived_internal;
+
+	// elements in the least common multiple of sizeof(W) and a line
+	const auto step = cache_line / gcd(sizeof(W), cache_line);
+	const auto steps = chunk_bytes / (sizeof(W) * step);
+	return (steps ? steps : 1) * step;
+}
+
+namespace local_derived_internal
+{
+// Calls f(chunk_first, chunk_last, chunk) for each chunk, on the pool.
+template <class It, class F>
+void for_each_chunk(thread_pool& pool, It first, It last, F&& f)
+{
+	using W = typename std::iterator_traits<It>::value_type;
+
+	const auto n = static_cast<size_t>(last - first);
+	const auto step = parallel_chunk_size<W>();
+	const auto chunks = (n + step - 1) / step;
+
+	pool.run(chunks, [&](size_t c) {
+		const auto begin = c * step;
+		const auto end = std::min(begin + step, n);
+		f(first + begin, first + end, c);
+	});
+}
+}
+
+namespace parallel
+{
+/*
+     Calls f(W&) for each element, in parallel. The order of the calls
+    is unspecified; f must be safe to call concurrently on different
+    elements.
+*/
+template <class It, class F>
+void for_each(thread_pool& pool, It first, It last, F f)
+{
+	local_derived_internal::require_random_access<It>();
+
+	local_derived_internal::for_each_chunk(
+	    pool, first, last, [&](It b, It e, size_t) {
+		    for (; b != e; ++b)
+			    f(*b);
+	    });
+}
+
+/*
+     Reduces transform(x) of the elements with reduce, starting from
+    init, in parallel.
+
+     Each chunk is reduced in order, starting from its first element,
+    then the chunk results are reduced in order into init. The chunks
+    depend only on the element type, so the grouping of reduce, and the
+    result, are the same for any number of threads, even for a
+    non-associative reduce such as floating-point addition.
+
+     Requirements:
+     - T must be copy constructible
+     - reduce(T, T) and transform(const W&) must return a T
+*/
+template <class It, class T, class Reduce, class Transform>
+T transform_reduce(thread_pool& pool,
+                   It first,
+                   It last,
+                   T init,
+                   Reduce reduce,
+                   Transform transform)
+{
+	local_derived_internal::require_random_access<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+
+	const auto n = static_cast<size_t>(last - first);
+	const auto step = parallel_chunk_size<W>();
+	const auto chunks = (n + step - 1) / step;
+
+	// one result per chunk, each written once, so sharing lines is cheap
+	auto partials = std::vector<T>(chunks, init);
+
+	local_derived_internal::for_each_chunk(
+	    pool, first, last, [&](It b, It e, size_t c) {
+		    auto acc = static_cast<T>(transform(*b));
+		    for (++b; b != e; ++b)
+			    acc = reduce(std::move(acc), transform(*b));
+		    partials[c] = std::move(acc);
+	    });
+
+	for (auto& p : partials)
+		init = reduce(std::move(init), std::move(p));
+	return init;
+}
+
+// Returns the number of elements for which pred(const W&) is true.
+template <class It, class Pred>
+size_t count_if(thread_pool& pool, It first, It last, Pred pred)
+{
+	using W = typename std::iterator_traits<It>::value_type;
+
+	return parallel::transform_reduce(
+	    pool, first, last, size_t(0),
+	    [](size_t a, size_t b) { return a + b; },
+	    [&](const W& x) { return pred(x) ? size_t(1) : size_t(0); });
+}
+
+/*
+     Calls for_each_batched<Us...>(chunk_first, chunk_last, fallback,
+    args...) for each chunk, in parallel. Runs are split at chunk
+    boundaries. args are shared by all threads.
+*/
+template <class... Us, class It, class F, class... Args>
+void for_each_batched(
+    thread_pool& pool, It first, It last, F&& fallback, Args&&... args)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	local_derived_internal::for_each_chunk(
+	    pool, first, last, [&](It b, It e, size_t) {
+		    ::for_each_batched<Us...>(b, e, fallback, args...);
+	    });
+}
+
+/*
+     Optional pre-pass: reorders the range so objects of each of Us form
+    one run, in the order of Us, followed by objects of other types.
+    Relative order is kept within each group. After it, almost every
+    chunk holds one type, so virtual calls in it are predicted, and
+    for_each_batched finds one run per chunk.
+
+     Sequential. A counting sort: each object is relocated once into a
+    buffer at its group's position and once back, in runs. Returns at
+    once if the range is already grouped. The range must be contiguous,
+    see is_contiguous_iterator.
+*/
+template <class... Us, class It>
+void group_by_type(It first, It last)
+{
+	local_derived_internal::require_contiguous<It>();
+
+	using W = typename std::iterator_traits<It>::value_type;
+
+	if (first == last)
+		return;
+
+	const auto n = static_cast<size_t>(last - first);
+	auto* base = std::addressof(*first);
+
+	// the index in Us of the type held, sizeof...(Us) for others
+	auto keys = std::vector<size_t>(n);
+	size_t offsets[sizeof...(Us) + 1] = {};
+	auto sorted = true;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const bool held[] = {base[i].template holds<Us>()..., true};
+		keys[i] = static_cast<size_t>(
+		    std::find(held, held + sizeof...(Us), true) - held);
+
+		++offsets[keys[i]];
+		sorted = sorted && (i == 0 || keys[i - 1] <= keys[i]);
+	}
+
+	if (sorted)
+		return;
+
+	// counts to starting positions
+	auto start = size_t(0);
+	for (auto& o : offsets)
+	{
+		const auto count = o;
+		o = start;
+		start += count;
+	}
+
+	auto buffer = local_derived_internal::make_relocation_buffer<W>(n);
+	auto* out = reinterpret_cast<W*>(buffer.data());
+
+	for (size_t i = 0; i < n; ++i)
+		base[i].relocate_to(out + offsets[keys[i]]++);
+
+	relocating::uninitialized_relocate_n(out, n, base);
+}
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+/*
+     Defers the destruction of local_derived objects.
+
+     retire(std::move(d)) relocates d into a retirement batch and returns,
+    without running the destructor of the stored object. Full batches are
+    handed to drain(), which destroys their objects and recycles them, so
+    in steady state retire() doesn't allocate, and takes a lock only once
+    per batch. drain() runs either on a background thread, see start(),
+    or explicitly at a quiet point.
+
+     Each latency-critical thread should own a queue: retire(), flush()
+    and pending() must be called from one thread at a time. drain() may
+    run on another thread concurrently, but only on one at a time.
+
+        retirement_queue<session, 64> q;
+        q.start();                  // or call q.drain() when idle
+        q.retire(std::move(old));   // returns immediately
+
+     Params:
+      - Base        the base class of retired objects
+      - size        maximum allowed object size, see local_derived
+      - alignment   minimum object alignment
+
+     Requirements are the same as for local_derived.
+*/
+template <class Base, size_t size, size_t alignment = alignof(std::max_align_t)>
+class retirement_queue
+{
+public:
+	using value_type = local_derived<Base, size, alignment>;
+
+	// Objects per batch.
+	explicit retirement_queue(size_t batch_size = 256)
+	  : batch_size(batch_size ? batch_size : 1)
+	{
+	}
+
+	retirement_queue(const retirement_queue&) = delete;
+	retirement_queue& operator=(const retirement_queue&) = delete;
+
+	// Stops the background thread and destroys all retired objects.
+	~retirement_queue()
+	{
+		stop();
+		flush();
+		drain();
+	}
+
+	/* producer */
+
+	/*
+	    Moves d into the current batch, leaving it moved-from. The stored
+	    object is destroyed later, by drain().
+	*/
+	void retire(value_type&& d)
+	{
+		if (!current)
+			current = take_free_batch();
+
+		new (current->at(current->count)) value_type(std::move(d));
+		++current->count;
+
+		if (current->count == batch_size)
+			publish();
+	}
+
+	// Hands the current batch to drain(), even if it's not full.
+	void flush()
+	{
+		if (current && current->count > 0)
+			publish();
+	}
+
+	/* consumer */
+
+	/*
+	    Destroys the objects in all batches handed over so far. Returns
+	    the number of objects destroyed.
+	*/
+	size_t drain()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			taken.swap(full);
+		}
+
+		auto destroyed = size_t(0);
+		for (auto& b : taken)
+		{
+			for (size_t i = 0; i < b->count; ++i)
+				b->at(i)->~value_type();
+
+			destroyed += b->count;
+			b->count = 0;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& b : taken)
+				spare.push_back(std::move(b));
+		}
+		taken.clear();
+
+		retired.fetch_sub(destroyed, std::memory_order_relaxed);
+		return destroyed;
+	}
+
+	// Starts a background thread that drains each batch as it's handed over.
+	void start()
+	{
+		if (drainer.joinable())
+			return;
+
+		stopping = false;
+		drainer = std::thread([this] {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping)
+			{
+				wake.wait(lock, [this] { return stopping || !full.empty(); });
+
+				lock.unlock();
+				drain();
+				lock.lock();
+			}
+		});
+	}
+
+	// Stops and joins the background thread; undrained batches stay queued.
+	void stop()
+	{
+		if (!drainer.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		drainer.join();
+	}
+
+	/* observers */
+
+	// Number of objects retired and not yet destroyed.
+	size_t pending() const noexcept
+	{
+		return retired.load(std::memory_order_relaxed) +
+		       (current ? current->count : 0);
+	}
+
+private:
+	// A fixed array of slots for retired objects.
+	struct batch
+	{
+		explicit batch(size_t n)
+		  : slots(n * sizeof(value_type), alignof(value_type))
+		{
+		}
+
+		value_type* at(size_t i) noexcept
+		{
+			return reinterpret_cast<value_type*>(slots.data()) + i;
+		}
+
+		local_derived_internal::aligned_buffer slots;
+		size_t count = 0;
+	};
+
+	std::unique_ptr<batch> take_free_batch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!spare.empty())
+			{
+				auto b = std::move(spare.back());
+				spare.pop_back();
+				return b;
+			}
+		}
+		return std::make_unique<batch>(batch_size);
+	}
+
+	void publish()
+	{
+		retired.fetch_add(current->count, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			full.push_back(std::move(current));
+		}
+		wake.notify_one();
+	}
+
+	const size_t batch_size;
+
+	std::unique_ptr<batch> current;  // being filled by retire()
+	std::atomic<size_t> retired{0};  // in full batches
+
+	// being destroyed by drain(); swapped with full to keep both buffers
+	std::vector<std::unique_ptr<batch>> taken;
+
+	std::mutex mutex; // guards the members below
+	std::vector<std::unique_ptr<batch>> full;  // waiting for drain()
+	std::vector<std::unique_ptr<batch>> spare; // drained, for reuse
+	std::condition_variable wake;
+	bool stopping = false;
+
+	std::thread drainer;
+};
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+#include "local_derived_simd.h"
+
+/*
+     A vector of polymorphic objects in a hot/cold split layout.
+
+     Like std::vector<local_derived<Base, slot_size, alignment>>, but the type
+    identity (move wrapper) and the Base pointer of each element live in
+    a dense key array, and the objects in a parallel array of slots. Type
+    scans and counts then read 16 bytes per element instead of a whole
+    local_derived.
+
+     Each element also has a one byte type tag, numbering the types in
+    order of first insertion. count_type, find_all and partition_by_type
+    scan the tags with SSE2/AVX2, chosen at runtime.
+
+     Requirements are the same as for local_derived, plus:
+     - at most 256 distinct types per container; emplace_back throws
+       std::length_error for the 257th
+*/
+template <class Base,
+          size_t slot_size,
+          size_t alignment = alignof(std::max_align_t)>
+class split_local_vector
+{
+public:
+	static_assert(std::has_virtual_destructor<Base>::value ||
+	                  allow_nonvirtual_destructor<Base>::value,
+	              "Base must have a virtual destructor.");
+
+	using MovePtr = void (*)(void*, void*);
+	using DestroyPtr = void (*)(void*);
+
+	// Hot part of an element.
+	struct key
+	{
+		MovePtr move; // identifies the type
+		Base* base;   // the Base subobject, within the slot
+	};
+
+	split_local_vector()
+	{
+	}
+
+	split_local_vector(split_local_vector&& other) noexcept
+	  : keys(std::move(other.keys)),
+	    tags(std::move(other.tags)),
+	    types(std::move(other.types)),
+	    slots(std::move(other.slots)),
+	    capacity_(other.capacity_)
+	{
+		other.keys.clear();
+		other.tags.clear();
+		other.capacity_ = 0;
+	}
+
+	split_local_vector(const split_local_vector&) = delete;
+	split_local_vector& operator=(const split_local_vector&) = delete;
+	split_local_vector& operator=(split_local_vector&&) = delete;
+
+	~split_local_vector()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Constructs a U at the end.
+	template <class U, class... Args>
+	U& emplace_back(Args&&... args)
+	{
+		static_assert(std::is_base_of<Base, U>::value,
+		              "U must be derived from Base.");
+		static_assert(sizeof(U) <= slot_size, "size of U must not be larger");
+		static_assert(alignof(U) <= alignment,
+		              "aligment requirement of U must not be stricter");
+
+		if (keys.size() == capacity_)
+			reserve(std::max<size_t>(capacity_ * 2, 8));
+
+		const auto move = &local_derived_internal::move_wrapper<U>::move;
+		const auto tag = tag_for<U>();
+
+		auto* u = new (slot_at(keys.size())) U(std::forward<Args>(args)...);
+		keys.push_back(key{move, static_cast<Base*>(u)});
+		tags.push_back(tag);
+		return *u;
+	}
+
+	// Destroys the last object.
+	void pop_back()
+	{
+		destroy(keys.size() - 1);
+		keys.pop_back();
+		tags.pop_back();
+	}
+
+	/*
+	    Removes the i-th object, moving the last one into its place.
+	    Doesn't preserve the order.
+	*/
+	void swap_remove(size_t i)
+	{
+		destroy(i);
+
+		if (i + 1 != keys.size())
+		{
+			auto& k = keys[i];
+			const auto& last = keys.back();
+			last.move(slot_at(keys.size() - 1), slot_at(i));
+			k.move = last.move;
+			k.base = rebase(last.base, slot_at(keys.size() - 1), slot_at(i));
+			destroy(keys.size() - 1);
+			tags[i] = tags.back();
+		}
+
+		keys.pop_back();
+		tags.pop_back();
+	}
+
+	// Destroys all objects, keeps the capacity.
+	void clear()
+	{
+		for (size_t i = 0; i < keys.size(); ++i)
+			destroy(i);
+		keys.clear();
+		tags.clear();
+	}
+
+	void reserve(size_t n)
+	{
+		if (n <= capacity_)
+			return;
+
+		auto new_slots = local_derived_internal::aligned_buffer(
+		    n * sizeof(slot_type), alignment);
+		auto* to = reinterpret_cast<slot_type*>(new_slots.data());
+
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			auto& k = keys[i];
+			k.move(slot_at(i), &to[i]);
+			destroy(i);
+			k.base = rebase(k.base, slot_at(i), &to[i]);
+		}
+
+		slots = std::move(new_slots);
+		keys.reserve(n);
+		tags.reserve(n);
+		capacity_ = n;
+	}
+
+	/*
+	    Reorders the objects so that each type forms one run, in tag order,
+	    keeping the relative order within a type. Relocates all objects.
+
+	    Returns the run bounds: objects with tag t are in
+	    [bounds[t], bounds[t + 1]).
+	*/
+	std::vector<size_t> partition_by_type()
+	{
+		const auto n = keys.size();
+
+		auto bounds = std::vector<size_t>(types.size() + 1, 0);
+		for (size_t t = 0; t < types.size(); ++t)
+		{
+			bounds[t + 1] = bounds[t] + local_derived_internal::count_tags(
+			                                tags.data(), n,
+			                                static_cast<uint8_t>(t));
+		}
+
+		auto new_slots = local_derived_internal::aligned_buffer(
+		    capacity_ * sizeof(slot_type), alignment);
+		auto* to = reinterpret_cast<slot_type*>(new_slots.data());
+
+		auto new_keys = std::vector<key>(n);
+		auto next = std::vector<size_t>(bounds.begin(), bounds.end() - 1);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			const auto& k = keys[i];
+			const auto j = next[tags[i]]++;
+
+			k.move(slot_at(i), &to[j]);
+			new_keys[j] = key{k.move, rebase(k.base, slot_at(i), &to[j])};
+			destroy(i);
+		}
+
+		for (size_t t = 0; t < types.size(); ++t)
+		{
+			std::fill(tags.begin() + static_cast<std::ptrdiff_t>(bounds[t]),
+			          tags.begin() + static_cast<std::ptrdiff_t>(bounds[t + 1]),
+			          static_cast<uint8_t>(t));
+		}
+
+		new_keys.reserve(capacity_);
+		keys = std::move(new_keys);
+		slots = std::move(new_slots);
+
+		return bounds;
+	}
+
+	/* observers */
+
+	Base* get(size_t i) const noexcept
+	{
+		return keys[i].base;
+	}
+
+	Base& operator[](size_t i) const noexcept
+	{
+		return *keys[i].base;
+	}
+
+	// Returns true if the i-th object is exactly of type U.
+	template <class U>
+	bool holds(size_t i) const noexcept
+	{
+		return keys[i].move == &local_derived_internal::move_wrapper<U>::move;
+	}
+
+	// Returns the i-th object if it's exactly of type U, or nullptr.
+	template <class U>
+	U* get_if(size_t i) const noexcept
+	{
+		return holds<U>(i) ? static_cast<U*>(keys[i].base) : nullptr;
+	}
+
+	// Number of objects of exactly type U; scans the tags only.
+	template <class U>
+	size_t count_type() const noexcept
+	{
+		const auto tag = type_tag<U>();
+		if (tag < 0)
+			return 0;
+
+		return local_derived_internal::count_tags(tags.data(), tags.size(),
+		                                          static_cast<uint8_t>(tag));
+	}
+
+	// Appends the indices of objects of exactly type U to out.
+	template <class U>
+	void find_all(std::vector<size_t>& out) const
+	{
+		const auto tag = type_tag<U>();
+		if (tag < 0)
+			return;
+
+		local_derived_internal::find_tags(tags.data(), tags.size(),
+		                                  static_cast<uint8_t>(tag), out);
+	}
+
+	// Returns the tag of type U, or -1 if it was never inserted.
+	template <class U>
+	int type_tag() const noexcept
+	{
+		const auto move = &local_derived_internal::move_wrapper<U>::move;
+
+		for (size_t t = 0; t < types.size(); ++t)
+		{
+			if (types[t].move == move)
+				return static_cast<int>(t);
+		}
+		return -1;
+	}
+
+	// The dense key array.
+	const std::vector<key>& hot() const noexcept
+	{
+		return keys;
+	}
+
+	// The type tag of each element.
+	const std::vector<uint8_t>& type_tags() const noexcept
+	{
+		return tags;
+	}
+
+	size_t size() const noexcept
+	{
+		return keys.size();
+	}
+
+	bool empty() const noexcept
+	{
+		return keys.empty();
+	}
+
+	size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+private:
+	using slot_type = std::aligned_storage_t<slot_size, alignment>;
+
+	slot_type* slot_at(size_t i) const noexcept
+	{
+		return reinterpret_cast<slot_type*>(slots.data()) + i;
+	}
+
+	// Per type operations, indexed by tag.
+	struct type_ops
+	{
+		MovePtr move;
+		DestroyPtr destroy; // nullptr if trivially destructible
+	};
+
+	// Returns the tag of U, assigning the next one if it's new.
+	template <class U>
+	uint8_t tag_for()
+	{
+		const auto tag = type_tag<U>();
+		if (tag >= 0)
+			return static_cast<uint8_t>(tag);
+
+		// a 257th type would wrap to tag 0 and be moved and destroyed as
+		// the first type
+		if (types.size() == 256)
+			throw std::length_error("split_local_vector: more than 256 types");
+
+		types.push_back(
+		    type_ops{&local_derived_internal::move_wrapper<U>::move,
+		             local_derived_internal::destroy_wrapper<U>::get()});
+		return static_cast<uint8_t>(types.size() - 1);
+	}
+
+	// Destroys the i-th object through its type, if it needs destroying.
+	void destroy(size_t i) const
+	{
+		if (const auto d = types[tags[i]].destroy)
+			d(slot_at(i));
+	}
+
+	// Moves a Base pointer from one slot to another.
+	static Base* rebase(Base* base, const void* from, const void* to) noexcept
+	{
+		return reinterpret_cast<Base*>(reinterpret_cast<uintptr_t>(to) +
+		                               (reinterpret_cast<uintptr_t>(base) -
+		                                reinterpret_cast<uintptr_t>(from)));
+	}
+
+	std::vector<key> keys;
+	std::vector<uint8_t> tags;    // type tag of each element
+	std::vector<type_ops> types;  // type of each tag
+	local_derived_internal::aligned_buffer slots;
+	size_t capacity_ = 0;
+};
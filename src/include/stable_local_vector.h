@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace local_derived_internal
+{
+// Index of the lowest set bit of x; x must not be 0.
+inline unsigned ctz64(uint64_t x) noexcept
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return static_cast<unsigned>(i);
+#else
+	auto i = 0u;
+	for (; !(x & 1); x >>= 1)
+		++i;
+	return i;
+#endif
+}
+}
+
+/*
+     A container of local_derived with stable addresses.
+
+     Elements live in fixed-size, cache line aligned chunks of 64 slots,
+    which are never relocated: pointers and iterators stay valid until the
+    element is erased. Erasing leaves a hole, reused by a later emplace.
+    Each chunk has a 64-bit occupancy bitmap; iteration skips holes (and
+    empty chunks) by scanning the bitmaps.
+
+     The order of iteration is the order of slots, not of insertion.
+
+     Requirements are the same as for local_derived.
+*/
+template <class Base,
+          size_t slot_size,
+          size_t alignment = alignof(std::max_align_t)>
+class stable_local_vector
+{
+public:
+	using value_type = local_derived<Base, slot_size, alignment>;
+
+	// Slots per chunk, one occupancy bit each.
+	static constexpr size_t chunk_slots = 64;
+
+	// Chunks start on a cache line boundary.
+	static constexpr size_t chunk_alignment =
+	    alignof(value_type) > 64 ? alignof(value_type) : 64;
+
+	template <bool Const>
+	class basic_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = stable_local_vector::value_type;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::conditional_t<Const, const value_type&, value_type&>;
+		using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+		basic_iterator() noexcept
+		{
+		}
+
+		// iterator to const_iterator
+		template <bool C = Const, class = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false>& other) noexcept
+		  : owner(other.owner), chunk(other.chunk), slot(other.slot)
+		{
+		}
+
+		reference operator*() const noexcept
+		{
+			return *owner->at(chunk, slot);
+		}
+
+		pointer operator->() const noexcept
+		{
+			return owner->at(chunk, slot);
+		}
+
+		basic_iterator& operator++() noexcept
+		{
+			const auto next = owner->next_occupied(chunk, slot + 1);
+			chunk = next.first;
+			slot = next.second;
+			return *this;
+		}
+
+		basic_iterator operator++(int) noexcept
+		{
+			auto old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator==(const basic_iterator& other) const noexcept
+		{
+			return chunk == other.chunk && slot == other.slot;
+		}
+
+		bool operator!=(const basic_iterator& other) const noexcept
+		{
+			return !(*this == other);
+		}
+
+	private:
+		friend class stable_local_vector;
+
+		template <bool>
+		friend class basic_iterator;
+
+		using owner_type = std::conditional_t<Const,
+		                                      const stable_local_vector,
+		                                      stable_local_vector>;
+
+		basic_iterator(owner_type* owner, size_t chunk, size_t slot) noexcept
+		  : owner(owner), chunk(chunk), slot(slot)
+		{
+		}
+
+		owner_type* owner = nullptr;
+		size_t chunk = 0;
+		size_t slot = 0;
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	stable_local_vector()
+	{
+	}
+
+	stable_local_vector(stable_local_vector&& other) noexcept
+	  : chunks(std::move(other.chunks)),
+	    occupancy(std::move(other.occupancy)),
+	    with_space(std::move(other.with_space)),
+	    count(other.count)
+	{
+		other.chunks.clear();
+		other.occupancy.clear();
+		other.with_space.clear();
+		other.count = 0;
+	}
+
+	stable_local_vector(const stable_local_vector&) = delete;
+	stable_local_vector& operator=(const stable_local_vector&) = delete;
+	stable_local_vector& operator=(stable_local_vector&&) = delete;
+
+	~stable_local_vector()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	// Constructs a U in a free slot, reusing holes first.
+	template <class U, class... Args>
+	iterator emplace(Args&&... args)
+	{
+		if (with_space.empty())
+			add_chunk();
+
+		const auto c = with_space.back();
+		auto& bits = occupancy[c];
+		const auto s = local_derived_internal::ctz64(~bits);
+
+		new (at(c, s)) value_type(emplace_tag_t<U>(), std::forward<Args>(args)...);
+
+		bits |= uint64_t(1) << s;
+		if (bits == ~uint64_t(0))
+			with_space.pop_back();
+
+		++count;
+		return iterator(this, c, s);
+	}
+
+	// Destroys the element at pos, leaving a hole. Returns the next element.
+	iterator erase(const_iterator pos)
+	{
+		const auto c = pos.chunk;
+		const auto s = pos.slot;
+		auto& bits = occupancy[c];
+
+		at(c, s)->~value_type();
+
+		if (bits == ~uint64_t(0))
+			with_space.push_back(c);
+
+		bits &= ~(uint64_t(1) << s);
+		--count;
+
+		const auto next = next_occupied(c, s + 1);
+		return iterator(this, next.first, next.second);
+	}
+
+	// Destroys all elements, keeps the chunks.
+	void clear()
+	{
+		for (auto it = begin(); it != end();)
+			it = erase(it);
+	}
+
+	// Adds chunks for at least n elements in total.
+	void reserve(size_t n)
+	{
+		while (capacity() < n)
+			add_chunk();
+	}
+
+	/* observers */
+
+	iterator begin() noexcept
+	{
+		const auto first = next_occupied(0, 0);
+		return iterator(this, first.first, first.second);
+	}
+
+	iterator end() noexcept
+	{
+		return iterator(this, chunks.size(), 0);
+	}
+
+	const_iterator begin() const noexcept
+	{
+		const auto first = next_occupied(0, 0);
+		return const_iterator(this, first.first, first.second);
+	}
+
+	const_iterator end() const noexcept
+	{
+		return const_iterator(this, chunks.size(), 0);
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	bool empty() const noexcept
+	{
+		return count == 0;
+	}
+
+	size_t capacity() const noexcept
+	{
+		return chunks.size() * chunk_slots;
+	}
+
+	size_t chunk_count() const noexcept
+	{
+		return chunks.size();
+	}
+
+	// Occupancy bitmap of a chunk: bit s is set if slot s holds an element.
+	uint64_t chunk_occupancy(size_t chunk) const noexcept
+	{
+		return occupancy[chunk];
+	}
+
+private:
+	using slot_type =
+	    std::aligned_storage_t<sizeof(value_type), alignof(value_type)>;
+
+	value_type* at(size_t chunk, size_t slot) const noexcept
+	{
+		return reinterpret_cast<value_type*>(
+		    reinterpret_cast<slot_type*>(chunks[chunk].data()) + slot);
+	}
+
+	void add_chunk()
+	{
+		chunks.emplace_back(chunk_slots * sizeof(slot_type), chunk_alignment);
+		occupancy.push_back(0);
+		with_space.push_back(chunks.size() - 1);
+	}
+
+	// First occupied slot at or after (chunk, slot), or end().
+	std::pair<size_t, size_t> next_occupied(size_t chunk,
+	                                        size_t slot) const noexcept
+	{
+		auto bits = slot < chunk_slots && chunk < chunks.size()
+		                ? occupancy[chunk] & (~uint64_t(0) << slot)
+		                : 0;
+
+		while (!bits)
+		{
+			if (++chunk >= chunks.size())
+				return {chunks.size(), 0};
+
+			bits = occupancy[chunk];
+		}
+
+		return {chunk, local_derived_internal::ctz64(bits)};
+	}
+
+	std::vector<local_derived_internal::aligned_buffer> chunks;
+	std::vector<uint64_t> occupancy; // per chunk
+	std::vector<size_t> with_space;  // chunks with a free slot
+	size_t count = 0;
+};
+
+template <class Base, size_t slot_size, size_t alignment>
+constexpr size_t stable_local_vector<Base, slot_size, alignment>::chunk_slots;
+
+template <class Base, size_t slot_size, size_t alignment>
+constexpr size_t
+    stable_local_vector<Base, slot_size, alignment>::chunk_alignment;
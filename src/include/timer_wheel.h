@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "local_derived.h"
+#include "local_derived_buffer.h"
+
+// Identifies an armed timer; stale once it fires or is cancelled.
+struct timer_handle
+{
+	uint32_t slot = std::numeric_limits<uint32_t>::max();
+	uint32_t generation = 0;
+};
+
+/*
+     A hashed hierarchical timer wheel with in-place callbacks.
+
+     Each timer stores its callback in-place, as a local_derived<Callback,
+    callback_size> in a slot that never moves. levels wheels of 2^bits
+    buckets cover
+    2^(bits * levels) ticks; timers further out wait in the last wheel
+    and are re-hashed as it turns. Buckets are intrusive doubly-linked
+    lists of slot indices, kept apart from the callbacks, so arm() and
+    cancel() are O(1) and a cascade doesn't touch the callbacks.
+
+        timer_wheel<timeout, 32> w;
+        auto h = w.arm<close_connection>(100, ...);
+        w.cancel(h);
+        w.advance(1, [](timeout& t) { t.fire(); });
+
+     Params:
+      - Callback       the base class of callbacks
+      - callback_size  maximum allowed callback size, see local_derived
+      - levels         number of wheels
+      - bits           log2 of buckets per wheel
+      - alignment      minimum callback alignment
+
+     Requirements are the same as for local_derived, plus:
+     - levels > 0, 0 < bits, bits * levels <= 64
+
+     Slots are numbered with 32 bits; arm() and reserve() throw
+    std::length_error when more would be needed.
+*/
+template <class Callback,
+          size_t callback_size,
+          size_t levels = 4,
+          size_t bits = 8,
+          size_t alignment = alignof(std::max_align_t)>
+class timer_wheel
+{
+public:
+	using value_type = local_derived<Callback, callback_size, alignment>;
+
+	static_assert(levels > 0 && bits > 0 && bits * levels <= 64,
+	              "Requirement: levels > 0, 0 < bits, bits * levels <= 64");
+
+	static constexpr size_t buckets = size_t(1) << bits;
+
+	// Slots per chunk of callback storage.
+	static constexpr size_t chunk_slots = 1024;
+
+	timer_wheel()
+	{
+		// one list head per bucket, and one for the timers being fired
+		links.resize(head_count);
+		for (uint32_t h = 0; h < head_count; ++h)
+			links[h] = link{h, h};
+	}
+
+	timer_wheel(const timer_wheel&) = delete;
+	timer_wheel& operator=(const timer_wheel&) = delete;
+
+	~timer_wheel()
+	{
+		clear();
+	}
+
+	/* modifiers */
+
+	/*
+	    Arms a U, constructed from args, to fire after delay ticks
+	    (at least 1).
+	*/
+	template <class U, class... Args>
+	timer_handle arm(uint64_t delay, Args&&... args)
+	{
+		const auto slot = allocate_slot();
+		try
+		{
+			new (at(slot))
+			    value_type(emplace_tag_t<U>(), std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			free_slots.push_back(slot); // fits, it was just taken out
+			throw;
+		}
+
+		expiry[slot] = now + (delay ? delay : 1);
+		insert(slot);
+		++armed;
+
+		return timer_handle{slot, generation[slot]};
+	}
+
+	// Cancels a timer. Returns false if it already fired or was cancelled.
+	bool cancel(timer_handle h)
+	{
+		if (h.slot >= generation.size() || generation[h.slot] != h.generation)
+			return false;
+
+		unlink(node(h.slot));
+		release(h.slot);
+		--armed;
+		return true;
+	}
+
+	/*
+	    Advances time by ticks, calling f(Callback&) for each timer that
+	    expires, bucket by bucket. Each timer is destroyed after its call.
+	    f may arm and cancel timers. Returns the number of timers fired.
+	*/
+	template <class F>
+	size_t advance(uint64_t ticks, F&& f)
+	{
+		auto fired = size_t(0);
+
+		for (; ticks > 0; --ticks)
+		{
+			++now;
+			cascade();
+			fired += expire(head(0, now & mask), f);
+		}
+		return fired;
+	}
+
+	// Cancels all timers, keeps the storage.
+	void clear()
+	{
+		for (uint32_t h = 0; h < head_count; ++h)
+		{
+			while (links[h].next != h)
+			{
+				const auto n = links[h].next;
+				unlink(n);
+				release(slot_of(n));
+			}
+		}
+		armed = 0;
+	}
+
+	void reserve(size_t n)
+	{
+		links.reserve(head_count + n);
+		expiry.reserve(n);
+		generation.reserve(n);
+		while (chunks.size() * chunk_slots < n)
+			add_chunk();
+	}
+
+	/* observers */
+
+	// Current time, in ticks.
+	uint64_t time() const noexcept
+	{
+		return now;
+	}
+
+	// Number of armed timers.
+	size_t size() const noexcept
+	{
+		return armed;
+	}
+
+	bool empty() const noexcept
+	{
+		return armed == 0;
+	}
+
+	// Returns true if the timer is armed.
+	bool pending(timer_handle h) const noexcept
+	{
+		return h.slot < generation.size() && generation[h.slot] == h.generation;
+	}
+
+private:
+	using slot_type =
+	    std::aligned_storage_t<sizeof(value_type), alignof(value_type)>;
+
+	// Doubly-linked list node: list heads first, then one per slot.
+	struct link
+	{
+		uint32_t prev;
+		uint32_t next;
+	};
+
+	static constexpr uint64_t mask = buckets - 1;
+	static constexpr uint32_t head_count =
+	    static_cast<uint32_t>(levels * buckets + 1);
+	static constexpr uint32_t firing = head_count - 1;
+
+	static uint32_t head(size_t level, uint64_t bucket) noexcept
+	{
+		return static_cast<uint32_t>(level * buckets + bucket);
+	}
+
+	static uint32_t node(uint32_t slot) noexcept
+	{
+		return head_count + slot;
+	}
+
+	static uint32_t slot_of(uint32_t node) noexcept
+	{
+		return node - head_count;
+	}
+
+	value_type* at(uint32_t slot) const noexcept
+	{
+		auto* chunk = reinterpret_cast<slot_type*>(chunks[slot / chunk_slots].data());
+		return reinterpret_cast<value_type*>(chunk + slot % chunk_slots);
+	}
+
+	void add_chunk()
+	{
+		const auto first = chunks.size() * chunk_slots;
+		const auto slots = first + chunk_slots;
+		if (head_count + slots > std::numeric_limits<uint32_t>::max())
+			throw std::length_error("timer_wheel: too many timers");
+
+		// sized from the chunk count, so a failure here leaves no slot
+		// behind, and a retry doesn't grow them again
+		links.resize(head_count + slots);
+		expiry.resize(slots);
+		generation.resize(slots);
+		free_slots.reserve(free_slots.size() + chunk_slots);
+		chunks.emplace_back(chunk_slots * sizeof(slot_type), alignof(slot_type));
+
+		// hand out the lowest slots first
+		for (size_t i = chunk_slots; i-- > 0;)
+			free_slots.push_back(static_cast<uint32_t>(first + i));
+	}
+
+	uint32_t allocate_slot()
+	{
+		if (free_slots.empty())
+			add_chunk();
+
+		const auto slot = free_slots.back();
+		free_slots.pop_back();
+		return slot;
+	}
+
+	// Destroys the callback of an unlinked slot and frees the slot.
+	void release(uint32_t slot)
+	{
+		++generation[slot];
+		at(slot)->~value_type();
+		free_slots.push_back(slot);
+	}
+
+	void push_back(uint32_t list, uint32_t n) noexcept
+	{
+		const auto last = links[list].prev;
+		links[n] = link{last, list};
+		links[last].next = n;
+		links[list].prev = n;
+	}
+
+	void unlink(uint32_t n) noexcept
+	{
+		const auto l = links[n];
+		links[l.prev].next = l.next;
+		links[l.next].prev = l.prev;
+	}
+
+	// Moves all nodes of list from to the end of list to.
+	void splice(uint32_t from, uint32_t to) noexcept
+	{
+		if (links[from].next == from)
+			return;
+
+		const auto first = links[from].next;
+		const auto last = links[from].prev;
+		const auto tail = links[to].prev;
+
+		links[tail].next = first;
+		links[first].prev = tail;
+		links[last].next = to;
+		links[to].prev = last;
+		links[from] = link{from, from};
+	}
+
+	/*
+	    Puts a slot into the bucket for its expiry, which must not be in
+	    the past. A cascade may re-hash a timer due now into the current
+	    bucket of wheel 0, which expires right after.
+	*/
+	void insert(uint32_t slot) noexcept
+	{
+		assert(expiry[slot] >= now);
+
+		const auto when = expiry[slot];
+		const auto delta = when - now;
+
+		for (size_t level = 0; level < levels; ++level)
+		{
+			const auto shift = bits * (level + 1);
+			if (shift >= 64 || delta < (uint64_t(1) << shift))
+			{
+				push_back(head(level, (when >> (bits * level)) & mask),
+				          node(slot));
+				return;
+			}
+		}
+
+		// beyond the last wheel: wait in the bucket turned last
+		const auto shift = bits * (levels - 1);
+		push_back(head(levels - 1, ((now >> shift) - 1) & mask), node(slot));
+	}
+
+	/*
+	    When wheel 0 turns over, re-hashes the current bucket of wheel 1
+	    into the lower wheel, and so on up, from the highest wheel that
+	    turned over down.
+	*/
+	void cascade()
+	{
+		auto top = size_t(0);
+		while (top + 1 < levels && ((now >> (bits * top)) & mask) == 0)
+			++top;
+
+		for (auto level = top; level > 0; --level)
+		{
+			const auto h = head(level, (now >> (bits * level)) & mask);
+
+			splice(h, firing);
+			while (links[firing].next != firing)
+			{
+				const auto n = links[firing].next;
+				unlink(n);
+				insert(slot_of(n));
+			}
+		}
+	}
+
+	// Fires all timers in bucket h.
+	template <class F>
+	size_t expire(uint32_t h, F& f)
+	{
+		auto fired = size_t(0);
+
+		splice(h, firing);
+		while (links[firing].next != firing)
+		{
+			const auto n = links[firing].next;
+			const auto slot = slot_of(n);
+			unlink(n);
+
+			// the handle is stale during the call, so cancel() ignores it
+			++generation[slot];
+			--armed;
+			f(**at(slot));
+			--generation[slot];
+
+			release(slot);
+			++fired;
+		}
+		return fired;
+	}
+
+	std::vector<link> links;         // list heads, then one per slot
+	std::vector<uint64_t> expiry;    // per slot
+	std::vector<uint32_t> generation; // per slot, bumped on release
+	std::vector<local_derived_internal::aligned_buffer> chunks;
+	std::vector<uint32_t> free_slots;
+	uint64_t now = 0;
+	size_t armed = 0;
+};
+
+template <class Callback,
+          size_t callback_size,
+          size_t levels,
+          size_t bits,
+          size_t alignment>
+constexpr size_t
+    timer_wheel<Callback, callback_size, levels, bits, alignment>::buckets;
+
+template <class Callback,
+          size_t callback_size,
+          size_t levels,
+          size_t bits,
+          size_t alignment>
+constexpr size_t
+    timer_wheel<Callback, callback_size, levels, bits, alignment>::chunk_slots;
@@ -0,0 +1,314 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "actor_runtime.h"
+
+namespace
+{
+// Waits until pred() holds, or about 10 seconds pass.
+template <class Pred>
+bool wait_for(Pred pred)
+{
+	for (int i = 0; i < 10000 && !pred(); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return pred();
+}
+
+class message
+{
+public:
+	virtual ~message()
+	{
+	}
+
+	virtual int value() const = 0;
+};
+
+class number final : public message
+{
+public:
+	number(int v, std::atomic<int>* live = nullptr) : v(v), live(live)
+	{
+		if (live)
+			++*live;
+	}
+
+	number(number&& other) : v(other.v), live(other.live)
+	{
+		if (live)
+			++*live;
+	}
+
+	~number() override
+	{
+		if (live)
+			--*live;
+	}
+
+	int value() const override
+	{
+		return v;
+	}
+
+private:
+	int v;
+	std::atomic<int>* live;
+};
+
+class actor
+{
+public:
+	virtual ~actor()
+	{
+	}
+
+	virtual void receive(message& m) = 0;
+};
+
+using runtime = actor_runtime<actor, 64, message, 32>;
+
+// Sums the values it receives.
+class counter final : public actor
+{
+public:
+	counter(std::atomic<long>& sum, std::atomic<int>& received)
+	  : sum(&sum), received(&received)
+	{
+	}
+
+	void receive(message& m) override
+	{
+		*sum += m.value();
+		++*received;
+	}
+
+private:
+	std::atomic<long>* sum;
+	std::atomic<int>* received;
+};
+
+// Replies to its peer with value - 1, until 0.
+class ponger final : public actor
+{
+public:
+	ponger(runtime& rt, std::atomic<int>& done, runtime::actor_id peer)
+	  : rt(&rt), done(&done), peer(peer)
+	{
+	}
+
+	void receive(message& m) override
+	{
+		if (m.value() == 0)
+			++*done;
+		else
+			rt->send<number>(peer, m.value() - 1);
+	}
+
+private:
+	runtime* rt;
+	std::atomic<int>* done;
+	runtime::actor_id peer;
+};
+}
+
+TEST_CASE("test mpsc_ring")
+{
+	mpsc_ring<int> ring(5);
+	REQUIRE(ring.capacity() == 8);
+
+	SECTION("test fifo order and capacity")
+	{
+		for (int i = 0; i < 8; ++i)
+			REQUIRE(ring.try_emplace(i));
+		REQUIRE(!ring.try_emplace(8));
+
+		auto out = std::vector<int>();
+		while (ring.try_consume([&](int& v) { out.push_back(v); }))
+			;
+
+		REQUIRE(out == (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+		REQUIRE(ring.empty());
+		REQUIRE(ring.try_emplace(9));
+		REQUIRE(!ring.empty());
+	}
+
+	SECTION("test with concurrent producers")
+	{
+		const int producers = 4;
+		const int per_producer = 20000;
+
+		auto threads = std::vector<std::thread>();
+		for (int p = 0; p < producers; ++p)
+		{
+			threads.emplace_back([&ring, p] {
+				for (int i = 0; i < per_producer; ++i)
+				{
+					while (!ring.try_emplace(p * per_producer + i))
+						std::this_thread::yield();
+				}
+			});
+		}
+
+		// each producer's values arrive in order
+		auto next = std::vector<int>(producers, 0);
+		auto received = 0;
+		auto ordered = true;
+
+		while (received < producers * per_producer)
+		{
+			if (!ring.try_consume([&](int& v) {
+				    const auto p = v / per_producer;
+				    ordered = ordered && v % per_producer == next[p]++;
+			    }))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			++received;
+		}
+
+		for (auto& t : threads)
+			t.join();
+
+		REQUIRE(ordered);
+		REQUIRE(ring.empty());
+	}
+}
+
+TEST_CASE("test actor_runtime")
+{
+	auto c = runtime::config();
+	c.workers = 2;
+	c.mailbox_capacity = 16;
+	c.batch = 4;
+
+	SECTION("test messages from many threads")
+	{
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+
+		runtime rt(c);
+		const auto a = rt.spawn<counter>(sum, received);
+		const auto b = rt.spawn<counter>(sum, received);
+		REQUIRE(rt.actor_count() == 2);
+		rt.start();
+
+		auto threads = std::vector<std::thread>();
+		for (int t = 0; t < 3; ++t)
+		{
+			threads.emplace_back([&] {
+				for (int i = 1; i <= 1000; ++i)
+				{
+					rt.send<number>(a, i);
+					rt.send<number>(b, 1);
+				}
+			});
+		}
+		for (auto& t : threads)
+			t.join();
+
+		REQUIRE(wait_for([&] { return received == 6000; }));
+		REQUIRE(sum == 3 * (500500 + 1000));
+	}
+
+	SECTION("test ping-pong between workers")
+	{
+		std::atomic<int> done(0);
+
+		// two pairs, each across both workers
+		runtime rt(c);
+		const auto a = rt.spawn_on<ponger>(0, rt, done, 1u);
+		rt.spawn_on<ponger>(1, rt, done, 0u);
+		const auto b = rt.spawn_on<ponger>(0, rt, done, 3u);
+		rt.spawn_on<ponger>(1, rt, done, 2u);
+		rt.start();
+
+		rt.send<number>(a, 1001);
+		rt.send<number>(b, 2000);
+
+		REQUIRE(wait_for([&] { return done == 2; }));
+	}
+
+	SECTION("test a config with no workers or batch gets one of each")
+	{
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+
+		c.workers = 0;
+		c.batch = 0;
+
+		runtime rt(c);
+		REQUIRE(rt.worker_count() == 1);
+
+		const auto a = rt.spawn<counter>(sum, received);
+		rt.start();
+		for (int i = 1; i <= 10; ++i)
+			rt.send<number>(a, i);
+
+		REQUIRE(wait_for([&] { return received == 10; }));
+		REQUIRE(sum == 55);
+	}
+
+	SECTION("test max_actors and unknown ids are rejected")
+	{
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+
+		c.max_actors = 2;
+		runtime rt(c);
+		rt.spawn<counter>(sum, received);
+		const auto b = rt.spawn<counter>(sum, received);
+
+		REQUIRE_THROWS_AS(rt.spawn<counter>(sum, received),
+		                  const std::length_error&);
+		REQUIRE(rt.actor_count() == 2);
+
+		REQUIRE_THROWS_AS(rt.try_send<number>(b + 1, 1),
+		                  const std::out_of_range&);
+		REQUIRE_THROWS_AS(rt.send<number>(b + 7, 1), const std::out_of_range&);
+
+		rt.start();
+		rt.send<number>(b, 3);
+		REQUIRE(wait_for([&] { return received == 1; }));
+		REQUIRE(sum == 3);
+	}
+
+	SECTION("test try_send on a full mailbox")
+	{
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+
+		runtime rt(c);
+		const auto a = rt.spawn<counter>(sum, received);
+
+		// not started: the mailbox fills up
+		for (int i = 0; i < 16; ++i)
+			REQUIRE(rt.try_send<number>(a, 1));
+		REQUIRE(!rt.try_send<number>(a, 1));
+
+		rt.start();
+		REQUIRE(wait_for([&] { return received == 16; }));
+		REQUIRE(rt.try_send<number>(a, 1));
+	}
+
+	SECTION("test pending messages are destroyed with the runtime")
+	{
+		std::atomic<int> live(0);
+		std::atomic<long> sum(0);
+		std::atomic<int> received(0);
+
+		{
+			runtime rt(c);
+			const auto a = rt.spawn<counter>(sum, received);
+			rt.try_send<number>(a, 1, &live);
+			rt.try_send<number>(a, 2, &live);
+			REQUIRE(live == 2);
+		}
+
+		REQUIRE(live == 0);
+		REQUIRE(received == 0);
+	}
+}
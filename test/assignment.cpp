@@ -193,4 +193,20 @@ TEST_CASE("test assignment")
 			REQUIRE(d22->message() == derived22::expected_message(tag_d22));
 		}
 	}
+
+	SECTION("emplace a new object in place of the old one")
+	{
+		auto d = local_derived<base, S>(emplace_tag_t<derived1>(), tag_d1);
+		const auto* buffer = &d;
+
+		auto& d21 = d.emplace<derived21>(tag_d21);
+		REQUIRE(&d == buffer);
+		REQUIRE(d.holds<derived21>());
+		REQUIRE(d.get() == static_cast<base*>(&d21));
+		REQUIRE(d->message() == derived21::expected_message(tag_d21));
+
+		d.emplace<base>(tag_base);
+		REQUIRE(d.holds<base>());
+		REQUIRE(d->message() == base::expected_message(tag_base));
+	}
 }
\ No newline at end of file
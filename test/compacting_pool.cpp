@@ -0,0 +1,198 @@
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+#include "catch.hpp"
+#include "compacting_pool.h"
+
+namespace
+{
+int live = 0;
+
+class shape
+{
+public:
+	virtual ~shape()
+	{
+	}
+
+	virtual int id() const = 0;
+};
+
+// Padding in front of the base subobject, so relocation needs the offset.
+struct padding
+{
+	char bytes[24] = {};
+};
+
+class tagged final : public padding, public shape
+{
+public:
+	explicit tagged(int id) : value(id)
+	{
+		++live;
+	}
+
+	tagged(tagged&& other) : padding(other), shape(), value(other.value)
+	{
+		++live;
+	}
+
+	~tagged() override
+	{
+		--live;
+	}
+
+	int id() const override
+	{
+		return value;
+	}
+
+private:
+	int value;
+};
+
+// Throws from its constructor.
+class failing final : public shape
+{
+public:
+	failing()
+	{
+		throw std::runtime_error("failing");
+	}
+
+	int id() const override
+	{
+		return -1;
+	}
+};
+
+using pool = compacting_pool<shape, 48>;
+
+std::vector<int> ids(const pool& p)
+{
+	auto out = std::vector<int>();
+	p.for_each([&](const shape& s) { out.push_back(s.id()); });
+	return out;
+}
+}
+
+TEST_CASE("test compacting_pool")
+{
+	live = 0;
+
+	SECTION("erase leaves holes that compaction fills")
+	{
+		pool p;
+
+		auto handles = std::vector<pool_handle>();
+		for (int i = 0; i < 10; ++i)
+			handles.push_back(p.insert<tagged>(i));
+		REQUIRE(p.size() == 10);
+		REQUIRE(live == 10);
+
+		for (int i : {1, 3, 4, 9})
+			REQUIRE(p.erase(handles[i]));
+		REQUIRE_FALSE(p.erase(handles[1]));
+		REQUIRE(p.get(handles[1]) == nullptr);
+		REQUIRE(live == 6);
+
+		// the trailing hole is dropped at once
+		auto f = p.fragmentation();
+		REQUIRE(f.live == 6);
+		REQUIRE(f.span == 9);
+		REQUIRE(f.holes() == 3);
+		REQUIRE(f.density() == Approx(6.0 / 9.0));
+		REQUIRE((ids(p) == std::vector<int>{0, 2, 5, 6, 7, 8}));
+
+		SECTION("in bounded steps")
+		{
+			REQUIRE_FALSE(p.compact(1));
+			REQUIRE(p.fragmentation().span == 8);
+			REQUIRE_FALSE(p.compact(1));
+			REQUIRE(p.compact(1));
+			REQUIRE(p.compact(1));
+		}
+
+		SECTION("in a time slice")
+		{
+			REQUIRE(p.compact_for(std::chrono::milliseconds(100)));
+		}
+
+		f = p.fragmentation();
+		REQUIRE(f.span == 6);
+		REQUIRE(f.holes() == 0);
+		REQUIRE(f.density() == 1.0);
+		REQUIRE(live == 6);
+
+		// handles still find their objects
+		for (int i : {0, 2, 5, 6, 7, 8})
+			REQUIRE(p.get(handles[i])->id() == i);
+		REQUIRE((ids(p) == std::vector<int>{0, 8, 2, 7, 6, 5}));
+	}
+
+	SECTION("erase and insert between slices")
+	{
+		pool p;
+
+		auto handles = std::vector<pool_handle>();
+		for (int i = 0; i < 100; ++i)
+			handles.push_back(p.insert<tagged>(i));
+		for (int i = 0; i < 100; i += 2)
+			p.erase(handles[i]);
+
+		REQUIRE_FALSE(p.compact(5));
+		p.erase(handles[1]);
+		handles.push_back(p.insert<tagged>(100));
+		REQUIRE_FALSE(p.compact(5));
+
+		while (!p.compact(5))
+		{
+		}
+
+		REQUIRE(p.size() == 50);
+		REQUIRE(p.fragmentation().span == 50);
+		for (int i = 3; i < 100; i += 2)
+			REQUIRE(p.get(handles[i])->id() == i);
+		REQUIRE(p.get(handles[100])->id() == 100);
+	}
+
+	SECTION("growing and clearing")
+	{
+		{
+			pool p;
+			p.reserve(10);
+			REQUIRE(p.capacity() >= 10);
+
+			auto handles = std::vector<pool_handle>();
+			for (int i = 0; i < 1000; ++i)
+				handles.push_back(p.insert<tagged>(i));
+			REQUIRE(p.get(handles[500])->id() == 500);
+
+			p.clear();
+			REQUIRE(p.empty());
+			REQUIRE(live == 0);
+			REQUIRE_FALSE(p.contains(handles[0]));
+
+			const auto h = p.insert<tagged>(7);
+			REQUIRE(p.get(h)->id() == 7);
+			REQUIRE(p.fragmentation().span == 1);
+		}
+		REQUIRE(live == 0);
+	}
+
+	SECTION("a throwing constructor inserts nothing")
+	{
+		pool p;
+		const auto a = p.insert<tagged>(1);
+		REQUIRE_THROWS_AS(p.insert<failing>(), const std::runtime_error&);
+		REQUIRE(p.size() == 1);
+
+		const auto b = p.insert<tagged>(2);
+		REQUIRE(ids(p) == (std::vector<int>{1, 2}));
+		REQUIRE(p.fragmentation().span == 2);
+
+		p.erase(a);
+		p.erase(b);
+		REQUIRE(p.empty());
+	}
+}
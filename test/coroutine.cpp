@@ -0,0 +1,183 @@
+#include <vector>
+#include "catch.hpp"
+#include "local_coroutine.h"
+
+namespace
+{
+local_task count_to(frame_allocator& frames,
+                    local_scheduler& scheduler,
+                    int n,
+                    std::vector<int>& out)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		out.push_back(i);
+		co_await scheduler.yield();
+	}
+}
+
+local_task heap_count_to(local_scheduler& scheduler,
+                         int n,
+                         std::vector<int>& out)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		out.push_back(i);
+		co_await scheduler.yield();
+	}
+}
+
+// Suspends until resumed through the handle it leaves in parked.
+struct park
+{
+	std::coroutine_handle<>& parked;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(std::coroutine_handle<> h) const noexcept
+	{
+		parked = h;
+	}
+
+	void await_resume() const noexcept
+	{
+	}
+};
+
+local_task wait_for(frame_allocator& frames,
+                    std::coroutine_handle<>& parked,
+                    std::vector<int>& out)
+{
+	co_await park{parked};
+	out.push_back(1);
+}
+
+local_task with_large_frame(frame_allocator& frames,
+                            local_scheduler& scheduler,
+                            int& out)
+{
+	volatile char big[1024] = {};
+	co_await scheduler.yield();
+	out = big[0] + 1;
+}
+}
+
+TEST_CASE("coroutine frames from a local_frame_pool")
+{
+	local_frame_pool<256, 4> pool;
+	local_scheduler scheduler;
+	std::vector<int> a, b;
+
+	scheduler.spawn(count_to(pool, scheduler, 3, a));
+	scheduler.spawn(count_to(pool, scheduler, 2, b));
+
+	REQUIRE(pool.in_use() == 2);
+	REQUIRE(pool.overflows() == 0);
+	REQUIRE(pool.largest_frame() <= 256);
+
+	SECTION("tasks run to completion and release their frames")
+	{
+		REQUIRE(scheduler.run() == 4 + 3);
+		REQUIRE(a == (std::vector<int>{0, 1, 2}));
+		REQUIRE(b == (std::vector<int>{0, 1}));
+		REQUIRE(pool.in_use() == 0);
+		REQUIRE(scheduler.pending() == 0);
+	}
+
+	SECTION("frames are reused")
+	{
+		scheduler.run();
+		scheduler.spawn(count_to(pool, scheduler, 1, a));
+		REQUIRE(pool.in_use() == 1);
+		scheduler.run();
+		REQUIRE(pool.in_use() == 0);
+		REQUIRE(pool.overflows() == 0);
+	}
+}
+
+TEST_CASE("overflowing coroutine frames go to the heap")
+{
+	local_frame_pool<256, 1> pool;
+	local_scheduler scheduler;
+	std::vector<int> a, b;
+	int large = 0;
+
+	SECTION("pool exhausted")
+	{
+		scheduler.spawn(count_to(pool, scheduler, 1, a));
+		scheduler.spawn(count_to(pool, scheduler, 1, b));
+		REQUIRE(pool.in_use() == 1);
+		REQUIRE(pool.overflows() == 1);
+
+		scheduler.run();
+		REQUIRE(a.size() == 1);
+		REQUIRE(b.size() == 1);
+		REQUIRE(pool.in_use() == 0);
+	}
+
+	SECTION("frame too large")
+	{
+		scheduler.spawn(with_large_frame(pool, scheduler, large));
+		REQUIRE(pool.in_use() == 0);
+		REQUIRE(pool.overflows() == 1);
+		REQUIRE(pool.largest_frame() > 1024);
+
+		scheduler.run();
+		REQUIRE(large == 1);
+	}
+}
+
+TEST_CASE("coroutines without a frame_allocator use the heap")
+{
+	local_scheduler scheduler;
+	std::vector<int> out;
+
+	scheduler.spawn(heap_count_to(scheduler, 2, out));
+	scheduler.run();
+
+	REQUIRE(out == (std::vector<int>{0, 1}));
+}
+
+TEST_CASE("unstarted tasks are destroyed with their owner")
+{
+	local_frame_pool<256, 2> pool;
+	local_scheduler scheduler;
+	std::vector<int> out;
+
+	{
+		auto task = count_to(pool, scheduler, 1, out);
+		REQUIRE(pool.in_use() == 1);
+	}
+	REQUIRE(pool.in_use() == 0);
+
+	{
+		local_scheduler other;
+		other.spawn(count_to(pool, other, 1, out));
+		REQUIRE(pool.in_use() == 1);
+	}
+	REQUIRE(pool.in_use() == 0);
+	REQUIRE(out.empty());
+}
+
+TEST_CASE("suspended tasks are destroyed with their scheduler")
+{
+	local_frame_pool<256, 2> pool;
+	std::vector<int> out;
+	std::coroutine_handle<> parked;
+
+	{
+		local_scheduler scheduler;
+		scheduler.spawn(wait_for(pool, parked, out));
+		scheduler.spawn(count_to(pool, scheduler, 1, out));
+
+		scheduler.run();
+		REQUIRE(parked);
+		REQUIRE(scheduler.pending() == 0);
+		REQUIRE(pool.in_use() == 1);
+	}
+	REQUIRE(pool.in_use() == 0);
+	REQUIRE(out == (std::vector<int>{0}));
+}
@@ -0,0 +1,153 @@
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "catch.hpp"
+#include "local_derived.h"
+#include "simple_hierarchy.h"
+
+namespace
+{
+// Counts live objects.
+class tracked : public simple_hierarchy::base
+{
+public:
+	tracked(int t, int& live) : base(t), live(&live)
+	{
+		++*this->live;
+	}
+
+	tracked(const tracked& other) : base(other), live(other.live)
+	{
+		++*live;
+	}
+
+	~tracked() override
+	{
+		--*live;
+	}
+
+private:
+	int* live;
+};
+
+// A base without a virtual destructor.
+class plain
+{
+public:
+	virtual int value() const = 0;
+
+protected:
+	~plain() = default;
+};
+
+class trivial final : public plain
+{
+public:
+	trivial(int v) : v(v)
+	{
+	}
+
+	int value() const override
+	{
+		return v;
+	}
+
+private:
+	int v;
+};
+
+class nontrivial final : public plain
+{
+public:
+	nontrivial(int& live) : live(&live)
+	{
+		++*this->live;
+	}
+
+	nontrivial(nontrivial&& other) : live(other.live)
+	{
+		++*live;
+	}
+
+	~nontrivial()
+	{
+		--*live;
+	}
+
+	int value() const override
+	{
+		return -1;
+	}
+
+private:
+	int* live;
+};
+}
+
+template <>
+struct allow_nonvirtual_destructor<plain> : std::true_type
+{
+};
+
+TEST_CASE("test destruction")
+{
+	using namespace simple_hierarchy;
+
+	const auto S = sizeof(derived21);
+
+	using ld = local_derived<base, S>;
+
+	auto live = 0;
+
+	SECTION("test if every object is destroyed exactly once")
+	{
+		{
+			auto a = ld(emplace_tag_t<tracked>(), 1, live);
+			auto b = ld(emplace_tag_t<tracked>(), 2, live);
+			REQUIRE(live == 2);
+
+			a = std::move(b); // destroys 1, b keeps a moved-from 2
+			REQUIRE(live == 2);
+
+			a = tracked(3, live); // copy of a temporary
+			REQUIRE(live == 2);
+
+			auto c = ld(emplace_tag_t<base>(), 4);
+			a.swap(c);
+			REQUIRE(live == 2);
+			REQUIRE(c->message() == base::expected_message(3));
+
+			c.swap(c);
+			REQUIRE(live == 2);
+
+			auto narrow =
+			    local_derived<base, sizeof(tracked)>(emplace_tag_t<tracked>(),
+			                                         5, live);
+			a = std::move(narrow);
+			REQUIRE(live == 4);
+		}
+
+		REQUIRE(live == 0);
+	}
+
+	SECTION("test a Base without a virtual destructor")
+	{
+		using pld = local_derived<plain, sizeof(trivial)>;
+
+		{
+			auto t = pld(emplace_tag_t<trivial>(), 7);
+			auto n = pld(emplace_tag_t<nontrivial>(), live);
+			REQUIRE(live == 1);
+
+			REQUIRE(t->value() == 7);
+			REQUIRE(n->value() == -1);
+
+			t.swap(n);
+			REQUIRE(live == 1);
+			REQUIRE(t->value() == -1);
+			REQUIRE(n->value() == 7);
+		}
+
+		REQUIRE(live == 0);
+	}
+}
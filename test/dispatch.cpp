@@ -0,0 +1,99 @@
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include "catch.hpp"
+#include "local_derived.h"
+#include "local_derived_dispatch.h"
+#include "simple_hierarchy.h"
+
+namespace
+{
+// Reports which overload was selected.
+struct which
+{
+	std::string operator()(simple_hierarchy::derived1&) const
+	{
+		return "derived1";
+	}
+
+	std::string operator()(simple_hierarchy::derived2&) const
+	{
+		return "derived2";
+	}
+
+	std::string operator()(simple_hierarchy::base&) const
+	{
+		return "base";
+	}
+};
+}
+
+TEST_CASE("test dispatch_likely")
+{
+	using namespace simple_hierarchy;
+
+	// pick the biggest object (you could use a compile-time max)
+
+	const auto S = sizeof(derived21);
+
+	// prepare tags for objects
+
+	auto tag_d1 = std::string("derived1");
+	auto tag_d11 = 6.1f;
+	auto tag_d2 = 3.14;
+
+	auto d1 = local_derived<base, S>(emplace_tag_t<derived1>(), tag_d1);
+	auto d11 = local_derived<base, S>(emplace_tag_t<derived11>(), tag_d11);
+	auto d2 = local_derived<base, S>(emplace_tag_t<derived2>(), tag_d2);
+
+	SECTION("test if listed types are called with their exact type")
+	{
+		REQUIRE((dispatch_likely<derived1, derived2>(d1, which()) ==
+		         "derived1"));
+		REQUIRE((dispatch_likely<derived1, derived2>(d2, which()) ==
+		         "derived2"));
+	}
+
+	SECTION("test if other types fall back to Base&")
+	{
+		REQUIRE(dispatch_likely<derived2>(d1, which()) == "base");
+
+		// derived11 is a derived1, but not exactly
+		REQUIRE(dispatch_likely<derived1>(d11, which()) == "base");
+
+		REQUIRE(dispatch_likely<>(d2, which()) == "base");
+	}
+
+	SECTION("test if the virtual call gives the same result either way")
+	{
+		const auto call = [](auto& x) { return x.message(); };
+
+		REQUIRE(dispatch_likely<derived1>(d1, call) ==
+		        derived1::expected_message(tag_d1));
+		REQUIRE(dispatch_likely<derived1>(d11, call) ==
+		        derived11::expected_message(tag_d11));
+	}
+
+	SECTION("test the type histogram")
+	{
+		auto site = dispatch_histogram("test");
+
+		dispatch_likely<derived1>(d1, which(), site);
+		dispatch_likely<derived1>(d1, which(), site);
+		dispatch_likely<derived1>(d2, which(), site);
+
+		REQUIRE(site.predicted() == 2);
+		REQUIRE(site.mispredicted() == 1);
+
+		const auto types = site.sorted();
+		REQUIRE(types.size() == 2);
+		REQUIRE(*types[0].type == typeid(derived1));
+		REQUIRE(types[0].count == 2);
+		REQUIRE(*types[1].type == typeid(derived2));
+		REQUIRE(types[1].count == 1);
+
+		auto out = std::ostringstream();
+		site.print(out);
+		REQUIRE(out.str().find("2 predicted, 1 virtual") != std::string::npos);
+	}
+}
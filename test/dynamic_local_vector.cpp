@@ -0,0 +1,86 @@
+#include <string>
+#include <utility>
+#include "catch.hpp"
+#include "dynamic_local_vector.h"
+#include "simple_hierarchy.h"
+
+TEST_CASE("test dynamic_local_vector")
+{
+	using namespace simple_hierarchy;
+
+	// prepare tags for objects
+
+	auto tag_base = 9;
+	auto tag_d2 = 3.14;
+	auto tag_d21 = std::string("derived21");
+	auto tag_d22 = 6.99;
+
+	auto registry = local_type_registry<base>();
+	registry.register_type<base>();
+	registry.register_type<derived2>();
+
+	auto v = dynamic_local_vector<base>(registry);
+
+	SECTION("test if the stride is computed from the registry")
+	{
+		REQUIRE(v.payload_size() >= sizeof(derived2));
+		REQUIRE(v.payload_size() < sizeof(derived21));
+		REQUIRE(v.stride() % v.alignment() == 0);
+	}
+
+	SECTION("test if registered types are stored in place")
+	{
+		v.emplace_back<base>(tag_base);
+		v.emplace_back<derived2>(tag_d2);
+
+		REQUIRE(v.size() == 2);
+		REQUIRE(v[0].message() == base::expected_message(tag_base));
+		REQUIRE(v[1].message() == derived2::expected_message(tag_d2));
+	}
+
+	SECTION("test if a new larger type rebuilds with a larger stride")
+	{
+		v.emplace_back<base>(tag_base);
+		v.emplace_back<derived2>(tag_d2);
+
+		const auto old_stride = v.stride();
+
+		v.emplace_back<derived21>(tag_d21);
+		v.emplace_back<derived22>(tag_d22);
+
+		REQUIRE(v.stride() > old_stride);
+		REQUIRE(v.payload_size() >= sizeof(derived21));
+		REQUIRE(registry.size() == 4);
+
+		REQUIRE(v[0].message() == base::expected_message(tag_base));
+		REQUIRE(v[1].message() == derived2::expected_message(tag_d2));
+		REQUIRE(v[2].message() == derived21::expected_message(tag_d21));
+		REQUIRE(v[3].message() == derived22::expected_message(tag_d22));
+	}
+
+	SECTION("test if rebuild adopts types registered elsewhere")
+	{
+		v.emplace_back<derived2>(tag_d2);
+
+		registry.register_type<derived21>(); // e.g. by a plugin
+		v.rebuild();
+
+		REQUIRE(v.payload_size() >= sizeof(derived21));
+		REQUIRE(v[0].message() == derived2::expected_message(tag_d2));
+	}
+
+	SECTION("test growth, pop_back and moving the vector")
+	{
+		for (int i = 0; i < 100; ++i)
+			v.emplace_back<base>(i);
+
+		v.pop_back();
+		REQUIRE(v.size() == 99);
+		REQUIRE(v[98].message() == base::expected_message(98));
+
+		auto moved = std::move(v);
+		REQUIRE(moved.size() == 99);
+		REQUIRE(v.empty());
+		REQUIRE(moved[50].message() == base::expected_message(50));
+	}
+}
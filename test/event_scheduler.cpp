@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "event_scheduler.h"
+
+namespace
+{
+class event
+{
+public:
+	virtual ~event()
+	{
+	}
+
+	virtual std::string name() const = 0;
+};
+
+class named final : public event
+{
+public:
+	named(std::string n, int& live) : n(std::move(n)), live(&live)
+	{
+		++*this->live;
+	}
+
+	named(named&& other) : n(std::move(other.n)), live(other.live)
+	{
+		++*live;
+	}
+
+	~named() override
+	{
+		--*live;
+	}
+
+	std::string name() const override
+	{
+		return n;
+	}
+
+private:
+	std::string n;
+	int* live;
+};
+
+class number final : public event
+{
+public:
+	number(int i) : i(i)
+	{
+	}
+
+	std::string name() const override
+	{
+		return std::to_string(i);
+	}
+
+private:
+	int i;
+};
+
+// Throws from its constructor.
+class failing final : public event
+{
+public:
+	failing()
+	{
+		throw std::runtime_error("failing");
+	}
+
+	std::string name() const override
+	{
+		return "failing";
+	}
+};
+}
+
+TEST_CASE("test event_scheduler")
+{
+	auto live = 0;
+	auto s = event_scheduler<event, 64>();
+	auto ran = std::vector<std::string>();
+	auto times = std::vector<uint64_t>();
+
+	const auto record = [&](uint64_t t, event& e) {
+		times.push_back(t);
+		ran.push_back(e.name());
+	};
+
+	SECTION("test if events run in timestamp order")
+	{
+		s.schedule<named>(30, "c", live);
+		s.schedule<number>(10, 1);
+		s.schedule<named>(20, "b", live);
+
+		REQUIRE(s.size() == 3);
+		REQUIRE(s.next_time() == 10);
+
+		while (s.run_next(record))
+			;
+
+		REQUIRE(ran == (std::vector<std::string>{"1", "b", "c"}));
+		REQUIRE(times == (std::vector<uint64_t>{10, 20, 30}));
+		REQUIRE(live == 0);
+		REQUIRE(!s.run_next(record));
+	}
+
+	SECTION("test if equal timestamps run in scheduling order")
+	{
+		for (int i = 0; i < 20; ++i)
+			s.schedule<number>(5, i);
+
+		s.run_until(5, record);
+		REQUIRE(ran.size() == 20);
+		for (int i = 0; i < 20; ++i)
+			REQUIRE(ran[i] == std::to_string(i));
+	}
+
+	SECTION("test run_until")
+	{
+		s.schedule<number>(1, 1);
+		s.schedule<number>(2, 2);
+		s.schedule<number>(3, 3);
+
+		REQUIRE(s.run_until(2, record) == 2);
+		REQUIRE(s.size() == 1);
+		REQUIRE(s.next_time() == 3);
+	}
+
+	SECTION("test if events can schedule events")
+	{
+		s.schedule<number>(0, 0);
+
+		auto count = 0;
+		while (s.run_next([&](uint64_t t, event&) {
+			if (++count < 5000)
+				s.schedule<number>(t + 1, count);
+		}))
+			;
+
+		REQUIRE(count == 5000);
+		REQUIRE(s.empty());
+	}
+
+	SECTION("test against a sorted reference")
+	{
+		auto rng = std::mt19937(1);
+		auto when = std::uniform_int_distribution<int>(0, 1000);
+		auto expected = std::vector<uint64_t>();
+
+		for (int i = 0; i < 3000; ++i)
+		{
+			const auto t = static_cast<uint64_t>(when(rng));
+			expected.push_back(t);
+			s.schedule<number>(t, i);
+		}
+
+		// interleave pops with pushes
+		for (int i = 0; i < 1000; ++i)
+			s.run_next(record);
+		for (int i = 0; i < 1000; ++i)
+		{
+			const auto t = static_cast<uint64_t>(1000 + when(rng));
+			expected.push_back(t);
+			s.schedule<number>(t, i);
+		}
+		while (s.run_next(record))
+			;
+
+		std::sort(expected.begin(), expected.end());
+		REQUIRE(times == expected);
+	}
+
+	SECTION("test clear destroys pending events")
+	{
+		s.schedule<named>(1, "a", live);
+		s.schedule<named>(2, "b", live);
+		REQUIRE(live == 2);
+
+		s.clear();
+		REQUIRE(live == 0);
+		REQUIRE(s.empty());
+
+		s.schedule<named>(3, "c", live);
+		REQUIRE(live == 1);
+	}
+
+	SECTION("test a throwing constructor schedules nothing")
+	{
+		s.schedule<named>(2, "a", live);
+		REQUIRE_THROWS_AS(s.schedule<failing>(1), const std::runtime_error&);
+		REQUIRE(s.size() == 1);
+
+		s.schedule<named>(1, "b", live);
+		while (s.run_next(record))
+			;
+
+		REQUIRE(ran == (std::vector<std::string>{"b", "a"}));
+		REQUIRE(live == 0);
+	}
+}
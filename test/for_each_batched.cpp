@@ -0,0 +1,119 @@
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "local_derived.h"
+#include "local_derived_algorithm.h"
+#include "simple_hierarchy.h"
+
+namespace
+{
+using namespace simple_hierarchy;
+
+// Records the runs passed to process_batch.
+struct run_log
+{
+	std::vector<std::string> runs;
+};
+
+// derived2 and derived22 with a batch kernel.
+class batched2 final : public derived2
+{
+public:
+	using derived2::derived2;
+
+	static void process_batch(batch_view<batched2> run, run_log& log)
+	{
+		for (size_t i = 0; i < run.size(); ++i)
+			run[i].depth(); // touch every element
+
+		log.runs.push_back("batched2 x" + std::to_string(run.size()));
+	}
+};
+
+class batched22 final : public derived22
+{
+public:
+	using derived22::derived22;
+
+	static void process_batch(batch_view<batched22> run, run_log& log)
+	{
+		log.runs.push_back("batched22 x" + std::to_string(run.size()) + " " +
+		                   run[run.size() - 1].message());
+	}
+};
+}
+
+static_assert(is_contiguous_iterator<int*>::value &&
+                  is_contiguous_iterator<const int*>::value,
+              "pointers are contiguous");
+static_assert(
+    is_contiguous_iterator<std::vector<int>::iterator>::value &&
+        is_contiguous_iterator<std::vector<int>::const_iterator>::value,
+    "vector iterators are contiguous");
+static_assert(!is_contiguous_iterator<std::deque<int>::iterator>::value &&
+                  !is_contiguous_iterator<std::list<int>::iterator>::value &&
+                  !is_contiguous_iterator<std::vector<bool>::iterator>::value,
+              "deque, list and vector<bool> iterators are not contiguous");
+
+TEST_CASE("test for_each_batched")
+{
+	const auto S = sizeof(derived21);
+
+	using ld = local_derived<base, S>;
+
+	auto v = std::vector<ld>();
+	v.emplace_back(emplace_tag_t<batched2>(), 1.0);
+	v.emplace_back(emplace_tag_t<batched2>(), 2.0);
+	v.emplace_back(emplace_tag_t<base>(), 3);
+	v.emplace_back(emplace_tag_t<batched22>(), 4.0);
+	v.emplace_back(emplace_tag_t<batched22>(), 5.0);
+	v.emplace_back(emplace_tag_t<batched22>(), 6.0);
+	v.emplace_back(emplace_tag_t<batched2>(), 7.0);
+	v.emplace_back(emplace_tag_t<derived1>(), "eight");
+
+	auto log = run_log();
+	const auto fallback = [](base& b, run_log& log) {
+		log.runs.push_back(b.message());
+	};
+
+	SECTION("test if runs of listed types are batched")
+	{
+		for_each_batched<batched2, batched22>(v.begin(), v.end(), fallback,
+		                                      log);
+
+		REQUIRE(log.runs.size() == 5);
+		REQUIRE(log.runs[0] == "batched2 x2");
+		REQUIRE(log.runs[1] == base::expected_message(3));
+		REQUIRE(log.runs[2] ==
+		        "batched22 x3 " + derived22::expected_message(6.0));
+		REQUIRE(log.runs[3] == "batched2 x1");
+		REQUIRE(log.runs[4] == derived1::expected_message("eight"));
+	}
+
+	SECTION("test if unlisted types use the fallback")
+	{
+		for_each_batched<batched22>(v.begin(), v.end(), fallback, log);
+
+		REQUIRE(log.runs.size() == 6);
+		REQUIRE(log.runs[0] == derived2::expected_message(1.0));
+		REQUIRE(log.runs[3] ==
+		        "batched22 x3 " + derived22::expected_message(6.0));
+	}
+
+	SECTION("test batch_view strides")
+	{
+		auto* first = v[3].get_if<batched22>();
+		auto run = batch_view<batched22>(first, 3, sizeof(ld));
+
+		REQUIRE(!run.contiguous());
+		REQUIRE(&run[2] == v[5].get_if<batched22>());
+
+		batched22 array[2] = {batched22(1.0), batched22(2.0)};
+		auto segregated = batch_view<batched22>(array, 2);
+
+		REQUIRE(segregated.contiguous());
+		REQUIRE(&segregated[1] == &array[1]);
+	}
+}
@@ -0,0 +1,138 @@
+#include <string>
+#include <utility>
+#include "catch.hpp"
+#include "local_derived.h"
+
+namespace
+{
+class shape
+{
+public:
+	virtual ~shape()
+	{
+	}
+
+	virtual std::string message() const
+	{
+		return "shape";
+	}
+};
+
+// Padding in front of the base subobject, so conversions need the offset.
+struct padding
+{
+	char bytes[24] = {};
+};
+
+class named : public padding, public shape
+{
+public:
+	explicit named(std::string name) : name(std::move(name))
+	{
+	}
+
+	std::string message() const override
+	{
+		return "named " + name;
+	}
+
+protected:
+	std::string name;
+};
+
+class counted final : public named
+{
+public:
+	counted(std::string name, int count) : named(std::move(name)), count(count)
+	{
+	}
+
+	std::string message() const override
+	{
+		return name + " x" + std::to_string(count);
+	}
+
+private:
+	int count;
+};
+
+class number final : public shape
+{
+public:
+	explicit number(double value) : value(value)
+	{
+	}
+
+	std::string message() const override
+	{
+		return "number " + std::to_string(value);
+	}
+
+private:
+	double value;
+};
+
+// Hot method policy: calls message() of U non-virtually.
+struct message_hot
+{
+	using signature = std::string();
+
+	template <class U>
+	static std::string call(U& obj)
+	{
+		return obj.U::message();
+	}
+};
+
+template <class Base, size_t size>
+using hot_local = local_derived<Base, size, alignof(std::max_align_t),
+                                uint8_t, message_hot>;
+}
+
+TEST_CASE("test hot method")
+{
+	using hot_ld = hot_local<shape, sizeof(counted)>;
+
+	SECTION("call the hot method of emplaced objects")
+	{
+		auto s = hot_ld(emplace_tag_t<shape>());
+		auto n = hot_ld(emplace_tag_t<named>(), "a");
+		auto c = hot_ld(emplace_tag_t<counted>(), "b", 3);
+		auto x = hot_ld(emplace_tag_t<number>(), 1.5);
+
+		SECTION("test if the hot method matches the virtual call")
+		{
+			REQUIRE(s.invoke_hot() == "shape");
+			REQUIRE(n.invoke_hot() == "named a");
+			REQUIRE(c.invoke_hot() == "b x3");
+			REQUIRE(x.invoke_hot() == x->message());
+
+			for (auto* p : {&s, &n, &c, &x})
+				REQUIRE(p->invoke_hot() == (*p)->message());
+		}
+
+		SECTION("test if the hot method follows moves and swaps")
+		{
+			auto moved = std::move(c);
+			REQUIRE(moved.invoke_hot() == "b x3");
+
+			s.swap(n);
+			REQUIRE(s.invoke_hot() == "named a");
+			REQUIRE(n.invoke_hot() == "shape");
+
+			x = std::move(moved);
+			REQUIRE(x.invoke_hot() == "b x3");
+		}
+	}
+
+	SECTION("convert from a different template instantiation")
+	{
+		auto from = hot_local<named, sizeof(counted)>(
+		    emplace_tag_t<counted>(), "c", 2);
+
+		auto c = hot_ld(std::move(from));
+
+		REQUIRE(c.invoke_hot() == "c x2");
+		REQUIRE(c->message() == "c x2");
+	}
+}
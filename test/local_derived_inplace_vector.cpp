@@ -0,0 +1,132 @@
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "catch.hpp"
+#include "local_derived_inplace_vector.h"
+#include "simple_hierarchy.h"
+
+TEST_CASE("test local_derived_inplace_vector")
+{
+	using namespace simple_hierarchy;
+
+	const auto S = sizeof(derived21);
+
+	// prepare tags for objects
+
+	auto tag_base = 9;
+	auto tag_d1 = std::string("derived1");
+	auto tag_d11 = 6.1f;
+	auto tag_d2 = 3.14;
+	auto tag_d21 = std::string("derived21");
+
+	using vector = local_derived_inplace_vector<base, S, 8>;
+
+	auto v = vector();
+
+	v.emplace_back<base>(tag_base);
+	v.emplace_back<derived1>(tag_d1);
+	v.emplace_back<derived11>(tag_d11);
+	v.emplace_back<derived2>(tag_d2);
+	v.emplace_back<derived21>(tag_d21);
+
+	SECTION("test if all slots are in-place")
+	{
+		REQUIRE(sizeof(vector) >= 8 * sizeof(vector::value_type));
+		REQUIRE(sizeof(vector) <=
+		        8 * sizeof(vector::value_type) + alignof(vector::value_type));
+		REQUIRE(vector::capacity() == 8);
+	}
+
+	SECTION("test if the proper tags are retrieved by a virtual call")
+	{
+		REQUIRE(v.size() == 5);
+		REQUIRE(v[0]->message() == base::expected_message(tag_base));
+		REQUIRE(v[1]->message() == derived1::expected_message(tag_d1));
+		REQUIRE(v[2]->message() == derived11::expected_message(tag_d11));
+		REQUIRE(v[3]->message() == derived2::expected_message(tag_d2));
+		REQUIRE(v[4]->message() == derived21::expected_message(tag_d21));
+	}
+
+	SECTION("test iteration")
+	{
+		auto depth = 0;
+		for (const auto& x : v)
+			depth += x->depth();
+
+		REQUIRE(depth == 0 + 1 + 2 + 1 + 2);
+	}
+
+	SECTION("test erase preserves the order")
+	{
+		auto it = v.erase(v.begin() + 1);
+		REQUIRE(it == v.begin() + 1);
+		REQUIRE(v.size() == 4);
+		REQUIRE(v[1]->message() == derived11::expected_message(tag_d11));
+		REQUIRE(v[3]->message() == derived21::expected_message(tag_d21));
+		REQUIRE(v[3].holds<derived21>());
+
+		v.erase(v.begin(), v.begin() + 2);
+		REQUIRE(v.size() == 2);
+		REQUIRE(v[0]->message() == derived2::expected_message(tag_d2));
+
+		v.erase(v.end(), v.end());
+		REQUIRE(v.size() == 2);
+	}
+
+	SECTION("test swap_remove")
+	{
+		v.swap_remove(0);
+		REQUIRE(v.size() == 4);
+		REQUIRE(v[0]->message() == derived21::expected_message(tag_d21));
+
+		v.swap_remove(3);
+		REQUIRE(v.size() == 3);
+		REQUIRE(v.back()->message() == derived11::expected_message(tag_d11));
+	}
+
+	SECTION("test push_back and pop_back")
+	{
+		v.push_back(vector::value_type(derived2(1.5)));
+		v.emplace_back<derived1>("x");
+		v.emplace_back<derived1>("y");
+		REQUIRE(v.full());
+
+		v.pop_back();
+		REQUIRE(v.size() == 7);
+		REQUIRE(v.back()->message() == derived1::expected_message("x"));
+		REQUIRE(v[5]->message() == derived2::expected_message(1.5));
+	}
+
+	SECTION("test adding to a full vector")
+	{
+		REQUIRE(v.try_emplace_back<derived1>("x") != nullptr);
+		REQUIRE(v.try_emplace_back<derived1>("y") != nullptr);
+		v.emplace_back<derived2>(1.5);
+		REQUIRE(v.full());
+
+		REQUIRE(v.try_emplace_back<derived1>("z") == nullptr);
+		REQUIRE_THROWS_AS(v.emplace_back<derived1>("z"), const std::bad_alloc&);
+		REQUIRE_THROWS_AS(v.push_back(vector::value_type(derived2(2.5))),
+		                  const std::bad_alloc&);
+
+		REQUIRE(v.size() == 8);
+		REQUIRE(v.back()->message() == derived2::expected_message(1.5));
+	}
+
+	SECTION("test move construction")
+	{
+		auto w = std::move(v);
+		REQUIRE(v.empty());
+		REQUIRE(w.size() == 5);
+		REQUIRE(w[4]->message() == derived21::expected_message(tag_d21));
+	}
+
+	SECTION("test clear")
+	{
+		v.clear();
+		REQUIRE(v.empty());
+		v.emplace_back<derived2>(tag_d2);
+		REQUIRE(v[0]->message() == derived2::expected_message(tag_d2));
+	}
+}
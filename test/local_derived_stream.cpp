@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "catch.hpp"
+#include "local_derived_stream.h"
+#include "simple_hierarchy.h"
+
+namespace
+{
+// Counts destructor calls.
+class counted : public simple_hierarchy::base
+{
+public:
+	counted(int t, int& destroyed) : base(t), destroyed(&destroyed)
+	{
+	}
+
+	~counted() override
+	{
+		++*destroyed;
+	}
+
+private:
+	int* destroyed;
+};
+
+// Larger than a small chunk.
+class large : public simple_hierarchy::base
+{
+public:
+	explicit large(int t) : base(t)
+	{
+		std::fill(std::begin(payload), std::end(payload), char(t));
+	}
+
+	char payload[1000];
+};
+
+// Leaves the next record at an offset that is not a multiple of 16.
+class padded : public simple_hierarchy::base
+{
+public:
+	explicit padded(int t) : base(t), extra(t)
+	{
+	}
+
+	double extra;
+};
+
+class alignas(16) aligned16 : public simple_hierarchy::base
+{
+public:
+	explicit aligned16(int t) : base(t)
+	{
+	}
+
+	double value[2] = {1, 2};
+};
+}
+
+TEST_CASE("test local_derived_stream")
+{
+	using namespace simple_hierarchy;
+
+	// prepare tags for objects
+
+	auto tag_base = 9;
+	auto tag_d1 = std::string("derived1");
+	auto tag_d11 = 6.1f;
+	auto tag_d12 = short(11);
+	auto tag_d2 = 3.14;
+
+	auto s = local_derived_stream<base>();
+
+	SECTION("test if objects are replayed in order")
+	{
+		s.emplace_back<base>(tag_base);
+		s.emplace_back<derived1>(tag_d1);
+		s.push_back(derived11(tag_d11));
+		auto d12 = derived12(tag_d12);
+		s.push_back(d12);
+		s.emplace_back<derived2>(tag_d2);
+
+		REQUIRE(s.size() == 5);
+
+		auto messages = std::vector<std::string>();
+		for (auto& x : s)
+			messages.push_back(x.message());
+
+		REQUIRE(messages.size() == 5);
+		REQUIRE(messages[0] == base::expected_message(tag_base));
+		REQUIRE(messages[1] == derived1::expected_message(tag_d1));
+		REQUIRE(messages[2] == derived11::expected_message(tag_d11));
+		REQUIRE(messages[3] == derived12::expected_message(tag_d12));
+		REQUIRE(messages[4] == derived2::expected_message(tag_d2));
+	}
+
+	SECTION("test if objects are packed at their own size")
+	{
+		s.emplace_back<base>(tag_base);
+		s.emplace_back<derived2>(tag_d2);
+
+		REQUIRE(s.bytes_used() < 2 * (sizeof(derived1) + 16));
+	}
+
+	SECTION("test spanning and reusing chunks")
+	{
+		auto small = local_derived_stream<base>(256);
+
+		for (int i = 0; i < 100; ++i)
+			small.emplace_back<base>(i);
+
+		auto i = 0;
+		for (auto& x : small)
+			REQUIRE(x.message() == base::expected_message(i++));
+		REQUIRE(i == 100);
+
+		i = 0;
+		small.for_each([&](base& x) {
+			REQUIRE(x.message() == base::expected_message(i++));
+		});
+		REQUIRE(i == 100);
+
+		small.clear();
+		REQUIRE(small.empty());
+		REQUIRE(small.begin() == small.end());
+
+		small.emplace_back<derived2>(tag_d2);
+		REQUIRE(small.begin()->message() == derived2::expected_message(tag_d2));
+		REQUIRE(++small.begin() == small.end());
+	}
+
+	SECTION("test records larger than a reused chunk")
+	{
+		auto small = local_derived_stream<base>(256);
+
+		for (int i = 0; i < 20; ++i)
+			small.emplace_back<base>(i);
+		small.clear();
+
+		// the first chunk was reused and is too small for these
+		auto& a = small.emplace_back<large>(1);
+		auto& b = small.emplace_back<large>(2);
+		small.emplace_back<base>(3);
+
+		REQUIRE(a.payload[999] == 1);
+		REQUIRE(b.payload[999] == 2);
+
+		auto messages = std::vector<std::string>();
+		for (auto& x : small)
+			messages.push_back(x.message());
+
+		REQUIRE(messages.size() == 3);
+		REQUIRE(messages[0] == base::expected_message(1));
+		REQUIRE(messages[1] == base::expected_message(2));
+		REQUIRE(messages[2] == base::expected_message(3));
+	}
+
+	SECTION("test if objects are aligned after smaller records")
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			s.emplace_back<padded>(i);
+			auto& x = s.emplace_back<aligned16>(i);
+			REQUIRE(reinterpret_cast<uintptr_t>(&x) % 16 == 0);
+		}
+
+		auto i = 0;
+		s.for_each([&](base& x) {
+			REQUIRE(x.message() == base::expected_message(i++ / 2));
+		});
+		REQUIRE(i == 8);
+	}
+
+	SECTION("test if clear and the destructor destroy objects")
+	{
+		auto destroyed = 0;
+
+		{
+			auto other = local_derived_stream<base>();
+			other.emplace_back<counted>(1, destroyed);
+			other.emplace_back<base>(2);
+			other.emplace_back<counted>(3, destroyed);
+
+			other.clear();
+			REQUIRE(destroyed == 2);
+
+			other.emplace_back<counted>(4, destroyed);
+
+			auto moved = std::move(other);
+			REQUIRE(moved.size() == 1);
+			REQUIRE(other.empty());
+		}
+
+		REQUIRE(destroyed == 3);
+	}
+}
@@ -0,0 +1,164 @@
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "catch.hpp"
+#include "local_function.h"
+
+namespace
+{
+// Counts live instances.
+struct counted
+{
+	counted(int& live) : live(&live)
+	{
+		++*this->live;
+	}
+
+	counted(counted&& other) : live(other.live)
+	{
+		++*live;
+	}
+
+	~counted()
+	{
+		--*live;
+	}
+
+	int operator()(int x) const
+	{
+		return x + 1;
+	}
+
+	int* live;
+};
+
+int twice(int x)
+{
+	return 2 * x;
+}
+}
+
+TEST_CASE("local_function calls the stored callable")
+{
+	SECTION("lambda with captures")
+	{
+		auto k = 3;
+		local_function<int(int), 32> f = [k](int x) { return k * x; };
+
+		REQUIRE(f);
+		REQUIRE(f(2) == 6);
+	}
+
+	SECTION("function pointer")
+	{
+		local_function<int(int), 32> f = &twice;
+		REQUIRE(f(4) == 8);
+	}
+
+	SECTION("mutable state")
+	{
+		local_function<int(), 32> f = [n = 0]() mutable { return ++n; };
+		f();
+		REQUIRE(f() == 2);
+	}
+
+	SECTION("const signature")
+	{
+		const local_function<std::string(const std::string&) const, 64> f =
+		    [s = std::string("a")](const std::string& t) { return s + t; };
+
+		REQUIRE(f("b") == "ab");
+	}
+
+	SECTION("void result discards the value")
+	{
+		auto called = 0;
+		local_function<void(), 32> f = [&] { return ++called; };
+		f();
+		REQUIRE(called == 1);
+	}
+
+	SECTION("move-only callable and arguments")
+	{
+		auto p = std::make_unique<int>(5);
+		local_function<int(std::unique_ptr<int>), 32> f =
+		    [p = std::move(p)](std::unique_ptr<int> q) { return *p + *q; };
+
+		REQUIRE(f(std::make_unique<int>(1)) == 6);
+	}
+
+	SECTION("reference arguments")
+	{
+		local_function<void(int&), 16> f = [](int& x) { x = 7; };
+		auto x = 0;
+		f(x);
+		REQUIRE(x == 7);
+	}
+}
+
+TEST_CASE("empty local_function")
+{
+	local_function<int(int), 32> f;
+	REQUIRE(!f);
+	REQUIRE_THROWS_AS(f(1), const std::bad_function_call&);
+
+	local_function<int(int), 32> g = nullptr;
+	REQUIRE(!g);
+}
+
+TEST_CASE("local_function moves and destroys the callable")
+{
+	auto live = 0;
+
+	{
+		local_function<int(int) const, 16> f = counted(live);
+		REQUIRE(live == 1);
+
+		SECTION("move construction empties the source")
+		{
+			auto g = std::move(f);
+			REQUIRE(live == 1);
+			REQUIRE(!f);
+			REQUIRE(g(1) == 2);
+		}
+
+		SECTION("move assignment destroys the old callable")
+		{
+			local_function<int(int) const, 16> g = counted(live);
+			REQUIRE(live == 2);
+			g = std::move(f);
+			REQUIRE(live == 1);
+			REQUIRE(g(2) == 3);
+		}
+
+		SECTION("reset")
+		{
+			f.reset();
+			REQUIRE(live == 0);
+			REQUIRE(!f);
+		}
+
+		SECTION("swap")
+		{
+			local_function<int(int) const, 16> g = [](int x) { return -x; };
+			f.swap(g);
+			REQUIRE(f(1) == -1);
+			REQUIRE(g(1) == 2);
+			REQUIRE(live == 1);
+
+			f.swap(f);
+			REQUIRE(f(1) == -1);
+		}
+	}
+
+	REQUIRE(live == 0);
+}
+
+TEST_CASE("local_function is move-only")
+{
+	using function = local_function<void(), 32>;
+
+	REQUIRE(!std::is_copy_constructible<function>::value);
+	REQUIRE(std::is_nothrow_move_constructible<function>::value);
+}
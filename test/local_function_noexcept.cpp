@@ -0,0 +1,69 @@
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "catch.hpp"
+#include "local_function.h"
+
+// Built as C++17, where noexcept is part of the function type.
+
+static_assert(!std::is_same<local_function<int(int) noexcept, 32>,
+                            local_function<int(int), 32>>::value,
+              "noexcept signatures select their own specialization");
+
+TEST_CASE("local_function with a noexcept signature")
+{
+	SECTION("calls are noexcept")
+	{
+		auto k = 3;
+		local_function<int(int) noexcept, 32> f = [k](int x) noexcept {
+			return k * x;
+		};
+
+		static_assert(noexcept(f(1)), "call must be noexcept");
+		REQUIRE(f);
+		REQUIRE(f(2) == 6);
+	}
+
+	SECTION("const noexcept")
+	{
+		const local_function<std::string(const std::string&) const noexcept, 64> f =
+		    [s = std::string("a")](const std::string& t) noexcept { return s + t; };
+
+		static_assert(noexcept(f(std::string())), "call must be noexcept");
+		REQUIRE(f("b") == "ab");
+	}
+
+	SECTION("mutable state, moved")
+	{
+		local_function<int() noexcept, 32> f = [n = 0]() mutable noexcept {
+			return ++n;
+		};
+		f();
+
+		auto g = std::move(f);
+		REQUIRE_FALSE(f);
+		REQUIRE(g() == 2);
+
+		g = nullptr;
+		REQUIRE_FALSE(g);
+	}
+
+	SECTION("noexcept function pointer")
+	{
+		local_function<long(int) noexcept, 32> f = +[](int x) noexcept {
+			return x + 1;
+		};
+
+		REQUIRE(f(1) == 2);
+	}
+
+	SECTION("move-only callable")
+	{
+		auto p = std::make_unique<int>(5);
+		local_function<int(int) const noexcept, 32> f =
+		    [p = std::move(p)](int x) noexcept { return *p + x; };
+
+		REQUIRE(f(1) == 6);
+	}
+}
@@ -0,0 +1,157 @@
+#include <memory>
+#include <string>
+#include <type_traits>
+#include "catch.hpp"
+#include "local_result.h"
+
+namespace
+{
+class error
+{
+public:
+	virtual ~error()
+	{
+	}
+
+	virtual std::string message() const = 0;
+};
+
+class not_found final : public error
+{
+public:
+	explicit not_found(std::string key) : key(std::move(key))
+	{
+	}
+
+	std::string message() const override
+	{
+		return "not found: " + key;
+	}
+
+private:
+	std::string key;
+};
+
+class out_of_range final : public error
+{
+public:
+	out_of_range(int value, int limit) : value(value), limit(limit)
+	{
+	}
+
+	std::string message() const override
+	{
+		return std::to_string(value) + " > " + std::to_string(limit);
+	}
+
+private:
+	int value;
+	int limit;
+};
+
+template <class T>
+using result = local_result<T, error, 48>;
+
+// Has a move constructor that may throw.
+struct fragile
+{
+	fragile() = default;
+
+	fragile(fragile&&) noexcept(false)
+	{
+	}
+};
+
+static_assert(std::is_nothrow_move_constructible<result<std::string>>::value &&
+                  std::is_nothrow_move_assignable<result<std::string>>::value,
+              "moves are noexcept when T's are");
+static_assert(!std::is_nothrow_move_constructible<result<fragile>>::value,
+              "moves may throw when T's may");
+
+result<int> parse(const std::string& s)
+{
+	if (s.empty())
+		return result<int>(emplace_tag_t<not_found>(), "digits");
+
+	const auto v = std::stoi(s);
+	if (v > 100)
+		return out_of_range(v, 100);
+
+	return v;
+}
+
+// Passes an error on, with another value type.
+result<std::string> describe(const std::string& s)
+{
+	auto r = parse(s);
+	if (!r)
+		return std::move(r).error();
+
+	return "value " + std::to_string(*r);
+}
+}
+
+TEST_CASE("test local_result")
+{
+	SECTION("holds a value")
+	{
+		auto r = parse("42");
+		REQUIRE(r);
+		REQUIRE(r.has_value());
+		REQUIRE(r.value() == 42);
+		REQUIRE(*r == 42);
+		REQUIRE(r.value_or(0) == 42);
+	}
+
+	SECTION("holds an error in-place")
+	{
+		auto r = parse("");
+		REQUIRE_FALSE(r);
+		REQUIRE(r.has_error<not_found>());
+		REQUIRE_FALSE(r.has_error<out_of_range>());
+		REQUIRE(r.error()->message() == "not found: digits");
+		REQUIRE(r.value_or(-1) == -1);
+
+		auto s = parse("200");
+		REQUIRE(s.has_error<out_of_range>());
+		REQUIRE(s.error()->message() == "200 > 100");
+	}
+
+	SECTION("passes errors on")
+	{
+		auto ok = describe("7");
+		REQUIRE(ok);
+		REQUIRE(ok->size() == 7);
+		REQUIRE(*ok == "value 7");
+
+		auto failed = describe("101");
+		REQUIRE_FALSE(failed);
+		REQUIRE(failed.has_error<out_of_range>());
+		REQUIRE(failed.error()->message() == "101 > 100");
+	}
+
+	SECTION("move and assign")
+	{
+		auto a = result<std::unique_ptr<int>>(std::make_unique<int>(5));
+		auto b = std::move(a);
+		REQUIRE(b);
+		REQUIRE(**b == 5);
+
+		b = result<std::unique_ptr<int>>(not_found("key"));
+		REQUIRE(b.has_error<not_found>());
+
+		auto c = result<std::unique_ptr<int>>(value_tag_t(), new int(3));
+		c = std::move(b);
+		REQUIRE(c.has_error<not_found>());
+		REQUIRE(c.error()->message() == "not found: key");
+
+		auto v = std::move(result<std::unique_ptr<int>>(
+		                       value_tag_t(), new int(9)))
+		             .value();
+		REQUIRE(*v == 9);
+
+		auto f = result<fragile>(value_tag_t());
+		auto g = std::move(f);
+		REQUIRE(g);
+	}
+}
@@ -0,0 +1,212 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "node_arena.h"
+
+namespace
+{
+class expr;
+
+using arena = node_arena<expr, 32>;
+
+class expr
+{
+public:
+	virtual ~expr()
+	{
+	}
+
+	// Evaluates recursively, through the arena.
+	virtual double eval(const arena& a, arena::index_type self) const = 0;
+
+	// Evaluates from the values of the children.
+	virtual double apply(child_values<double> c) const = 0;
+};
+
+class constant final : public expr
+{
+public:
+	explicit constant(double v) : v(v)
+	{
+	}
+
+	double eval(const arena&, arena::index_type) const override
+	{
+		return v;
+	}
+
+	double apply(child_values<double>) const override
+	{
+		return v;
+	}
+
+private:
+	double v;
+};
+
+class sum final : public expr
+{
+public:
+	double eval(const arena& a, arena::index_type self) const override
+	{
+		auto s = 0.0;
+		for (auto c : a.children(self))
+			s += a[c].eval(a, c);
+		return s;
+	}
+
+	double apply(child_values<double> c) const override
+	{
+		auto s = 0.0;
+		for (size_t i = 0; i < c.size(); ++i)
+			s += c[i];
+		return s;
+	}
+};
+
+class product final : public expr
+{
+public:
+	double eval(const arena& a, arena::index_type self) const override
+	{
+		const auto c = a.children(self);
+		return a[c[0]].eval(a, c[0]) * a[c[1]].eval(a, c[1]);
+	}
+
+	double apply(child_values<double> c) const override
+	{
+		return c[0] * c[1];
+	}
+};
+
+// Throws from its constructor.
+class broken final : public expr
+{
+public:
+	broken()
+	{
+		throw std::runtime_error("broken");
+	}
+
+	double eval(const arena&, arena::index_type) const override
+	{
+		return 0;
+	}
+
+	double apply(child_values<double>) const override
+	{
+		return 0;
+	}
+};
+
+double evaluate_all(const arena& a, std::vector<double>& values)
+{
+	a.evaluate(values, [](const expr& e, child_values<double> c) {
+		return e.apply(c);
+	});
+	return values.empty() ? 0.0 : values.back();
+}
+}
+
+TEST_CASE("test node_arena")
+{
+	auto a = arena();
+	auto values = std::vector<double>();
+
+	REQUIRE(a.empty());
+	REQUIRE(a.root() == arena::none);
+
+	SECTION("nodes are laid out after their children")
+	{
+		// (1 + 2 + 3) * 4
+		const auto one = a.add<constant>({}, 1.0);
+		const auto two = a.add<constant>({}, 2.0);
+		const auto three = a.add<constant>({}, 3.0);
+		const auto s = a.add<sum>({one, two, three});
+		const auto four = a.add<constant>({}, 4.0);
+		const auto p = a.add<product>({s, four});
+
+		REQUIRE(a.size() == 6);
+		REQUIRE(a.link_count() == 5);
+		REQUIRE(a.root() == p);
+
+		REQUIRE(a.children(one).size() == 0);
+		REQUIRE(a.children(s).size() == 3);
+		REQUIRE(a.children(s)[2] == three);
+		REQUIRE(a.children(p)[0] == s);
+		REQUIRE(a.children(p)[1] == four);
+
+		REQUIRE(a.slot(s).holds<sum>());
+		REQUIRE(a.slot(p).holds<product>());
+
+		SECTION("evaluate recursively")
+		{
+			REQUIRE(a[p].eval(a, p) == 24.0);
+			REQUIRE(a[s].eval(a, s) == 6.0);
+		}
+
+		SECTION("evaluate in one pass")
+		{
+			REQUIRE(evaluate_all(a, values) == 24.0);
+			REQUIRE(values.size() == 6);
+			REQUIRE(values[s] == 6.0);
+		}
+
+		SECTION("clear and reuse")
+		{
+			a.clear();
+			REQUIRE(a.empty());
+			REQUIRE(a.link_count() == 0);
+
+			const auto five = a.add<constant>({}, 5.0);
+			REQUIRE(five == 0);
+			REQUIRE(a.children(five).size() == 0);
+			REQUIRE(evaluate_all(a, values) == 5.0);
+		}
+	}
+
+	SECTION("children may be shared")
+	{
+		// x * x, with x = 3 + 4
+		const auto three = a.add<constant>({}, 3.0);
+		const auto four = a.add<constant>({}, 4.0);
+		const auto x = a.add<sum>({three, four});
+		const auto square = a.add<product>({x, x});
+
+		REQUIRE(a[square].eval(a, square) == 49.0);
+		REQUIRE(evaluate_all(a, values) == 49.0);
+	}
+
+	SECTION("a failed add leaves the arena unchanged")
+	{
+		const auto one = a.add<constant>({}, 1.0);
+		const auto two = a.add<constant>({}, 2.0);
+
+		REQUIRE_THROWS_AS(a.add<sum>({one, 2}), const std::out_of_range&);
+		REQUIRE_THROWS_AS(a.add<broken>({one, two}), const std::runtime_error&);
+
+		REQUIRE(a.size() == 2);
+		REQUIRE(a.link_count() == 0);
+
+		const auto s = a.add<sum>({one, two});
+		REQUIRE(a.children(s).size() == 2);
+		REQUIRE(evaluate_all(a, values) == 3.0);
+	}
+
+	SECTION("nodes survive growing the arena")
+	{
+		a.reserve(2, 1);
+
+		auto last = a.add<constant>({}, 1.0);
+		for (int i = 0; i < 1000; ++i)
+		{
+			const auto one = a.add<constant>({}, 1.0);
+			last = a.add<sum>({last, one});
+		}
+
+		REQUIRE(a.size() == 2001);
+		REQUIRE(a[last].eval(a, last) == 1001.0);
+		REQUIRE(evaluate_all(a, values) == 1001.0);
+	}
+}
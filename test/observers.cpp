@@ -65,5 +65,16 @@ TEST_CASE("test observers")
 			REQUIRE(d21->message() == derived21::expected_message(tag_d21));
 			REQUIRE(d22->message() == derived22::expected_message(tag_d22));
 		}
+
+		SECTION("test if the proper depth is retrieved by a virtual call")
+		{
+			REQUIRE(b->depth() == 0);
+			REQUIRE(d1->depth() == 1);
+			REQUIRE(d11->depth() == 2);
+			REQUIRE(d12->depth() == 2);
+			REQUIRE(d2->depth() == 1);
+			REQUIRE(d21->depth() == 2);
+			REQUIRE(d22->depth() == 2);
+		}
 	}
 }
\ No newline at end of file
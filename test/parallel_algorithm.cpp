@@ -0,0 +1,234 @@
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "catch.hpp"
+#include "local_derived.h"
+#include "parallel_algorithm.h"
+
+namespace
+{
+class shape
+{
+public:
+	virtual ~shape()
+	{
+	}
+
+	virtual double area() const = 0;
+	virtual void scale(double k) = 0;
+};
+
+class square final : public shape
+{
+public:
+	explicit square(double side) : side(side)
+	{
+	}
+
+	double area() const override
+	{
+		return side * side;
+	}
+
+	void scale(double k) override
+	{
+		side *= k;
+	}
+
+	// Counts the squares in each run, for the batched variant.
+	static void process_batch(batch_view<square> run, std::atomic<int>& count)
+	{
+		count += static_cast<int>(run.size());
+	}
+
+private:
+	double side;
+};
+
+class circle final : public shape
+{
+public:
+	explicit circle(double r) : r(r)
+	{
+	}
+
+	double area() const override
+	{
+		return 3.14159 * r * r;
+	}
+
+	void scale(double k) override
+	{
+		r *= k;
+	}
+
+private:
+	double r;
+};
+
+class triangle final : public shape
+{
+public:
+	triangle(double b, double h) : b(b), h(h)
+	{
+	}
+
+	double area() const override
+	{
+		return b * h / 2;
+	}
+
+	void scale(double k) override
+	{
+		b *= k;
+		h *= k;
+	}
+
+private:
+	double b, h;
+};
+
+using ld = local_derived<shape, sizeof(triangle)>;
+
+// Several chunks' worth of shapes, the types interleaved.
+std::vector<ld> make_shapes(size_t n)
+{
+	auto v = std::vector<ld>();
+	v.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		const auto x = 0.1 + static_cast<double>(i % 97) / 7;
+		if (i % 3 == 0)
+			v.emplace_back(emplace_tag_t<square>(), x);
+		else if (i % 3 == 1)
+			v.emplace_back(emplace_tag_t<circle>(), x);
+		else
+			v.emplace_back(emplace_tag_t<triangle>(), x, x + 1);
+	}
+	return v;
+}
+
+double total_area(thread_pool& pool, const std::vector<ld>& v)
+{
+	return parallel::transform_reduce(
+	    pool, v.begin(), v.end(), 0.0, [](double a, double b) { return a + b; },
+	    [](const ld& x) { return x->area(); });
+}
+}
+
+TEST_CASE("test parallel algorithms")
+{
+	const auto n = 5 * parallel_chunk_size<ld>() + 123;
+
+	thread_pool one(1);
+	thread_pool four(4);
+
+	SECTION("chunks span whole cache lines")
+	{
+		REQUIRE(parallel_chunk_size<ld>() * sizeof(ld) % 64 == 0);
+		REQUIRE(parallel_chunk_size<char[24]>() * 24 % 64 == 0);
+		REQUIRE(parallel_chunk_size<char[64 * 1024]>() == 1);
+	}
+
+	SECTION("the pool runs every task once")
+	{
+		auto hits = std::vector<std::atomic<int>>(1000);
+		for (auto& h : hits)
+			h = 0;
+
+		for (int round = 0; round < 10; ++round)
+			four.run(hits.size(), [&](size_t i) { ++hits[i]; });
+
+		for (auto& h : hits)
+			REQUIRE(h == 10);
+		REQUIRE(four.size() == 4);
+	}
+
+	SECTION("for_each")
+	{
+		auto v = make_shapes(n);
+		const auto before = total_area(one, v);
+
+		parallel::for_each(four, v.begin(), v.end(),
+		                   [](ld& x) { x->scale(2.0); });
+
+		REQUIRE(total_area(one, v) == Approx(before * 4));
+	}
+
+	SECTION("transform_reduce is deterministic")
+	{
+		const auto v = make_shapes(n);
+
+		auto sequential = 0.0;
+		for (auto& x : v)
+			sequential += x->area();
+
+		const auto a = total_area(one, v);
+		const auto b = total_area(four, v);
+
+		REQUIRE(a == Approx(sequential));
+
+		// bitwise equal, whatever the number of threads
+		REQUIRE(std::memcmp(&a, &b, sizeof(a)) == 0);
+		for (int i = 0; i < 5; ++i)
+			REQUIRE(total_area(four, v) == a);
+
+		// an empty range reduces to init
+		REQUIRE(parallel::transform_reduce(
+		            four, v.end(), v.end(), 1.5,
+		            [](double x, double y) { return x + y; },
+		            [](const ld& x) { return x->area(); }) == 1.5);
+	}
+
+	SECTION("count_if")
+	{
+		const auto v = make_shapes(n);
+
+		REQUIRE(parallel::count_if(four, v.begin(), v.end(), [](const ld& x) {
+			        return x.holds<circle>();
+		        }) == (n + 1) / 3);
+		REQUIRE(parallel::count_if(one, v.begin(), v.end(),
+		                           [](const ld&) { return true; }) == n);
+	}
+
+	SECTION("group_by_type and for_each_batched")
+	{
+		auto v = make_shapes(n);
+		const auto before = total_area(one, v);
+
+		parallel::group_by_type<circle, square>(v.begin(), v.end());
+
+		const auto circles = (n + 1) / 3;
+		const auto squares = (n + 2) / 3;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (i < circles)
+				REQUIRE(v[i].holds<circle>());
+			else if (i < circles + squares)
+				REQUIRE(v[i].holds<square>());
+			else
+				REQUIRE(v[i].holds<triangle>());
+		}
+		REQUIRE(total_area(one, v) == Approx(before));
+
+		std::atomic<int> batched(0);
+		std::atomic<int> others(0);
+		parallel::for_each_batched<square>(
+		    four, v.begin(), v.end(),
+		    [&](shape&, std::atomic<int>&) { ++others; }, batched);
+
+		REQUIRE(batched == static_cast<int>(squares));
+		REQUIRE(others == static_cast<int>(n - squares));
+	}
+
+	SECTION("empty ranges")
+	{
+		auto v = std::vector<ld>();
+
+		parallel::group_by_type<circle, square>(v.begin(), v.end());
+		parallel::for_each(four, v.begin(), v.end(), [](ld& x) { x->scale(2); });
+		REQUIRE(parallel::count_if(four, v.begin(), v.end(),
+		                           [](const ld&) { return true; }) == 0);
+		REQUIRE(total_area(four, v) == 0.0);
+	}
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "local_derived.h"
+#include "local_derived_algorithm.h"
+
+namespace
+{
+int live = 0;
+
+class item
+{
+public:
+	virtual ~item()
+	{
+	}
+
+	virtual int key() const = 0;
+};
+
+// Relocated with memcpy.
+class plain final : public item
+{
+public:
+	explicit plain(int k) : k(k)
+	{
+	}
+
+	int key() const override
+	{
+		return k;
+	}
+
+private:
+	int k;
+};
+
+// Relocated with its move constructor; counts live objects.
+class named final : public item
+{
+public:
+	explicit named(int k) : k(k), name(std::to_string(k))
+	{
+		++live;
+	}
+
+	named(named&& other) : k(other.k), name(std::move(other.name))
+	{
+		++live;
+	}
+
+	~named() override
+	{
+		--live;
+	}
+
+	int key() const override
+	{
+		return std::stoi(name) == k ? k : -1;
+	}
+
+private:
+	int k;
+	std::string name;
+};
+}
+
+template <>
+struct is_trivially_relocatable<plain> : std::true_type
+{
+};
+
+namespace
+{
+using ld = local_derived<item, sizeof(named)>;
+
+// Objects with keys 0 to n-1, mixing both kinds in runs.
+std::vector<ld> make_items(int n)
+{
+	auto v = std::vector<ld>();
+	v.reserve(static_cast<size_t>(n));
+	for (int i = 0; i < n; ++i)
+	{
+		if (i % 5 < 3)
+			v.emplace_back(emplace_tag_t<plain>(), i);
+		else
+			v.emplace_back(emplace_tag_t<named>(), i);
+	}
+	return v;
+}
+
+std::vector<int> keys(const std::vector<ld>& v)
+{
+	auto out = std::vector<int>();
+	for (auto& x : v)
+		out.push_back(x->key());
+	return out;
+}
+
+std::vector<int> iota(int n)
+{
+	auto out = std::vector<int>(static_cast<size_t>(n));
+	for (int i = 0; i < n; ++i)
+		out[static_cast<size_t>(i)] = i;
+	return out;
+}
+
+bool odd(const ld& x)
+{
+	return x->key() % 2 != 0;
+}
+
+struct failure
+{
+};
+
+// odd, but throws on the call after the first calls.
+struct odd_until
+{
+	int calls;
+
+	bool operator()(const ld& x)
+	{
+		if (calls-- == 0)
+			throw failure();
+		return odd(x);
+	}
+};
+
+// Every key is still held once.
+bool all_held(const std::vector<ld>& v, int n)
+{
+	auto k = keys(v);
+	std::sort(k.begin(), k.end());
+	return k == iota(n);
+}
+}
+
+TEST_CASE("test relocating algorithms")
+{
+	live = 0;
+	const auto n = 23;
+
+	SECTION("relocation is bitwise only for opted-in types")
+	{
+		auto v = make_items(n);
+		REQUIRE(v[0].trivially_relocatable());
+		REQUIRE_FALSE(v[3].trivially_relocatable());
+	}
+
+	SECTION("rotate")
+	{
+		for (int k : {0, 1, 4, 11, 19, 22, 23})
+		{
+			auto v = make_items(n);
+			auto expected = iota(n);
+
+			const auto it = relocating::rotate(v.begin(), v.begin() + k, v.end());
+			const auto e =
+			    std::rotate(expected.begin(), expected.begin() + k, expected.end());
+
+			REQUIRE(keys(v) == expected);
+			REQUIRE(it - v.begin() == e - expected.begin());
+		}
+	}
+
+	SECTION("partition")
+	{
+		auto v = make_items(n);
+
+		const auto mid = relocating::partition(v.begin(), v.end(), odd);
+		REQUIRE(mid - v.begin() == 11);
+		REQUIRE(std::all_of(v.begin(), mid, odd));
+		REQUIRE(std::none_of(mid, v.end(), odd));
+
+		auto k = keys(v);
+		std::sort(k.begin(), k.end());
+		REQUIRE(k == iota(n));
+	}
+
+	SECTION("stable_partition")
+	{
+		auto v = make_items(n);
+		auto expected = iota(n);
+
+		const auto mid = relocating::stable_partition(v.begin(), v.end(), odd);
+		std::stable_partition(expected.begin(), expected.end(),
+		                      [](int k) { return k % 2 != 0; });
+
+		REQUIRE(mid - v.begin() == 11);
+		REQUIRE(keys(v) == expected);
+	}
+
+	SECTION("sort_by")
+	{
+		auto v = make_items(n);
+		relocating::rotate(v.begin(), v.begin() + 7, v.end());
+		std::reverse(v.begin(), v.begin() + 10);
+
+		relocating::sort_by(v.begin(), v.end(),
+		                    [](const ld& x) { return (x->key() * 7) % n; });
+
+		auto expected = iota(n);
+		std::sort(expected.begin(), expected.end(), [&](int a, int b) {
+			return (a * 7) % n < (b * 7) % n;
+		});
+		REQUIRE(keys(v) == expected);
+	}
+
+	SECTION("erase_if")
+	{
+		auto v = make_items(n);
+		const auto before = live;
+
+		REQUIRE(relocating::erase_if(v, odd) == 11);
+		REQUIRE(v.size() == 12);
+
+		auto expected = iota(n);
+		expected.erase(std::remove_if(expected.begin(), expected.end(),
+		                              [](int k) { return k % 2 != 0; }),
+		               expected.end());
+		REQUIRE(keys(v) == expected);
+
+		// erased objects were destroyed once
+		REQUIRE(live == before - 4);
+
+		REQUIRE(relocating::erase_if(v, odd) == 0);
+		REQUIRE(v.size() == 12);
+	}
+
+	SECTION("empty ranges")
+	{
+		auto v = std::vector<ld>();
+
+		REQUIRE(relocating::rotate(v.begin(), v.begin(), v.end()) == v.end());
+		REQUIRE(relocating::partition(v.begin(), v.end(), odd) == v.end());
+		REQUIRE(relocating::stable_partition(v.begin(), v.end(), odd) ==
+		        v.end());
+		relocating::sort_by(v.begin(), v.end(),
+		                    [](const ld& x) { return x->key(); });
+		REQUIRE(relocating::erase_if(v, odd) == 0);
+		REQUIRE(v.empty());
+	}
+
+	SECTION("all objects accepted or erased")
+	{
+		auto v = make_items(n);
+		const auto all = [](const ld&) { return true; };
+
+		REQUIRE(relocating::stable_partition(v.begin(), v.end(), all) ==
+		        v.end());
+		REQUIRE(keys(v) == iota(n));
+
+		REQUIRE(relocating::erase_if(v, all) == static_cast<size_t>(n));
+		REQUIRE(v.empty());
+	}
+
+	SECTION("a throwing predicate leaves every object in the range")
+	{
+		for (int calls : {0, 1, 5, 12, 20})
+		{
+			auto v = make_items(n);
+			REQUIRE_THROWS_AS(
+			    relocating::partition(v.begin(), v.end(), odd_until{calls}),
+			    const failure&);
+			REQUIRE(all_held(v, n));
+
+			REQUIRE_THROWS_AS(relocating::stable_partition(v.begin(), v.end(),
+			                                               odd_until{calls}),
+			                  const failure&);
+			REQUIRE(all_held(v, n));
+
+			const auto before = live;
+			REQUIRE_THROWS_AS(relocating::erase_if(v, odd_until{calls}),
+			                  const failure&);
+			REQUIRE(v.size() == static_cast<size_t>(n));
+			REQUIRE(live == before);
+			REQUIRE(all_held(v, n));
+		}
+	}
+
+	SECTION("uninitialized_relocate_n")
+	{
+		auto v = make_items(n);
+		local_derived_internal::raw_slot<ld> storage[n];
+		auto* out = reinterpret_cast<ld*>(storage);
+
+		REQUIRE(relocating::uninitialized_relocate_n(v.data(), n, out) ==
+		        out + n);
+		for (int i = 0; i < n; ++i)
+			REQUIRE(out[i]->key() == i);
+
+		// give the objects back, so v destroys them
+		relocating::uninitialized_relocate_n(out, n, v.data());
+		REQUIRE(keys(v) == iota(n));
+	}
+
+	REQUIRE(live == 0);
+}
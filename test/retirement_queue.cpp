@@ -0,0 +1,120 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include "catch.hpp"
+#include "retirement_queue.h"
+
+namespace
+{
+std::atomic<int> destroyed(0);
+
+class resource
+{
+public:
+	virtual ~resource()
+	{
+	}
+};
+
+// Counts the destruction of objects that weren't moved from.
+class session final : public resource
+{
+public:
+	explicit session(std::string name) : name(std::move(name))
+	{
+	}
+
+	session(session&& other) : name(std::move(other.name)), owner(other.owner)
+	{
+		other.owner = false;
+	}
+
+	~session() override
+	{
+		if (owner)
+			++destroyed;
+	}
+
+private:
+	std::string name;
+	bool owner = true;
+};
+
+using queue = retirement_queue<resource, 64>;
+using value_type = queue::value_type;
+}
+
+TEST_CASE("test retirement_queue")
+{
+	destroyed = 0;
+
+	SECTION("retire defers destruction until drain")
+	{
+		queue q(4);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			auto d = value_type(emplace_tag_t<session>(), "s");
+			q.retire(std::move(d));
+		}
+		REQUIRE(destroyed == 0);
+		REQUIRE(q.pending() == 3);
+
+		// the batch isn't full yet
+		REQUIRE(q.drain() == 0);
+		REQUIRE(destroyed == 0);
+
+		q.flush();
+		REQUIRE(q.drain() == 3);
+		REQUIRE(destroyed == 3);
+		REQUIRE(q.pending() == 0);
+	}
+
+	SECTION("full batches are handed over")
+	{
+		queue q(4);
+
+		for (int i = 0; i < 10; ++i)
+			q.retire(value_type(emplace_tag_t<session>(), "s"));
+
+		REQUIRE(q.pending() == 10);
+		REQUIRE(q.drain() == 8);
+		REQUIRE(destroyed == 8);
+		REQUIRE(q.pending() == 2);
+
+		// drained batches are reused
+		for (int i = 0; i < 6; ++i)
+			q.retire(value_type(emplace_tag_t<session>(), "s"));
+		REQUIRE(q.drain() == 8);
+		REQUIRE(destroyed == 16);
+	}
+
+	SECTION("the destructor drains the rest")
+	{
+		{
+			queue q(4);
+			for (int i = 0; i < 7; ++i)
+				q.retire(value_type(emplace_tag_t<session>(), "s"));
+			REQUIRE(destroyed == 0);
+		}
+		REQUIRE(destroyed == 7);
+	}
+
+	SECTION("drain on a background thread")
+	{
+		queue q(16);
+		q.start();
+
+		for (int i = 0; i < 1000; ++i)
+			q.retire(value_type(emplace_tag_t<session>(), "s"));
+		q.flush();
+
+		while (q.pending() > 0)
+			std::this_thread::yield();
+		REQUIRE(destroyed == 1000);
+
+		q.stop();
+		q.retire(value_type(emplace_tag_t<session>(), "s"));
+		REQUIRE(q.pending() == 1);
+	}
+}
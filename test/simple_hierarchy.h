@@ -36,6 +36,12 @@ public:
 		return expected_message(tag);
 	}
 
+	// Depth in the hierarchy; a cheap virtual call.
+	virtual int depth() const
+	{
+		return 0;
+	}
+
 private:
 	tag_t tag;
 };
@@ -99,6 +105,11 @@ public:
 		return expected_message(tag);
 	}
 
+	int depth() const override
+	{
+		return BaseClass::depth() + 1;
+	}
+
 private:
 	tag_t tag;
 };
@@ -0,0 +1,126 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "catch.hpp"
+#include "split_local_vector.h"
+#include "simple_hierarchy.h"
+
+namespace
+{
+// The I-th of many distinct types.
+template <size_t I>
+class numbered : public simple_hierarchy::base
+{
+public:
+	numbered() : base(static_cast<int>(I))
+	{
+	}
+};
+
+template <class Vector, size_t... I>
+void emplace_numbered(Vector& v, std::index_sequence<I...>)
+{
+	const int expand[] = {(v.template emplace_back<numbered<I>>(), 0)...};
+	(void)expand;
+}
+}
+
+TEST_CASE("test split_local_vector")
+{
+	using namespace simple_hierarchy;
+
+	// pick the biggest object (you could use a compile-time max)
+
+	const auto S = sizeof(derived21);
+
+	// prepare tags for objects
+
+	auto tag_base = 9;
+	auto tag_d1 = std::string("derived1");
+	auto tag_d11 = 6.1f;
+	auto tag_d2 = 3.14;
+	auto tag_d21 = std::string("derived21");
+
+	auto v = split_local_vector<base, S>();
+
+	v.emplace_back<base>(tag_base);
+	v.emplace_back<derived1>(tag_d1);
+	v.emplace_back<derived11>(tag_d11);
+	v.emplace_back<derived2>(tag_d2);
+	v.emplace_back<derived21>(tag_d21);
+	v.emplace_back<derived11>(tag_d11);
+
+	SECTION("test if the proper tags are retrieved by a virtual call")
+	{
+		REQUIRE(v.size() == 6);
+		REQUIRE(v[0].message() == base::expected_message(tag_base));
+		REQUIRE(v[1].message() == derived1::expected_message(tag_d1));
+		REQUIRE(v[2].message() == derived11::expected_message(tag_d11));
+		REQUIRE(v[3].message() == derived2::expected_message(tag_d2));
+		REQUIRE(v[4].message() == derived21::expected_message(tag_d21));
+	}
+
+	SECTION("test type queries on the keys")
+	{
+		REQUIRE(v.holds<derived1>(1));
+		REQUIRE(!v.holds<derived1>(2));
+		REQUIRE(v.get_if<derived2>(3) == dynamic_cast<derived2*>(v.get(3)));
+		REQUIRE(v.get_if<derived2>(4) == nullptr);
+
+		REQUIRE(v.count_type<derived11>() == 2);
+		REQUIRE(v.count_type<derived22>() == 0);
+
+		auto found = std::vector<size_t>();
+		v.find_all<derived11>(found);
+		REQUIRE(found == std::vector<size_t>({2, 5}));
+	}
+
+	SECTION("test if growth keeps the base pointers valid")
+	{
+		for (int i = 0; i < 100; ++i)
+			v.emplace_back<derived1>(std::to_string(i));
+
+		REQUIRE(v[4].message() == derived21::expected_message(tag_d21));
+		REQUIRE(v[105].message() == derived1::expected_message("99"));
+	}
+
+	SECTION("test swap_remove and pop_back")
+	{
+		v.swap_remove(1);
+		REQUIRE(v.size() == 5);
+		REQUIRE(v[1].message() == derived11::expected_message(tag_d11));
+		REQUIRE(v.holds<derived11>(1));
+
+		v.pop_back();
+		v.swap_remove(4 - 1);
+		REQUIRE(v.size() == 3);
+		REQUIRE(v.count_type<derived2>() == 0);
+		REQUIRE(v[2].message() == derived11::expected_message(tag_d11));
+	}
+
+	SECTION("test moving the vector")
+	{
+		auto moved = std::move(v);
+		REQUIRE(moved.size() == 6);
+		REQUIRE(v.empty());
+		REQUIRE(moved[4].message() == derived21::expected_message(tag_d21));
+	}
+
+	SECTION("test if a 257th type is rejected")
+	{
+		auto many = split_local_vector<base, S>();
+		emplace_numbered(many, std::make_index_sequence<256>());
+		REQUIRE(many.size() == 256);
+
+		REQUIRE_THROWS_AS(many.emplace_back<numbered<256>>(),
+		                  const std::length_error&);
+		REQUIRE(many.size() == 256);
+		REQUIRE(many[0].message() == base::expected_message(0));
+		REQUIRE(many[255].message() == base::expected_message(255));
+
+		// known types can still be added
+		many.emplace_back<numbered<7>>();
+		REQUIRE(many.size() == 257);
+	}
+}
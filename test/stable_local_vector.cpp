@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "stable_local_vector.h"
+#include "simple_hierarchy.h"
+
+TEST_CASE("test stable_local_vector")
+{
+	using namespace simple_hierarchy;
+
+	const auto S = sizeof(derived21);
+
+	using vector = stable_local_vector<base, S>;
+
+	auto v = vector();
+
+	// 3 chunks, alternating types
+	auto pointers = std::vector<base*>();
+	for (int i = 0; i < 150; ++i)
+	{
+		if (i % 2)
+			pointers.push_back(v.emplace<derived2>(double(i))->get());
+		else
+			pointers.push_back(v.emplace<base>(i)->get());
+	}
+
+	SECTION("test if addresses are stable on growth")
+	{
+		REQUIRE(v.size() == 150);
+		REQUIRE(v.chunk_count() == 3);
+
+		for (int i = 0; i < 150; ++i)
+		{
+			if (i % 2)
+				REQUIRE(pointers[i]->message() == derived2::expected_message(i));
+			else
+				REQUIRE(pointers[i]->message() == base::expected_message(i));
+		}
+	}
+
+	SECTION("test if chunks are cache line aligned")
+	{
+		REQUIRE(vector::chunk_alignment % 64 == 0);
+
+		const auto first = reinterpret_cast<uintptr_t>(&*v.begin());
+		REQUIRE(first % vector::chunk_alignment == 0);
+	}
+
+	SECTION("test if iteration visits elements in slot order")
+	{
+		auto i = 0;
+		for (auto& x : v)
+		{
+			REQUIRE(x.get() == pointers[i]);
+			++i;
+		}
+		REQUIRE(i == 150);
+	}
+
+	SECTION("test if erase leaves holes that iteration skips")
+	{
+		auto it = v.begin();
+		for (int i = 0; it != v.end(); ++i)
+		{
+			if (i % 3 == 0 || (i >= 64 && i < 128))
+				it = v.erase(it);
+			else
+				++it;
+		}
+
+		REQUIRE(v.size() == 57);
+		REQUIRE(v.chunk_occupancy(1) == 0);
+
+		auto n = size_t(0);
+		for (const auto& x : v)
+		{
+			REQUIRE(x->depth() >= 0);
+			++n;
+		}
+		REQUIRE(n == v.size());
+
+		// untouched elements keep their addresses
+		REQUIRE(pointers[1]->message() == derived2::expected_message(1));
+		REQUIRE(pointers[149]->message() == derived2::expected_message(149));
+	}
+
+	SECTION("test if holes are reused before new chunks")
+	{
+		auto it = v.begin();
+		++it;
+		const auto hole = &*it;
+
+		v.erase(it);
+		REQUIRE(v.size() == 149);
+
+		auto again = v.emplace<derived1>("x");
+		REQUIRE(&*again == hole);
+		REQUIRE(v.chunk_count() == 3);
+		REQUIRE(again->get()->message() == derived1::expected_message("x"));
+	}
+
+	SECTION("test clear keeps the chunks")
+	{
+		v.clear();
+		REQUIRE(v.empty());
+		REQUIRE(v.begin() == v.end());
+		REQUIRE(v.capacity() == 3 * vector::chunk_slots);
+
+		v.emplace<derived21>("y");
+		REQUIRE(v.size() == 1);
+		REQUIRE(v.chunk_count() == 3);
+	}
+
+	SECTION("test reserve")
+	{
+		v.reserve(1000);
+		REQUIRE(v.capacity() >= 1000);
+		REQUIRE(pointers[0]->message() == base::expected_message(0));
+	}
+}
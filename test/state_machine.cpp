@@ -0,0 +1,187 @@
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "local_state_machine.h"
+
+namespace
+{
+// Recognizes commands like "$name;" and reports each name.
+class state
+{
+public:
+	virtual ~state()
+	{
+	}
+
+	virtual state_transition on_event(const char& c) = 0;
+};
+
+std::vector<std::string> commands;
+int live = 0;
+
+class idle final : public state
+{
+public:
+	idle()
+	{
+		++live;
+	}
+
+	~idle() override
+	{
+		--live;
+	}
+
+	state_transition on_event(const char& c) override;
+};
+
+class command final : public state
+{
+public:
+	// constructed from the event that entered it
+	explicit command(const char& c) : first(c)
+	{
+		++live;
+	}
+
+	~command() override
+	{
+		--live;
+	}
+
+	state_transition on_event(const char& c) override;
+
+private:
+	char first;
+	std::string name;
+};
+
+class failed final : public state
+{
+public:
+	explicit failed(std::string reason) : reason(std::move(reason))
+	{
+		++live;
+	}
+
+	~failed() override
+	{
+		--live;
+	}
+
+	state_transition on_event(const char&) override
+	{
+		return state_transition::stay();
+	}
+
+	std::string reason;
+};
+
+// Not one of the machine's states.
+class elsewhere;
+
+state_transition idle::on_event(const char& c)
+{
+	if (c == '!')
+		return state_transition::to<elsewhere>();
+
+	return c == '$' ? state_transition::to<command>()
+	                : state_transition::stay();
+}
+
+state_transition command::on_event(const char& c)
+{
+	if (c != ';')
+	{
+		name += c;
+		return state_transition::stay();
+	}
+
+	commands.push_back(first + name);
+	return state_transition::to<idle>();
+}
+
+using machine = local_state_machine<state, char, idle, command, failed>;
+}
+
+TEST_CASE("test local_state_machine")
+{
+	commands.clear();
+	live = 0;
+
+	SECTION("size and alignment cover all states")
+	{
+		REQUIRE(machine::state_count == 3);
+		REQUIRE(machine::state_size >= sizeof(command));
+		REQUIRE(machine::state_size >= sizeof(failed));
+		REQUIRE(machine::state_alignment >= alignof(command));
+		REQUIRE(machine::index_of<failed>() == 2);
+	}
+
+	SECTION("transitions construct the next state in place")
+	{
+		{
+			machine m{emplace_tag_t<idle>()};
+			REQUIRE(m.in<idle>());
+			REQUIRE(live == 1);
+
+			const auto* buffer = &m.state();
+
+			REQUIRE_FALSE(m.process('x'));
+			REQUIRE(m.in<idle>());
+
+			REQUIRE(m.process('$'));
+			REQUIRE(m.in<command>());
+			REQUIRE(m.index() == 1);
+			REQUIRE(static_cast<const void*>(&m.state()) ==
+			        static_cast<const void*>(buffer));
+			REQUIRE(live == 1);
+
+			for (auto c : std::string("go;x$stop;"))
+				m.process(c);
+
+			REQUIRE(m.in<idle>());
+			REQUIRE((commands == std::vector<std::string>{"$go", "$stop"}));
+			REQUIRE(live == 1);
+		}
+		REQUIRE(live == 0);
+	}
+
+	SECTION("enter a state with arguments from outside")
+	{
+		machine m{emplace_tag_t<idle>()};
+
+		auto& f = m.transition<failed>("reset");
+		REQUIRE(m.in<failed>());
+		REQUIRE(&f == &m.state());
+		REQUIRE(f.reason == "reset");
+		REQUIRE(live == 1);
+
+		REQUIRE_FALSE(m.process('$'));
+		REQUIRE(m.in<failed>());
+	}
+
+	SECTION("a transition to a type not in States is unhandled")
+	{
+		machine m{emplace_tag_t<idle>()};
+		const auto* buffer = &m.state();
+
+		REQUIRE_FALSE(m.process('!'));
+		REQUIRE(m.in<idle>());
+		REQUIRE(&m.state() == buffer);
+		REQUIRE(live == 1);
+
+		// the machine still works
+		REQUIRE(m.process('$'));
+		REQUIRE(m.in<command>());
+	}
+
+	SECTION("inspect a transition")
+	{
+		const auto t = state_transition::to<command>();
+		REQUIRE_FALSE(t.stays());
+		REQUIRE(t.is<command>());
+		REQUIRE_FALSE(t.is<idle>());
+		REQUIRE(state_transition::stay().stays());
+	}
+}
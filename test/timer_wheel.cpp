@@ -0,0 +1,210 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "catch.hpp"
+#include "timer_wheel.h"
+
+namespace
+{
+class callback
+{
+public:
+	virtual ~callback()
+	{
+	}
+
+	virtual void fire(uint64_t now) = 0;
+};
+
+// Records the time it fired at.
+class record final : public callback
+{
+public:
+	record(int id, std::map<int, uint64_t>& fired, int& live)
+	  : id(id), fired(&fired), live(&live)
+	{
+		++*this->live;
+	}
+
+	record(record&& other) : id(other.id), fired(other.fired), live(other.live)
+	{
+		++*live;
+	}
+
+	~record() override
+	{
+		--*live;
+	}
+
+	void fire(uint64_t now) override
+	{
+		(*fired)[id] = now;
+	}
+
+private:
+	int id;
+	std::map<int, uint64_t>* fired;
+	int* live;
+};
+
+// Throws from its constructor.
+class failing final : public callback
+{
+public:
+	failing()
+	{
+		throw std::runtime_error("failing");
+	}
+
+	void fire(uint64_t) override
+	{
+	}
+};
+}
+
+TEST_CASE("test timer_wheel")
+{
+	// 3 wheels of 4 buckets: 64 ticks, to exercise cascades and overflow
+	using wheel = timer_wheel<callback, 64, 3, 2>;
+
+	auto live = 0;
+	auto fired = std::map<int, uint64_t>();
+	wheel w;
+
+	const auto fire = [&](callback& c) { c.fire(w.time()); };
+
+	SECTION("test if timers fire at their expiry")
+	{
+		w.arm<record>(1, 1, fired, live);
+		w.arm<record>(5, 5, fired, live);
+		w.arm<record>(17, 17, fired, live);
+		w.arm<record>(64, 64, fired, live);
+		w.arm<record>(200, 200, fired, live);
+		REQUIRE(w.size() == 5);
+
+		REQUIRE(w.advance(300, fire) == 5);
+		REQUIRE(fired == (std::map<int, uint64_t>{
+		                     {1, 1}, {5, 5}, {17, 17}, {64, 64}, {200, 200}}));
+		REQUIRE(live == 0);
+		REQUIRE(w.empty());
+	}
+
+	SECTION("test cancel")
+	{
+		auto a = w.arm<record>(10, 1, fired, live);
+		auto b = w.arm<record>(10, 2, fired, live);
+
+		REQUIRE(w.cancel(a));
+		REQUIRE(!w.cancel(a));
+		REQUIRE(!w.pending(a));
+		REQUIRE(w.pending(b));
+		REQUIRE(live == 1);
+
+		// a new timer in a reused slot doesn't match the old handle
+		auto c = w.arm<record>(20, 3, fired, live);
+		REQUIRE(c.slot == a.slot);
+		REQUIRE(!w.cancel(a));
+		REQUIRE(w.pending(c));
+
+		w.advance(10, fire);
+		REQUIRE(fired == (std::map<int, uint64_t>{{2, 10}}));
+		REQUIRE(!w.cancel(b));
+		REQUIRE(w.cancel(c));
+	}
+
+	SECTION("test if callbacks can arm and cancel timers")
+	{
+		auto victim = timer_handle();
+		auto self = timer_handle();
+
+		class rearm final : public callback
+		{
+		public:
+			rearm(wheel& w, timer_handle& victim, timer_handle& self,
+			      std::map<int, uint64_t>& fired, int& live)
+			  : w(&w), victim(&victim), self(&self), fired(&fired), live(&live)
+			{
+			}
+
+			void fire(uint64_t now) override
+			{
+				REQUIRE(!w->cancel(*self));
+				REQUIRE(w->cancel(*victim));
+				w->arm<record>(1, 100, *fired, *live);
+				(*fired)[0] = now;
+			}
+
+		private:
+			wheel* w;
+			timer_handle* victim;
+			timer_handle* self;
+			std::map<int, uint64_t>* fired;
+			int* live;
+		};
+
+		self = w.arm<rearm>(4, w, victim, self, fired, live);
+		victim = w.arm<record>(4, 1, fired, live);
+
+		w.advance(10, fire);
+		REQUIRE(fired == (std::map<int, uint64_t>{{0, 4}, {100, 5}}));
+		REQUIRE(live == 0);
+	}
+
+	SECTION("test against a reference")
+	{
+		auto rng = std::mt19937(5);
+		auto delay = std::uniform_int_distribution<int>(1, 300);
+		auto coin = std::uniform_int_distribution<int>(0, 3);
+
+		auto expected = std::map<int, uint64_t>();
+		auto handles = std::vector<timer_handle>();
+		auto id = 0;
+
+		for (int step = 0; step < 200; ++step)
+		{
+			for (int i = 0; i < 5; ++i, ++id)
+			{
+				const auto d = static_cast<uint64_t>(delay(rng));
+				handles.push_back(w.arm<record>(d, id, fired, live));
+				expected[id] = w.time() + d;
+			}
+
+			// cancel a pending timer now and then
+			const auto victim = static_cast<size_t>(delay(rng)) % handles.size();
+			if (coin(rng) == 0 && w.cancel(handles[victim]))
+				expected.erase(static_cast<int>(victim));
+
+			w.advance(static_cast<uint64_t>(coin(rng)), fire);
+		}
+
+		w.advance(1000, fire);
+		REQUIRE(fired == expected);
+		REQUIRE(live == 0);
+	}
+
+	SECTION("test clear")
+	{
+		w.arm<record>(3, 1, fired, live);
+		w.arm<record>(300, 2, fired, live);
+		REQUIRE(live == 2);
+
+		w.clear();
+		REQUIRE(live == 0);
+		REQUIRE(w.empty());
+		REQUIRE(w.advance(400, fire) == 0);
+	}
+
+	SECTION("test a throwing constructor arms nothing")
+	{
+		w.arm<record>(3, 1, fired, live);
+		REQUIRE_THROWS_AS(w.arm<failing>(2), const std::runtime_error&);
+		REQUIRE(w.size() == 1);
+
+		w.arm<record>(2, 2, fired, live);
+		REQUIRE(w.advance(5, fire) == 2);
+		REQUIRE(fired == (std::map<int, uint64_t>{{1, 3}, {2, 2}}));
+		REQUIRE(live == 0);
+	}
+}
@@ -0,0 +1,127 @@
+#include <string>
+#include <utility>
+#include "catch.hpp"
+#include "local_derived.h"
+
+namespace
+{
+class animal
+{
+public:
+	virtual ~animal()
+	{
+	}
+
+	virtual std::string sound() const
+	{
+		return "...";
+	}
+};
+
+// Padding in front of the base subobject, so conversions need the offset.
+struct padding
+{
+	char bytes[24] = {};
+};
+
+class dog : public padding, public animal
+{
+public:
+	explicit dog(std::string name) : name(std::move(name))
+	{
+	}
+
+	std::string sound() const override
+	{
+		return name + ": woof";
+	}
+
+protected:
+	std::string name;
+};
+
+class puppy final : public dog
+{
+public:
+	explicit puppy(std::string name) : dog(std::move(name))
+	{
+	}
+
+	std::string sound() const override
+	{
+		return name + ": yip";
+	}
+};
+
+class cat final : public animal
+{
+public:
+	std::string sound() const override
+	{
+		return "meow";
+	}
+};
+}
+
+TEST_CASE("test type queries")
+{
+	const auto S = sizeof(puppy);
+
+	auto a = local_derived<animal, S>(emplace_tag_t<animal>());
+	auto d = local_derived<animal, S>(emplace_tag_t<dog>(), "rex");
+	auto p = local_derived<animal, S>(emplace_tag_t<puppy>(), "bit");
+	auto c = local_derived<animal, S>(emplace_tag_t<cat>());
+
+	SECTION("test if holds matches the exact type only")
+	{
+		REQUIRE(a.holds<animal>());
+		REQUIRE(!a.holds<dog>());
+
+		REQUIRE(d.holds<dog>());
+		REQUIRE(!d.holds<animal>());
+		REQUIRE(!d.holds<puppy>());
+
+		REQUIRE(p.holds<puppy>());
+		REQUIRE(!p.holds<dog>());
+
+		REQUIRE(c.holds<cat>());
+		REQUIRE(!c.holds<puppy>());
+	}
+
+	SECTION("test holds_any_of")
+	{
+		REQUIRE((p.holds_any_of<cat, puppy>()));
+		REQUIRE((c.holds_any_of<cat, puppy>()));
+		REQUIRE((!a.holds_any_of<cat, puppy>()));
+		REQUIRE(!a.holds_any_of<>());
+	}
+
+	SECTION("test if get_if returns the stored object")
+	{
+		REQUIRE(d.get_if<dog>() != nullptr);
+		REQUIRE(static_cast<animal*>(d.get_if<dog>()) == d.get());
+		REQUIRE(d.get_if<dog>()->sound() == "rex: woof");
+
+		REQUIRE(p.get_if<puppy>() == dynamic_cast<puppy*>(p.get()));
+
+		REQUIRE(d.get_if<puppy>() == nullptr);
+		REQUIRE(a.get_if<cat>() == nullptr);
+	}
+
+	SECTION("test if the type follows moves and swaps")
+	{
+		auto moved = std::move(c);
+		REQUIRE(moved.holds<cat>());
+
+		a.swap(d);
+		REQUIRE(a.holds<dog>());
+		REQUIRE(d.holds<animal>());
+
+		auto converted = local_derived<animal, S>(
+		    local_derived<dog, sizeof(puppy)>(emplace_tag_t<puppy>(), "max"));
+		REQUIRE(converted.holds<puppy>());
+		REQUIRE(static_cast<animal*>(converted.get_if<puppy>()) ==
+		        converted.get());
+		REQUIRE(converted->sound() == "max: yip");
+	}
+}
@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "local_derived_simd.h"
+#include "simple_hierarchy.h"
+#include "split_local_vector.h"
+
+TEST_CASE("test type tag scans")
+{
+	using namespace local_derived_internal;
+
+	// a length that is not a multiple of any vector width, with runs
+	// longer than the byte counters can hold
+
+	auto tags = std::vector<uint8_t>(20000 + 13);
+	for (size_t i = 0; i < tags.size(); ++i)
+		tags[i] = static_cast<uint8_t>(i < 9000 ? 1 : (i * 7) % 5);
+
+	auto levels = std::vector<simd_level>({simd_level::scalar});
+	if (detected_simd_level() != simd_level::scalar)
+		levels.push_back(simd_level::sse2);
+	if (detected_simd_level() == simd_level::avx2)
+		levels.push_back(simd_level::avx2);
+
+	SECTION("test if all levels count like the scalar loop")
+	{
+		for (auto level : levels)
+		{
+			for (uint8_t tag = 0; tag < 6; ++tag)
+			{
+				REQUIRE(count_tags(tags.data(), tags.size(), tag, level) ==
+				        count_tags_scalar(tags.data(), tags.size(), tag));
+			}
+		}
+	}
+
+	SECTION("test if all levels find like the scalar loop")
+	{
+		auto expected = std::vector<size_t>();
+		find_tags_scalar(tags.data(), tags.size(), 3, expected);
+
+		for (auto level : levels)
+		{
+			auto found = std::vector<size_t>();
+			find_tags(tags.data(), tags.size(), 3, found, level);
+			REQUIRE(found == expected);
+		}
+	}
+}
+
+TEST_CASE("test split_local_vector partition_by_type")
+{
+	using namespace simple_hierarchy;
+
+	const auto S = sizeof(derived21);
+
+	auto v = split_local_vector<base, S>();
+
+	for (int i = 0; i < 100; ++i)
+	{
+		switch (i % 3)
+		{
+		case 0:
+			v.emplace_back<derived2>(double(i));
+			break;
+		case 1:
+			v.emplace_back<derived1>(std::to_string(i));
+			break;
+		default:
+			v.emplace_back<base>(i);
+			break;
+		}
+	}
+
+	REQUIRE(v.type_tag<derived2>() == 0);
+	REQUIRE(v.type_tag<derived1>() == 1);
+	REQUIRE(v.type_tag<base>() == 2);
+	REQUIRE(v.type_tag<derived22>() == -1);
+
+	REQUIRE(v.count_type<derived2>() == 34);
+	REQUIRE(v.count_type<derived1>() == 33);
+	REQUIRE(v.count_type<derived22>() == 0);
+
+	const auto bounds = v.partition_by_type();
+
+	REQUIRE(bounds == std::vector<size_t>({0, 34, 67, 100}));
+
+	SECTION("test if each type forms one run, in the original order")
+	{
+		for (size_t i = 0; i < 34; ++i)
+		{
+			REQUIRE(v.holds<derived2>(i));
+			REQUIRE(v[i].message() ==
+			        derived2::expected_message(double(i * 3)));
+		}
+
+		for (size_t i = 34; i < 67; ++i)
+		{
+			REQUIRE(v.holds<derived1>(i));
+			REQUIRE(v[i].message() ==
+			        derived1::expected_message(std::to_string((i - 34) * 3 + 1)));
+		}
+
+		for (size_t i = 67; i < 100; ++i)
+			REQUIRE(v.type_tags()[i] == 2);
+	}
+
+	SECTION("test if the container still works after partitioning")
+	{
+		auto found = std::vector<size_t>();
+		v.find_all<base>(found);
+		REQUIRE(found.size() == 33);
+		REQUIRE(found.front() == 67);
+
+		v.swap_remove(0);
+		REQUIRE(v.holds<base>(0));
+		REQUIRE(v.count_type<derived2>() == 33);
+
+		v.emplace_back<derived22>(1.0);
+		REQUIRE(v.type_tag<derived22>() == 3);
+	}
+}